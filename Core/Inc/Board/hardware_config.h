@@ -15,6 +15,7 @@
 #include "version_config.h"
 #include "interrupts_config.h"
 #include "utilities.h"
+#include "peripheral_clock.h"
 
 /* Public STM Includes */
 #include "stm32l4xx_hal.h"
@@ -25,10 +26,6 @@
 #define TIMER_FREQUENCY_100KHz 100000
 #define TIMER_FREQUENCY_1MHz   1000000
 
-// TEMPORARY MARCO: TODO IS MAKE A WHOE CLOCK CONFIG FILE. This currently
-// just copies value from STM32 file
-#define SYSTEM_CLOCK_CORE 4000000
-
 // Define ports and pins for peripherals that have been enabled in configuration.h file
 
 /********** Marcos for hardware related to the buttons **********/
@@ -86,36 +83,83 @@
  * is run at the appropriate time
  */
 #define HC_TS_TIMER              TIM15
-#define HC_TS_TIMER_CLK_ENABLE() __HAL_RCC_TIM15_CLK_ENABLE()
+#define HC_TS_TIMER_CLOCK        PCLK_TIM15
 #define HC_TS_TIMER_FREQUENCY    TIMER_FREQUENCY_1KHz
 #define HC_TS_TIMER_MAX_COUNT    UINT_16_BIT_MAX_VALUE
 #define HC_TS_TIMER_IRQn         TIM1_BRK_TIM15_IRQn
 #define HC_TS_TIMER_ISR_PRIORITY TIM15_ISR_PRIORITY
+
+// Priority preemptive tasks are run at
+#define HC_TS_PREEMPTIVE_ISR_PRIORITY PENDSV_ISR_PRIORITY
+/***********************************************************************/
+
+/********** Marcos for hardware related to the microsecond scheduler lane **********/
+/**
+ * The microsecond lane of the task scheduler runs short tasks that need finer
+ * timing than the 1ms resolution of the task scheduler. TIM2 is the only 32 bit
+ * timer but it counts the pulses of encoder 2, so the basic timer TIM7 is used
+ * with its reload value set to when the next task is due
+ */
+#define HC_TSU_TIMER              TIM7
+#define HC_TSU_TIMER_CLOCK        PCLK_TIM7
+#define HC_TSU_TIMER_FREQUENCY    TIMER_FREQUENCY_1MHz
+#define HC_TSU_TIMER_MAX_COUNT    UINT_16_BIT_MAX_VALUE
+#define HC_TSU_TIMER_IRQn         TIM7_IRQn
+#define HC_TSU_TIMER_ISR_PRIORITY TIM7_ISR_PRIORITY
+/***********************************************************************/
+
+/********** Marcos for hardware related to the monotonic time **********/
+/**
+ * Every timestamp in the system comes from this timer. It runs freely at
+ * 1MHz and its overflows are counted to make a 64 bit time
+ */
+#define HC_TIME_TIMER              TIM6
+#define HC_TIME_TIMER_CLOCK        PCLK_TIM6
+#define HC_TIME_TIMER_FREQUENCY    TIMER_FREQUENCY_1MHz
+#define HC_TIME_TIMER_MAX_COUNT    UINT_16_BIT_MAX_VALUE
+#define HC_TIME_TIMER_IRQn         TIM6_DAC_IRQn
+#define HC_TIME_TIMER_ISR_PRIORITY TIM6_ISR_PRIORITY
+/***********************************************************************/
+
+/********** Marcos for hardware related to low power mode **********/
+/**
+ * None of the other timers count in Stop 2. This timer runs from the LSE so
+ * it keeps counting and wakes the mcu when the next scheduler task is due
+ */
+#define HC_LP_TIMER              LPTIM1
+#define HC_LP_TIMER_CLOCK        PCLK_LPTIM1
+#define HC_LP_TIMER_FREQUENCY    32768
+#define HC_LP_TIMER_MAX_COUNT    UINT_16_BIT_MAX_VALUE
+#define HC_LP_TIMER_IRQn         LPTIM1_IRQn
+#define HC_LP_TIMER_ISR_PRIORITY LPTIM1_ISR_PRIORITY
+
+// The uart rx pin wakes the mcu through its EXTI line
+#define HC_LP_SERIAL_WAKE_IRQn         EXTI15_10_IRQn
+#define HC_LP_SERIAL_WAKE_ISR_PRIORITY EXTI15_10_ISR_PRIORITY
 /***********************************************************************/
 
-/********** Marcos for hardware related to the Synchronous timer **********/
+/********** Marcos for hardware related to the cyclic executive **********/
 /**
- * The synchronous timer generates an interrupt every t time units. In the
- * interrupt, synchronous tasks that need to happen can be run
+ * The cyclic executive runs control loops at fixed rates. It uses capture
+ * compare channel 2 of the task scheduler timer so both share the same time
+ * base and the control loops run at the highest interrupt priority
  */
-#define HC_SYNC_TIMER              TIM6
-#define HC_SYNC_TIMER_CLK_ENABLE() __HAL_RCC_TIM6_CLK_ENABLE()
-#define HC_SYNC_TIMER_FREQUENCY    TIMER_FREQUENCY_1MHz
-#define HC_SYNC_TIMER_MAX_COUNT    10 // Frequency of 1Mhz will give a 10us timer if max count is 10
-#define HC_SYNC_TIMER_IRQn         TIM6_DAC_IRQn
-#define HC_SYNC_TIMER_ISR_PRIORITY TIM6_ISR_PRIORITY
+#define HC_CE_TIMER           HC_TS_TIMER
+#define HC_CE_TIMER_FREQUENCY HC_TS_TIMER_FREQUENCY
+#define HC_CE_TIMER_MAX_COUNT HC_TS_TIMER_MAX_COUNT
+#define HC_CE_TIMER_IRQn      HC_TS_TIMER_IRQn
 /***********************************************************************/
 
 /********** Marcos for hardware related to the Piezo Buzzer **********/
 /**
  * The pizeo buzzer timer used for generated PWM signals to make sounds
- * on the piezo buzzer
+ * on the piezo buzzer. Its clock is only on while a sound is playing
  */
 #define HC_PIEZO_BUZZER_PORT GPIOA
 #define HC_PIEZO_BUZZER_PIN  6
 
 #define HC_PIEZO_BUZZER_TIMER              TIM16
-#define HC_PIEZO_BUZZER_TIMER_CLK_ENABLE() __HAL_RCC_TIM16_CLK_ENABLE()
+#define HC_PIEZO_BUZZER_TIMER_CLOCK        PCLK_TIM16
 #define HC_PIEZO_BUZZER_TIMER_FREQUENCY    TIMER_FREQUENCY_100KHz
 #define HC_PIEZO_BUZZER_TIMER_MAX_COUNT    UINT_16_BIT_MAX_VALUE
 #define HC_PIEZO_BUZZER_TIMER_IRQn         TIM1_UP_TIM16_IRQn
@@ -125,7 +169,8 @@
 /********** Marcos for hardware related to the Encoders **********/
 /**
  * The timers are used to increment the encoder counts every time the pins
- * they are connected to go high
+ * they are connected to go high. Their clocks are only on while the motor
+ * they measure is moving so edges while the motor is stopped aren't counted
  */
 #define HC_ENCODER_1_PORT         GPIOA
 #define HC_ENCODER_1_PIN          8
@@ -133,7 +178,7 @@
 #define HC_ENCODER_1_IRQn         EXTI9_5_IRQn
 
 #define HC_ENCODER_1_TIMER              TIM1
-#define HC_ENCODER_1_TIMER_CLK_ENABLE() __HAL_RCC_TIM1_CLK_ENABLE()
+#define HC_ENCODER_1_TIMER_CLOCK        PCLK_TIM1
 #define HC_ENCODER_1_TIMER_FREQUENCY    TIMER_FREQUENCY_1KHz
 #define HC_ENCODER_1_TIMER_MAX_COUNT    UINT_32_BIT_MAX_VALUE
 #define HC_ENCODER_1_TIMER_IRQn         TIM1_CC_IRQn
@@ -145,7 +190,7 @@
 #define HC_ENCODER_2_IRQn         EXTI0_IRQn
 
 #define HC_ENCODER_2_TIMER              TIM2
-#define HC_ENCODER_2_TIMER_CLK_ENABLE() __HAL_RCC_TIM2_CLK_ENABLE()
+#define HC_ENCODER_2_TIMER_CLOCK        PCLK_TIM2
 #define HC_ENCODER_2_TIMER_FREQUENCY    TIMER_FREQUENCY_1KHz
 #define HC_ENCODER_2_TIMER_MAX_COUNT    UINT_32_BIT_MAX_VALUE
 #define HC_ENCODER_2_TIMER_IRQn         TIM2_IRQn
@@ -159,7 +204,7 @@
  */
 #define HC_DEBUG_LOG_GPIO_RX_CLK_ENABLE() __HAL_RCC_GPIOA_CLK_ENABLE()
 #define HC_DEBUG_LOG_GPIO_TX_CLK_ENABLE() __HAL_RCC_GPIOA_CLK_ENABLE()
-#define HC_DEBUG_LOG_CLK_ENABLE()         __HAL_RCC_USART2_CLK_ENABLE()
+#define HC_DEBUG_LOG_CLOCK                PCLK_USART2
 
 #define HC_DEBUG_LOG_RX_PORT   GPIOA
 #define HC_DEBUG_LOG_TX_PORT   GPIOA
@@ -168,9 +213,45 @@
 #define HC_DEBUG_LOG_BUAD_RATE 115200
 /**************************************************************/
 
+/********** Marcos for hardware related to the real time clock **********/
+/**
+ * The real time clock runs from the 32.768kHz LSE. The prescalers divide
+ * it down to 1Hz for the calendar: 32768 / (127 + 1) / (255 + 1) = 1
+ */
+#define HC_RTC_ASYNC_PRESCALER 127
+#define HC_RTC_SYNC_PRESCALER  255
+
+#define HC_RTC_ALARM_IRQn         RTC_Alarm_IRQn
+#define HC_RTC_ALARM_ISR_PRIORITY RTC_ALARM_ISR_PRIORITY
+/************************************************************************/
+
+/********** Marcos for the location the blinds are installed at **********/
+/**
+ * Used to work out sunrise and sunset. The UTC offset is the local time the
+ * real time clock is set to
+ */
+#define HC_SOLAR_LATITUDE           -27.47f
+#define HC_SOLAR_LONGITUDE          153.03f
+#define HC_SOLAR_UTC_OFFSET_MINUTES 600
+/*************************************************************************/
+
 /**
  * @brief Initialise the system library.
  */
 void hardware_config_init(void);
 
+/**
+ * @brief Waits for the uart to finish sending so the baud rate can be changed
+ * straight away by hardware_config_update_clocks(). Called by
+ * mcu_clock_set_profile() before it disables interrupts
+ */
+void hardware_config_prepare_clock_change(void);
+
+/**
+ * @brief Retimes the timers and the uart after the system clock has changed
+ * so they keep running at the rates set in this file. Called by
+ * mcu_clock_set_profile()
+ */
+void hardware_config_update_clocks(void);
+
 #endif // HARDWARE_CONFIG_H
@@ -1,12 +1,13 @@
 /**
- * @file mcu_clock.c
+ * @file mcu_clock.h
  * @author Gian Barta-Dougall
- * @brief File to initialise clock of microcontroller
+ * @brief Clock profiles of the microcontroller. The system runs from the
+ * 4MHz MSI when idle and can switch to the 80MHz PLL for bursts of work
  * @version 0.1
  * @date 2022-07-02
- * 
+ *
  * @copyright Copyright (c) 2022
- * 
+ *
  */
 #ifndef MCU_CLOCK_H
 #define MCU_CLOCK_H
@@ -14,6 +15,76 @@
 #include "stm32l4xx.h"
 #include "stm32l4xx_hal.h"
 
-extern uint32_t systemClock;
+/* Public #defines */
 
-#endif // MCU_CLOCK_H
\ No newline at end of file
+// Slowest and fastest clocks the timers see across all the profiles. Every
+// timer frequency in hardware_config.h must be reachable from both
+#define MCU_CLOCK_TIMER_CLOCK_MIN 4000000
+#define MCU_CLOCK_TIMER_CLOCK_MAX 40000000
+
+// Largest division the 16 bit timer prescalers can make
+#define MCU_CLOCK_TIMER_PRESCALER_MAX 65536
+
+/* Public Structures and Enumerations */
+
+enum McuClockProfiles {
+    MCU_CLOCK_LOW_POWER,   // 4MHz MSI, voltage range 2
+    MCU_CLOCK_PERFORMANCE, // 80MHz PLL, voltage range 1
+    MCU_CLOCK_NUM_PROFILES,
+};
+
+/* Public Function Prototypes */
+
+/**
+ * @brief Starts the LSE, sets the MSI to 4MHz and runs the system from the
+ * low power profile. Must be called before any peripheral is initialised
+ */
+void mcu_clock_init(void);
+
+/**
+ * @brief Switches the system clock to a profile then retimes every timer and
+ * the uart so they keep running at the same rates. Each switch can lose up to
+ * one count of each timer so switch for bursts of work, not for every sleep
+ *
+ * @param profile The profile to switch to
+ */
+void mcu_clock_set_profile(uint8_t profile);
+
+/**
+ * @brief Sets the clocks back up after waking from Stop 2. The mcu always
+ * wakes running from the MSI with the PLL off
+ */
+void mcu_clock_restore(void);
+
+/**
+ * @brief Returns the current profile
+ *
+ * @return uint8_t The profile
+ */
+uint8_t mcu_clock_get_profile(void);
+
+/**
+ * @brief Returns the name of a profile
+ *
+ * @param profile The profile
+ * @return const char* The name or "unknown" if the profile isn't valid
+ */
+const char* mcu_clock_get_profile_name(uint8_t profile);
+
+/**
+ * @brief Returns the clock of the APB buses. Both buses are always divided
+ * by the same amount
+ *
+ * @return uint32_t The clock in Hz
+ */
+uint32_t mcu_clock_get_apb_clock(void);
+
+/**
+ * @brief Returns the clock the timers count from. The timers run at twice
+ * the bus clock when the bus is divided down
+ *
+ * @return uint32_t The clock in Hz
+ */
+uint32_t mcu_clock_get_timer_clock(void);
+
+#endif // MCU_CLOCK_H
@@ -0,0 +1,80 @@
+/**
+ * @file peripheral_clock.h
+ * @author Gian Barta-Dougall
+ * @brief Reference counted bus clocks of the peripherals. Drivers request a
+ * clock before touching a peripheral and release it when they are done. The
+ * clock is only gated once every request has been released
+ * @version 0.1
+ * @date --
+ *
+ * @copyright Copyright (c)
+ *
+ */
+#ifndef PERIPHERAL_CLOCK_H
+#define PERIPHERAL_CLOCK_H
+
+/* Public Includes */
+
+/* Public STM Includes */
+#include "stm32l4xx.h"
+
+/* Public #defines */
+
+/* Public Structures and Enumerations */
+
+enum PeripheralClocks {
+    PCLK_GPIOA,
+    PCLK_GPIOB,
+    PCLK_TIM1,
+    PCLK_TIM2,
+    PCLK_TIM6,
+    PCLK_TIM7,
+    PCLK_TIM15,
+    PCLK_TIM16,
+    PCLK_USART2,
+    PCLK_ADC,
+    PCLK_LPTIM1,
+    PCLK_NUM_CLOCKS,
+};
+
+/* Public Variable Declarations */
+
+/* Public Function Prototypes */
+
+/**
+ * @brief Enables the clock of a peripheral if nothing else has requested it.
+ * Every request must be matched by a release. Safe to call from interrupts
+ *
+ * @param clock The clock to request
+ */
+void pclk_request(uint8_t clock);
+
+/**
+ * @brief Gives back a request for the clock of a peripheral. The clock is
+ * gated when the last request is released. The registers of the peripheral
+ * keep their values while it is gated but it stops counting and reads of its
+ * registers return 0
+ *
+ * @param clock The clock to release
+ */
+void pclk_release(uint8_t clock);
+
+/**
+ * @brief Returns whether the clock of a peripheral is running
+ *
+ * @param clock The clock
+ * @return uint8_t TRUE if the clock is running else FALSE
+ */
+uint8_t pclk_is_live(uint8_t clock);
+
+/**
+ * @brief Prints every clock, whether it is running and how many requests
+ * are holding it
+ */
+void pclk_print(void);
+
+#if (PROJECT_STATUS == UNIT_TESTS)
+void pclk_run_unit_tests(void);
+#endif
+
+#endif // PERIPHERAL_CLOCK_H
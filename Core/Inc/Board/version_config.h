@@ -87,6 +87,7 @@
  *  versions of the system
  */
 #if (PROJECT_VERSION == V_0_0_0)
+#    define MONOTONIC_TIME_MODULE_ENABLED
 #    define TASK_SCHEDULER_MODULE_ENABLED
 #    define BUTTON_MODULE_ENABLED
 #    define LED_MODULE_ENABLED
@@ -96,6 +97,9 @@
 #    define ENCODER_MODULE_ENABLED
 #    define DEBUG_LOG_MODULE_ENABLED
 #    define AMBIENT_LIGHT_SENSOR_MODULE_ENABLED
+#    define RTC_MODULE_ENABLED
+#    define LOW_POWER_MODULE_ENABLED
+#    define RAM_FUNCTIONS_ENABLED
 #endif
 
 #endif // VERSION_CONFIG_H
@@ -33,17 +33,37 @@
 #define EXTI9_5_ISR_PRIORITY   PRIORITY_5
 #define EXTI15_10_ISR_PRIORITY PRIORITY_5
 
+// Shares an event queue with the EXTI interrupts so must have the same priority
+#define COMP_ISR_PRIORITY PRIORITY_5
+
+// The rtc alarm is connected to EXTI line 18 and passes its events to the same
+// queue as the EXTI interrupts
+#define RTC_ALARM_ISR_PRIORITY PRIORITY_5
+
 /* Configuration for TIM interrupt priorities */
 
 #define TIM1_ISR_PRIORITY PRIORITY_5
 #define TIM2_ISR_PRIORITY PRIORITY_5
 #define TIM3_ISR_PRIORITY PRIORITY_5
+
+// Timer 6 runs the monotonic time. Its overflows must be counted before the
+// timer wraps again so it is above every interrupt that could run for long
 #define TIM6_ISR_PRIORITY PRIORITY_2
-#define TIM7_ISR_PRIORITY PRIORITY_5
+
+// Low power timer 1 only wakes the mcu from Stop 2 so it has nothing urgent to do
+#define LPTIM1_ISR_PRIORITY PRIORITY_5
 
 // Timer 15 runs the task scheduler, important that this priority is higher
-// than any interrupt that could pass that task scheduler a task
+// than any interrupt that could pass that task scheduler a task. Timer 7 runs
+// the microsecond lane of the scheduler for the same reason
+#define TIM7_ISR_PRIORITY          PRIORITY_1
 #define TIM15_ISR_PRIORITY         PRIORITY_1
 #define TIM1_UP_TIM16_ISR_PRIORITY PRIORITY_5
 
+/* Configuration for system interrupt priorities */
+
+// PendSV runs preemptive scheduler tasks. It must be lower than the task
+// scheduler timer but higher than the interrupts that are not time critical
+#define PENDSV_ISR_PRIORITY PRIORITY_3
+
 #endif // INTERRUPTS_CONFIG_H
\ No newline at end of file
@@ -24,10 +24,6 @@ enum Mode { BLIND_MODE_MANUAL, BLIND_MODE_DAY_LIGHT, CONFIGURE_SETINGS };
 #define BLIND_2_ID      (1 + BLIND_ID_OFFSET)
 
 enum BlindFunctions {
-    FUNC_ID_BLINK_RED_LED,
-    FUNC_ID_BLINK_ORANGE_LED,
-    FUNC_ID_PLAY_CONFIG_SETTINGS_SOUND,
-    FUNC_ID_SWITCH_BLIND_MODE_TO_DAYLIGHT,
     FUNC_ID_BLINDS_DAY_LIGHT_UPDATE,
 };
 
@@ -36,7 +32,7 @@ typedef struct Blind {
     const uint8_t blindMotorId;
     const uint8_t alSensorId;
     const uint8_t userInterfaceId;
-    const Task1 switchToDayLightModeTask;
+    TsHandle switchToDayLightModeTaskHandle;
     uint8_t mode;
     uint8_t previousMode;
     uint8_t status;
@@ -59,11 +59,23 @@ void bm_stop_blind_moving(uint8_t blindId);
 void bm_move_blind(uint8_t blindId, enum MotorDirection motorDirection);
 
 /**
- * @brief Processes any internal flags that are set through interrupts.
- * This function should be called repeatedly as quickly as possible to
- * ensure any flags that are raised are dealt ASAP
+ * @brief Brakes the motor driven by the given encoder. Called from the encoder
+ * timer interrupt when the encoder reaches one of its bounds. Only the motor
+ * pins are written so the interrupt stays short. The rest of stopping the blind
+ * is done by bm_process_encoder_limit_reached() from the main loop
+ *
+ * @param encoderId The ID of the encoder that reached its limit
+ */
+void bm_encoder_limit_reached_isr(uint8_t encoderId);
+
+/**
+ * @brief Stops the blind motor driven by the given encoder. Called from
+ * the main loop when the encoder reports that it has reached one of its
+ * bounds
+ *
+ * @param encoderId The ID of the encoder that reached its limit
  */
-void bm_process_internal_flags(void);
+void bm_process_encoder_limit_reached(uint8_t encoderId);
 
 /**
  * @brief Sets the new minimum height of the blind
@@ -111,4 +123,8 @@ uint8_t bm_blind_at_max_height(uint8_t blindMotorId);
 uint8_t bm_blind_at_min_height(uint8_t blindMotorId);
 uint16_t bm_get_height(uint8_t blindMotorId);
 
+#if (PROJECT_STATUS == UNIT_TESTS)
+void bm_run_unit_tests(void);
+#endif
+
 #endif // BLIND_MOTOR_H
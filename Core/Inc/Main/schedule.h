@@ -0,0 +1,89 @@
+/**
+ * @file schedule.h
+ * @author Gian Barta-Dougall
+ * @brief Table of times to move the blinds at. Only the next move is given to
+ * the real time clock as an alarm so the table is only looked at when it is due
+ * @version 0.1
+ * @date --
+ *
+ * @copyright Copyright (c)
+ *
+ */
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+/* Public Includes */
+#include "real_time_clock.h"
+
+/* Public STM Includes */
+#include "stm32l4xx.h"
+
+/* Public #defines */
+#define SCHEDULE_MAX_ENTRIES 8
+
+// Days an entry runs on. Bit 0 is Monday
+#define SCHEDULE_DAY(weekday) (0x01 << ((weekday) - RTC_MONDAY))
+#define SCHEDULE_WEEKDAYS     0x1F
+#define SCHEDULE_WEEKENDS     0x60
+#define SCHEDULE_DAILY        0x7F
+
+/* Public Structures and Enumerations */
+
+typedef struct ScheduleEntry {
+    uint8_t blindId;
+    uint8_t direction; // BLIND_UP or BLIND_DOWN
+    uint8_t hours;
+    uint8_t minutes;
+    uint8_t days;
+} ScheduleEntry;
+
+/* Public Variable Declarations */
+
+/* Public Function Prototypes */
+
+/**
+ * @brief Sets the alarm for the first move in the schedule. The real time
+ * clock must be initialised first
+ */
+void schedule_init(void);
+
+/**
+ * @brief Adds an entry to the schedule
+ *
+ * @param entry The entry to copy into the schedule
+ * @return uint8_t TRUE if the entry was added else FALSE if it isn't valid or
+ * the schedule is full
+ */
+uint8_t schedule_add_entry(ScheduleEntry* entry);
+
+/**
+ * @brief Removes an entry from the schedule. The entries after it move down
+ * one place
+ *
+ * @param index The position of the entry in the schedule
+ * @return uint8_t TRUE if the entry was removed else FALSE
+ */
+uint8_t schedule_remove_entry(uint8_t index);
+
+/**
+ * @brief Sets the alarm for the next move in the schedule. Must be called
+ * whenever the calendar is changed
+ */
+void schedule_update_alarm(void);
+
+/**
+ * @brief Moves the blinds that are due and sets the alarm for the next move.
+ * Called from the main loop when the schedule alarm goes off
+ */
+void schedule_process_alarm(void);
+
+/**
+ * @brief Prints every entry in the schedule and when the next move is
+ */
+void schedule_print(void);
+
+#if (PROJECT_STATUS == UNIT_TESTS)
+void schedule_run_unit_tests(void);
+#endif
+
+#endif // SCHEDULE_H
@@ -30,6 +30,15 @@
 void tempest_init(void);
 
 void tempest_update(void);
+
+/**
+ * @brief Returns the percentage of time the core spent asleep waiting for
+ * an interrupt, measured over the last second
+ *
+ * @return uint8_t The idle percentage from 0 to 100
+ */
+uint8_t tempest_get_idle_percentage(void);
+
 void tempest_stop_blind_1_moving(void);
 void tempest_stop_blind_2_moving(void);
 
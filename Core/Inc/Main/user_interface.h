@@ -27,8 +27,8 @@
 typedef struct UserInterface {
     const uint8_t id;
     const uint8_t ledId;
-    Task1* blinkLedTask;
-    Task1* configureSettingsSound;
+    TsHandle blinkLedTaskHandle;
+    TsHandle configureSettingsSoundHandle;
 } UserInterface;
 
 /* Public Variable Declarations */
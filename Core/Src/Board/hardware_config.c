@@ -15,6 +15,7 @@
 
 /* Private Includes */
 #include "adc_config.h"
+#include "mcu_clock.h"
 
 /* Private STM Includes */
 #include "stm32l4xx_hal.h"
@@ -24,7 +25,7 @@
 #define EXTI_PORTA 0x00
 #define EXTI_PORTB 0x01
 
-#define TIMER_SETTINGS_NOT_VALID(frequency, maxCount) ((SystemCoreClock / frequency) > maxCount)
+#define TIMER_SETTINGS_NOT_VALID(frequency, maxCount) ((mcu_clock_get_timer_clock() / frequency) > maxCount)
 
 /* Private Structures and Enumerations */
 
@@ -38,6 +39,8 @@ void hardware_error_handler(void);
 void hardware_config_gpio_reset(void);
 void hardware_config_adc_init(void);
 void hardware_config_exti_interrupts(void);
+void hardware_config_rtc_init(void);
+void hardware_config_retime_timer(TIM_TypeDef* timer, uint32_t frequency);
 
 /* Public Functions */
 
@@ -55,6 +58,55 @@ void hardware_config_init(void) {
 
     // // Initialise all ADCs
     hardware_config_adc_init();
+
+    // Initialise the real time clock
+    hardware_config_rtc_init();
+}
+
+void hardware_config_prepare_clock_change(void) {
+
+#ifdef DEBUG_LOG_MODULE_ENABLED
+
+    // Sending the last character takes up to a character time, so it is waited
+    // for before interrupts are disabled for the switch
+    while ((USART2->ISR & USART_ISR_TC) == 0) {}
+
+#endif
+}
+
+void hardware_config_update_clocks(void) {
+
+    /* The encoder timers are clocked by the encoder edges, not the bus, so
+        they don't need retiming */
+
+#ifdef MONOTONIC_TIME_MODULE_ENABLED
+    hardware_config_retime_timer(HC_TIME_TIMER, HC_TIME_TIMER_FREQUENCY);
+#endif
+
+#ifdef TASK_SCHEDULER_MODULE_ENABLED
+    hardware_config_retime_timer(HC_TS_TIMER, HC_TS_TIMER_FREQUENCY);
+    hardware_config_retime_timer(HC_TSU_TIMER, HC_TSU_TIMER_FREQUENCY);
+#endif
+
+#ifdef PIEZO_BUZZER_MODULE_ENABLED
+
+    // Writes to the timer are lost while its clock is gated
+    pclk_request(HC_PIEZO_BUZZER_TIMER_CLOCK);
+    hardware_config_retime_timer(HC_PIEZO_BUZZER_TIMER, HC_PIEZO_BUZZER_TIMER_FREQUENCY);
+    pclk_release(HC_PIEZO_BUZZER_TIMER_CLOCK);
+
+#endif
+
+#ifdef DEBUG_LOG_MODULE_ENABLED
+
+    // The baud rate can only be changed while the uart is disabled. The last
+    // character has normally finished in hardware_config_prepare_clock_change()
+    while ((USART2->ISR & USART_ISR_TC) == 0) {}
+    USART2->CR1 &= ~(USART_CR1_UE);
+    USART2->BRR = mcu_clock_get_apb_clock() / HC_DEBUG_LOG_BUAD_RATE;
+    USART2->CR1 |= USART_CR1_UE;
+
+#endif
 }
 
 /* Private Functions */
@@ -64,8 +116,9 @@ void hardware_config_init(void) {
  */
 void hardware_config_gpio_init(void) {
 
-    // Enable clocks for GPIO port A and B
-    RCC->AHB2ENR |= 0x03;
+    // Every pin is set up once and left running so port A and B are never gated
+    pclk_request(PCLK_GPIOA);
+    pclk_request(PCLK_GPIOB);
 
     // Configure GPIO pins for the pushbuttons if the module is enabled for the current version
     // being compiled
@@ -211,6 +264,20 @@ void hardware_config_exti_interrupts(void) {
     HAL_NVIC_EnableIRQ(HC_BUTTON_2_IQRn);
 #endif
 
+#ifdef LOW_POWER_MODULE_ENABLED
+
+    // The uart is off in Stop 2 so its rx pin wakes the mcu instead. The line
+    // is only unmasked while the mcu is stopped
+    SYSCFG->EXTICR[HC_DEBUG_LOG_RX_PIN / 4] &= ~(0x0F << (4 * (HC_DEBUG_LOG_RX_PIN % 4)));
+    SYSCFG->EXTICR[HC_DEBUG_LOG_RX_PIN / 4] |= (EXTI_PORTA << (4 * (HC_DEBUG_LOG_RX_PIN % 4)));
+    EXTI->FTSR1 |= (0x01 << HC_DEBUG_LOG_RX_PIN);
+    EXTI->IMR1 &= ~(0x01 << HC_DEBUG_LOG_RX_PIN);
+
+    HAL_NVIC_SetPriority(HC_LP_SERIAL_WAKE_IRQn, HC_LP_SERIAL_WAKE_ISR_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(HC_LP_SERIAL_WAKE_IRQn);
+
+#endif
+
 #ifdef DEBUG_LOG_MODULE_ENABLED
 
     // Configure priorities for USART2 interrupt
@@ -222,6 +289,57 @@ void hardware_config_exti_interrupts(void) {
 
 void hardware_config_timer_init(void) {
 
+#ifdef MONOTONIC_TIME_MODULE_ENABLED
+
+#    if ((MCU_CLOCK_TIMER_CLOCK_MAX / HC_TIME_TIMER_FREQUENCY) > MCU_CLOCK_TIMER_PRESCALER_MAX)
+#        error System clock frequency is too high to generate the required timer frequnecy
+#    endif
+
+    /* Configure the free running timer for the monotonic time */
+    pclk_request(HC_TIME_TIMER_CLOCK);                                    // Enable the clock
+    HC_TIME_TIMER->CR1 &= ~(TIM_CR1_CEN);                                 // Disable counter
+    HC_TIME_TIMER->CR1 |= TIM_CR1_URS;                                    // Only counter overflows set the update flag
+    HC_TIME_TIMER->PSC = (mcu_clock_get_timer_clock() / HC_TIME_TIMER_FREQUENCY) - 1; // Set timer frequency
+    HC_TIME_TIMER->EGR |= TIM_EGR_UG;                                     // Load the prescaler
+    HC_TIME_TIMER->ARR = HC_TIME_TIMER_MAX_COUNT;                         // Set maximum count for timer
+    HC_TIME_TIMER->CNT = 0;                                               // Reset count to 0
+    HC_TIME_TIMER->SR  = 0x00;                                            // Clear any pending interrupts
+    HC_TIME_TIMER->DIER |= TIM_DIER_UIE;                                  // The overflow is the only interrupt
+
+    HAL_NVIC_SetPriority(HC_TIME_TIMER_IRQn, HC_TIME_TIMER_ISR_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(HC_TIME_TIMER_IRQn);
+
+    // The time starts counting here and never stops
+    HC_TIME_TIMER->CR1 |= TIM_CR1_CEN;
+
+#endif
+
+#ifdef LOW_POWER_MODULE_ENABLED
+
+    /* Configure the low power timer to count the LSE continuously */
+    pclk_request(HC_LP_TIMER_CLOCK);
+    RCC->CCIPR |= (RCC_CCIPR_LPTIM1SEL_0 | RCC_CCIPR_LPTIM1SEL_1); // Clock from the LSE
+    HC_LP_TIMER->CR   = 0x00;                                      // Disable the timer
+    HC_LP_TIMER->CFGR = 0x00;                                      // No prescaler, internal clock
+    HC_LP_TIMER->IER  = LPTIM_IER_CMPMIE;                          // Can only be set while disabled
+
+    // ARR and CMP can only be written while the timer is enabled and each
+    // write takes a few LSE cycles to be loaded
+    HC_LP_TIMER->CR  = LPTIM_CR_ENABLE;
+    HC_LP_TIMER->ARR = HC_LP_TIMER_MAX_COUNT;
+    while ((HC_LP_TIMER->ISR & LPTIM_ISR_ARROK) == 0) {}
+    HC_LP_TIMER->ICR = LPTIM_ICR_ARROKCF;
+    HC_LP_TIMER->CMP = HC_LP_TIMER_MAX_COUNT;
+    HC_LP_TIMER->CR |= LPTIM_CR_CNTSTRT;
+
+    // The timer wakes the mcu from Stop 2 through EXTI line 32
+    EXTI->IMR2 |= EXTI_IMR2_IM32;
+
+    HAL_NVIC_SetPriority(HC_LP_TIMER_IRQn, HC_LP_TIMER_ISR_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(HC_LP_TIMER_IRQn);
+
+#endif
+
 #ifdef TASK_SCHEDULER_MODULE_ENABLED
 
 /* If the system clock is too high, this timer will count too quickly and the timer
@@ -230,56 +348,58 @@ void hardware_config_timer_init(void) {
     increase the timer frequency if you get this error. E.g: System clock = 1Mhz and
     timer frequnecy = 1Hz => timer should reset after 1 million ticks to get a frequnecy
     of 1Hz but the max count < 1 million thus 1Hz can never be reached */
-#    if ((SYSTEM_CLOCK_CORE / HC_TS_TIMER_FREQUENCY) > HC_TS_TIMER_MAX_COUNT)
+#    if ((MCU_CLOCK_TIMER_CLOCK_MAX / HC_TS_TIMER_FREQUENCY) > MCU_CLOCK_TIMER_PRESCALER_MAX)
 #        error System clock frequency is too high to generate the required timer frequnecy
 #    endif
 
     /* Configure timer for task scheduler*/
-    HC_TS_TIMER_CLK_ENABLE();                                         // Enable the clock
+    pclk_request(HC_TS_TIMER_CLOCK);                                  // Enable the clock
     HC_TS_TIMER->CR1 &= ~(TIM_CR1_CEN);                               // Disable counter
-    HC_TS_TIMER->PSC = (SystemCoreClock / HC_TS_TIMER_FREQUENCY) - 1; // Set timer frequency
+    HC_TS_TIMER->PSC = (mcu_clock_get_timer_clock() / HC_TS_TIMER_FREQUENCY) - 1; // Set timer frequency
     HC_TS_TIMER->ARR = HC_TS_TIMER_MAX_COUNT;                         // Set maximum count for timer
     HC_TS_TIMER->CNT = 0;                                             // Reset count to 0
     HC_TS_TIMER->DIER &= 0x00;                                        // Disable all interrupts by default
     HC_TS_TIMER->CCMR1 &= ~(TIM_CCMR1_CC1S | TIM_CCMR1_OC1M);         // Set CH1 capture compare to mode to frozen
+    HC_TS_TIMER->CCMR1 &= ~(TIM_CCMR1_CC2S | TIM_CCMR1_OC2M);         // Set CH2 (cyclic executive) to frozen too
 
     /* Enable interrupt handler */
     HAL_NVIC_SetPriority(HC_TS_TIMER_IRQn, HC_TS_TIMER_ISR_PRIORITY, 0);
     HAL_NVIC_EnableIRQ(HC_TS_TIMER_IRQn);
 
-#endif
-
-#ifdef SYNCHRONOUS_TIMER_MODULE_ENABLED
+    /* PendSV is always enabled, only its priority needs setting */
+    HAL_NVIC_SetPriority(PendSV_IRQn, HC_TS_PREEMPTIVE_ISR_PRIORITY, 0);
 
-#    if ((SYSTEM_CLOCK_CORE / HC_SYNC_TIMER_FREQUENCY) > HC_SYNC_TIMER_MAX_COUNT)
+#    if ((MCU_CLOCK_TIMER_CLOCK_MAX / HC_TSU_TIMER_FREQUENCY) > MCU_CLOCK_TIMER_PRESCALER_MAX)
 #        error System clock frequency is too high to generate the required timer frequnecy
 #    endif
 
-    /* Configure timer for task scheduler*/
-    HC_SYNC_TIMER_CLK_ENABLE();                                           // Enable the clock
-    HC_SYNC_TIMER->CR1 &= ~(TIM_CR1_CEN);                                 // Disable counter
-    HC_SYNC_TIMER->PSC = (SystemCoreClock / HC_SYNC_TIMER_FREQUENCY) - 1; // Set timer frequency
-    HC_SYNC_TIMER->ARR = HC_SYNC_TIMER_MAX_COUNT;                         // Set maximum count for timer
-    HC_SYNC_TIMER->CNT = 0;                                               // Reset count to 0
-    HC_SYNC_TIMER->DIER &= 0x00;                                          // Disable all interrupts by default
-    HC_SYNC_TIMER->CCMR1 &= ~(TIM_CCMR1_CC1S | TIM_CCMR1_OC1M);           // Set CH1 capture compare to mode to frozen
+    /* Configure timer for the microsecond lane of the task scheduler */
+    pclk_request(HC_TSU_TIMER_CLOCK);                                   // Enable the clock
+    HC_TSU_TIMER->CR1 &= ~(TIM_CR1_CEN);                                // Disable counter
+    HC_TSU_TIMER->CR1 |= TIM_CR1_URS;                                   // Only counter overflows set the update flag
+    HC_TSU_TIMER->PSC = (mcu_clock_get_timer_clock() / HC_TSU_TIMER_FREQUENCY) - 1; // Set timer frequency
+    HC_TSU_TIMER->EGR |= TIM_EGR_UG;                                    // Load the prescaler
+    HC_TSU_TIMER->ARR = HC_TSU_TIMER_MAX_COUNT;                         // Set maximum count for timer
+    HC_TSU_TIMER->CNT = 0;                                              // Reset count to 0
+    HC_TSU_TIMER->SR  = 0x00;                                           // Clear any pending interrupts
+    HC_TSU_TIMER->DIER |= TIM_DIER_UIE;                                 // The update is the only interrupt
 
-    /* Enable interrupt handler */
-    HAL_NVIC_SetPriority(HC_SYNC_TIMER_IRQn, HC_SYNC_TIMER_ISR_PRIORITY, 0);
-    HAL_NVIC_EnableIRQ(HC_SYNC_TIMER_IRQn);
+    HAL_NVIC_SetPriority(HC_TSU_TIMER_IRQn, HC_TSU_TIMER_ISR_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(HC_TSU_TIMER_IRQn);
 
 #endif
 
 #ifdef PIEZO_BUZZER_MODULE_ENABLED
 
-#    if ((SYSTEM_CLOCK_CORE / HC_PIEZO_BUZZER_TIMER_FREQUENCY) > HC_PIEZO_BUZZER_TIMER_MAX_COUNT)
+#    if ((MCU_CLOCK_TIMER_CLOCK_MAX / HC_PIEZO_BUZZER_TIMER_FREQUENCY) > MCU_CLOCK_TIMER_PRESCALER_MAX)
 #        error System clock frequency is too high to generate the required timer frequnecy for the piezo buzzer
 #    endif
 
-    /* Configure timer for piezo buzzer */
-    HC_PIEZO_BUZZER_TIMER_CLK_ENABLE();                                                   // Enable the clock
+    /* Configure timer for piezo buzzer. The registers keep their values once
+        the clock is released so only the buzzer needs to turn it back on */
+    pclk_request(HC_PIEZO_BUZZER_TIMER_CLOCK);                                            // Enable the clock
     HC_PIEZO_BUZZER_TIMER->CR1 &= ~(TIM_CR1_CEN);                                         // Disable counter
-    HC_PIEZO_BUZZER_TIMER->PSC = (SystemCoreClock / HC_PIEZO_BUZZER_TIMER_FREQUENCY) - 1; // Set timer frequency
+    HC_PIEZO_BUZZER_TIMER->PSC = (mcu_clock_get_timer_clock() / HC_PIEZO_BUZZER_TIMER_FREQUENCY) - 1; // Set timer frequency
     HC_PIEZO_BUZZER_TIMER->ARR = HC_PIEZO_BUZZER_TIMER_MAX_COUNT;                         // Set maximum count for timer
     HC_PIEZO_BUZZER_TIMER->CNT = 0;                                                       // Reset count to 0
     HC_PIEZO_BUZZER_TIMER->DIER &= 0x00; // Disable all interrupts by default
@@ -297,20 +417,23 @@ void hardware_config_timer_init(void) {
     HAL_NVIC_SetPriority(HC_PIEZO_BUZZER_TIMER_IRQn, HC_PIEZO_BUZZER_TIMER_ISR_PRIORITY, 0);
     HAL_NVIC_EnableIRQ(HC_PIEZO_BUZZER_TIMER_IRQn);
 
+    pclk_release(HC_PIEZO_BUZZER_TIMER_CLOCK);
+
 #endif
 
 #ifdef ENCODER_MODULE_ENABLED
 
-#    if ((SYSTEM_CLOCK_CORE / HC_ENCODER_1_TIMER_FREQUENCY) > HC_ENCODER_1_TIMER_MAX_COUNT)
+#    if ((MCU_CLOCK_TIMER_CLOCK_MAX / HC_ENCODER_1_TIMER_FREQUENCY) > MCU_CLOCK_TIMER_PRESCALER_MAX)
 #        error System clock frequency is too high to generate the required timer frequency for the encoder
 #    endif
 
-    // Enable the clock for the timer
-    HC_ENCODER_1_TIMER_CLK_ENABLE();
+    // Enable the clock for the timer while it is configured. The blind motor
+    // turns it back on whenever the motor moves
+    pclk_request(HC_ENCODER_1_TIMER_CLOCK);
 
     // Set the sampling rate. (I'm not 100% sure if this is required. I
     // tested changing it and it didn't seem to affect the output)
-    HC_ENCODER_1_TIMER->PSC = ((SystemCoreClock / HC_ENCODER_1_TIMER_FREQUENCY) - 1);
+    HC_ENCODER_1_TIMER->PSC = ((mcu_clock_get_timer_clock() / HC_ENCODER_1_TIMER_FREQUENCY) - 1);
 
     // Set the maximum count for the timer
     HC_ENCODER_1_TIMER->ARR = HC_ENCODER_1_TIMER_MAX_COUNT; // Set the maximum count
@@ -347,19 +470,21 @@ void hardware_config_timer_init(void) {
     HAL_NVIC_SetPriority(HC_ENCODER_1_TIMER_IRQn, HC_ENCODER_1_TIMER_ISR_PRIORITY, 0);
     HAL_NVIC_EnableIRQ(HC_ENCODER_1_TIMER_IRQn);
 
+    pclk_release(HC_ENCODER_1_TIMER_CLOCK);
+
     /****** START CODE BLOCK ******/
     // Description: Configuration for the second encoder
 
-#    if ((SYSTEM_CLOCK_CORE / HC_ENCODER_2_TIMER_FREQUENCY) > HC_ENCODER_2_TIMER_MAX_COUNT)
+#    if ((MCU_CLOCK_TIMER_CLOCK_MAX / HC_ENCODER_2_TIMER_FREQUENCY) > MCU_CLOCK_TIMER_PRESCALER_MAX)
 #        error System clock frequency is too high to generate the required timer frequency for the encoder
 #    endif
 
-    // Enable the clock for the timer
-    HC_ENCODER_2_TIMER_CLK_ENABLE();
+    // Enable the clock for the timer while it is configured
+    pclk_request(HC_ENCODER_2_TIMER_CLOCK);
 
     // Set the sampling rate. (I'm not 100% sure if this is required. I
     // tested changing it and it didn't seem to affect the output)
-    HC_ENCODER_2_TIMER->PSC = ((SystemCoreClock / HC_ENCODER_1_TIMER_FREQUENCY) - 1);
+    HC_ENCODER_2_TIMER->PSC = ((mcu_clock_get_timer_clock() / HC_ENCODER_1_TIMER_FREQUENCY) - 1);
 
     // Set the maximum count for the timer
     HC_ENCODER_2_TIMER->ARR = HC_ENCODER_1_TIMER_MAX_COUNT; // Set the maximum count
@@ -396,13 +521,69 @@ void hardware_config_timer_init(void) {
     HAL_NVIC_SetPriority(HC_ENCODER_2_TIMER_IRQn, HC_ENCODER_2_TIMER_ISR_PRIORITY, 0);
     HAL_NVIC_EnableIRQ(HC_ENCODER_2_TIMER_IRQn);
 
+    pclk_release(HC_ENCODER_2_TIMER_CLOCK);
+
     /****** END CODE BLOCK ******/
 
 #endif
 }
 
+/**
+ * @brief Loads a new prescaler into a running timer without moving its count.
+ * The prescaler only loads on an update event and forcing one resets the
+ * count so the count is put back afterwards. At most one tick is lost
+ *
+ * @param timer The timer
+ * @param frequency The frequency the timer counts at
+ */
+void hardware_config_retime_timer(TIM_TypeDef* timer, uint32_t frequency) {
+
+    uint32_t cr1   = timer->CR1;
+    uint32_t count = timer->CNT;
+
+    timer->CR1 |= TIM_CR1_URS; // The forced update must not set the update flag
+    timer->PSC = (mcu_clock_get_timer_clock() / frequency) - 1;
+    timer->EGR |= TIM_EGR_UG;
+    timer->CNT = count;
+    timer->CR1 = cr1;
+}
+
 void hardware_config_adc_init(void) {}
 
+void hardware_config_rtc_init(void) {
+
+#ifdef RTC_MODULE_ENABLED
+
+    // The rtc registers are in the backup domain which is write protected
+    // until DBP is set
+    RCC->APB1ENR1 |= (RCC_APB1ENR1_PWREN | RCC_APB1ENR1_RTCAPBEN);
+    PWR->CR1 |= PWR_CR1_DBP;
+
+    // The backup domain survives a reset so the clock source is only chosen
+    // once. Changing the source requires the backup domain to be reset
+    if ((RCC->BDCR & RCC_BDCR_RTCSEL) != RCC_BDCR_RTCSEL_0) {
+        RCC->BDCR |= RCC_BDCR_BDRST;
+        RCC->BDCR &= ~(RCC_BDCR_BDRST);
+
+        RCC->BDCR |= RCC_BDCR_LSEON;
+        while ((RCC->BDCR & RCC_BDCR_LSERDY) == 0) {}
+
+        RCC->BDCR |= RCC_BDCR_RTCSEL_0;
+    }
+
+    RCC->BDCR |= RCC_BDCR_RTCEN;
+
+    // The alarm interrupt is connected to EXTI line 18 on a rising edge
+    EXTI->IMR1 |= EXTI_IMR1_IM18;
+    EXTI->RTSR1 |= EXTI_RTSR1_RT18;
+    EXTI->FTSR1 &= ~(EXTI_FTSR1_FT18);
+
+    HAL_NVIC_SetPriority(HC_RTC_ALARM_IRQn, HC_RTC_ALARM_ISR_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(HC_RTC_ALARM_IRQn);
+
+#endif
+}
+
 /**
  * @brief USART2 Initialization Function
  * @param None
@@ -421,11 +602,11 @@ void hardware_config_uart_init(void) {
      */
 
     // Enable UART clock
-    HC_DEBUG_LOG_CLK_ENABLE();
+    pclk_request(HC_DEBUG_LOG_CLOCK);
     __HAL_RCC_PWR_CLK_ENABLE();
 
     // Set baud rate
-    USART2->BRR = SystemCoreClock / HC_DEBUG_LOG_BUAD_RATE;
+    USART2->BRR = mcu_clock_get_apb_clock() / HC_DEBUG_LOG_BUAD_RATE;
 
     // Enable the USART to let comms occur
     USART2->CR1 |= (USART_CR1_RE | USART_CR1_TE | USART_CR1_UE | USART_CR1_RXNEIE | USART_CR1_PEIE);
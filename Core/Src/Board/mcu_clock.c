@@ -1,73 +1,246 @@
 /**
  * @file mcu_clock.c
  * @author Gian Barta-Dougall
- * @brief File to initialise clock of microcontroller
+ * @brief Clock profiles of the microcontroller. The system runs from the
+ * 4MHz MSI when idle and can switch to the 80MHz PLL for bursts of work
  * @version 0.1
  * @date 2022-07-02
- * 
+ *
  * @copyright Copyright (c) 2022
- * 
+ *
  */
 
 /* Public Includes */
 
 /* Private Includes */
 #include "mcu_clock.h"
+#include "hardware_config.h"
+#include "residency.h"
+#include "utilities.h"
 
 /* STM32 Includes */
 
 /* Private #defines */
+#define MCU_CLOCK_PROFILE_INVALID(profile) (profile >= MCU_CLOCK_NUM_PROFILES)
 
-// Define system clocks
-#define CLK_100KHZ 0x00
-#define CLK_200KHZ 0x01
-#define CLK_400KHZ 0x03
-#define CLK_800KHZ 0x04
-#define CLK_1MHZ 0x05
-#define CLK_2MHZ 0x06
-#define CLK_4MHZ 0x07
-#define CLK_8MHZ 0x08
-#define CLK_16MHZ 0x09
-#define CLK_32MHZ 0x0A
-#define CLK_48MHZ 0x0B
-
-#define SYSTEM_CLOCK CLK_32MHZ
-
-uint32_t msiClockRanges[12] = {100000, 200000, 400000, \
-        800000, 1000000, 2000000, 4000000, 8000000, \
-        16000000, 24000000, 32000000, 48000000};
+// The PLL takes the 4MHz MSI with M = 1 and R = 2 so SYSCLK = 2MHz * N
+#define MCU_CLOCK_PLL_N_80MHZ 40
+
+/* Private Structures and Enumerations */
+
+typedef struct McuClockProfile {
+    const char* name;
+    uint32_t sysclk;
+    uint8_t apbDivider;
+    uint32_t apbPrescalerBits;
+    uint32_t flashLatency;
+    uint32_t voltageRange;
+    uint32_t pllN; // 0 if the system runs straight from the MSI
+} McuClockProfile;
 
 /* Variable Declarations */
-uint32_t systemClock;
 
-/* Function prototypes */
+/**
+ * Flash wait states come from the table in the reference manual: range 2 needs
+ * none up to 6MHz and range 1 needs 4 at 80MHz. The buses are divided by 4 at
+ * 80MHz so the timers see 40MHz, the 16 bit prescalers can't divide 80MHz down
+ * to the 1kHz the task scheduler counts at
+ */
+const McuClockProfile mcuClockProfiles[MCU_CLOCK_NUM_PROFILES] = {
+    [MCU_CLOCK_LOW_POWER] =
+        {
+            .name             = "low power",
+            .sysclk           = 4000000,
+            .apbDivider       = 1,
+            .apbPrescalerBits = RCC_CFGR_PPRE1_DIV1 | RCC_CFGR_PPRE2_DIV1,
+            .flashLatency     = FLASH_ACR_LATENCY_0WS,
+            .voltageRange     = PWR_CR1_VOS_1,
+            .pllN             = 0,
+        },
+    [MCU_CLOCK_PERFORMANCE] =
+        {
+            .name             = "performance",
+            .sysclk           = 80000000,
+            .apbDivider       = 4,
+            .apbPrescalerBits = RCC_CFGR_PPRE1_DIV4 | RCC_CFGR_PPRE2_DIV4,
+            .flashLatency     = FLASH_ACR_LATENCY_4WS,
+            .voltageRange     = PWR_CR1_VOS_0,
+            .pllN             = MCU_CLOCK_PLL_N_80MHZ,
+        },
+};
+
+uint8_t mcuClockProfile = MCU_CLOCK_LOW_POWER;
 
+/* Function prototypes */
+void mcu_clock_apply_profile(uint8_t profile);
+void mcu_clock_prepare(const McuClockProfile* next, uint8_t speedingUp);
+void mcu_clock_switch(uint8_t profile);
+void mcu_clock_finish(const McuClockProfile* next, uint8_t speedingUp);
+void mcu_clock_set_voltage_range(uint32_t voltageRange);
+void mcu_clock_set_flash_latency(uint32_t flashLatency);
 
 void mcu_clock_init(void) {
 
-    // Turn MSI clock off
-    RCC->CR &= ~(0x01);
+    // The LSE clocks the real time clock and trims the MSI. It is in the
+    // backup domain so writes must be enabled first
+    RCC->APB1ENR1 |= RCC_APB1ENR1_PWREN;
+    PWR->CR1 |= PWR_CR1_DBP;
+    RCC->BDCR &= ~(RCC_BDCR_LSEDRV); // Low drive
+    RCC->BDCR |= RCC_BDCR_LSEON;
+    while ((RCC->BDCR & RCC_BDCR_LSERDY) == 0) {}
+
+    // The MSI at 4MHz is the system clock in low power and the source of the
+    // PLL in performance. Locking it to the LSE keeps it accurate
+    RCC->CR = (RCC->CR & ~(RCC_CR_MSIRANGE)) | RCC_CR_MSIRANGE_6 | RCC_CR_MSIRGSEL;
+    RCC->CR |= RCC_CR_MSIPLLEN;
+
+    // Uart 2 is clocked from APB1 so its baud rate follows the profile
+    RCC->CCIPR &= ~(RCC_CCIPR_USART2SEL);
+
+    mcu_clock_apply_profile(MCU_CLOCK_LOW_POWER);
+}
+
+void mcu_clock_set_profile(uint8_t profile) {
+
+    if (MCU_CLOCK_PROFILE_INVALID(profile) || (profile == mcuClockProfile)) {
+        return;
+    }
+
+    const McuClockProfile* next = &mcuClockProfiles[profile];
+    uint8_t speedingUp          = (next->sysclk > SystemCoreClock) ? TRUE : FALSE;
+
+    // The slow parts of the switch, locking the PLL, changing the voltage and
+    // waiting for the uart to finish sending, are done with interrupts on
+    mcu_clock_prepare(next, speedingUp);
+    hardware_config_prepare_clock_change();
+
+    // Nothing can read a timer while it is being retimed
+    uint32_t primask;
+    ENTER_CRITICAL_SECTION(primask);
+    mcu_clock_switch(profile);
+    hardware_config_update_clocks();
+    EXIT_CRITICAL_SECTION(primask);
+
+    mcu_clock_finish(next, speedingUp);
+
+    // Run and sleep draw a different current in each profile
+    res_set_clock_profile(profile);
+}
+
+void mcu_clock_restore(void) {
+
+    // The voltage range and flash wait states are kept in Stop 2 so only the
+    // PLL needs starting again
+    if (mcuClockProfile != MCU_CLOCK_LOW_POWER) {
+        mcu_clock_apply_profile(mcuClockProfile);
+    }
+}
+
+uint8_t mcu_clock_get_profile(void) {
+    return mcuClockProfile;
+}
+
+const char* mcu_clock_get_profile_name(uint8_t profile) {
+
+    if (MCU_CLOCK_PROFILE_INVALID(profile)) {
+        return "unknown";
+    }
+
+    return mcuClockProfiles[profile].name;
+}
+
+uint32_t mcu_clock_get_apb_clock(void) {
+    return SystemCoreClock / mcuClockProfiles[mcuClockProfile].apbDivider;
+}
+
+uint32_t mcu_clock_get_timer_clock(void) {
+
+    uint8_t apbDivider = mcuClockProfiles[mcuClockProfile].apbDivider;
+
+    return (apbDivider == 1) ? SystemCoreClock : ((2 * SystemCoreClock) / apbDivider);
+}
+
+/* Private Functions */
+
+void mcu_clock_apply_profile(uint8_t profile) {
+
+    const McuClockProfile* next = &mcuClockProfiles[profile];
+    uint8_t speedingUp          = (next->sysclk > SystemCoreClock) ? TRUE : FALSE;
+
+    mcu_clock_prepare(next, speedingUp);
+    mcu_clock_switch(profile);
+    mcu_clock_finish(next, speedingUp);
+}
+
+void mcu_clock_prepare(const McuClockProfile* next, uint8_t speedingUp) {
+
+    // The core needs the higher voltage and the flash needs more wait states
+    // before the clock goes up
+    if (speedingUp == TRUE) {
+        mcu_clock_set_voltage_range(next->voltageRange);
+        mcu_clock_set_flash_latency(next->flashLatency);
+    }
+
+    // The PLL is locked while the system still runs from the MSI. It can only
+    // be configured while it is off
+    if ((next->pllN != 0) && ((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_PLL)) {
+
+        RCC->CR &= ~(RCC_CR_PLLON);
+        while ((RCC->CR & RCC_CR_PLLRDY) != 0) {}
+
+        // M = 1 and R = 2 are both 0 in the register
+        RCC->PLLCFGR = RCC_PLLCFGR_PLLSRC_MSI | (next->pllN << RCC_PLLCFGR_PLLN_Pos) | RCC_PLLCFGR_PLLREN;
+
+        RCC->CR |= RCC_CR_PLLON;
+        while ((RCC->CR & RCC_CR_PLLRDY) == 0) {}
+    }
+}
+
+void mcu_clock_switch(uint8_t profile) {
+
+    const McuClockProfile* next = &mcuClockProfiles[profile];
+
+    // The buses are divided down before the clock goes up and only divided
+    // less once it has come down so they are never run too fast
+    if (next->pllN == 0) {
+        RCC->CFGR = (RCC->CFGR & ~(RCC_CFGR_SW)) | RCC_CFGR_SW_MSI;
+        while ((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_MSI) {}
+        RCC->CFGR = (RCC->CFGR & ~(RCC_CFGR_PPRE1 | RCC_CFGR_PPRE2)) | next->apbPrescalerBits;
+    } else {
+        RCC->CFGR = (RCC->CFGR & ~(RCC_CFGR_PPRE1 | RCC_CFGR_PPRE2)) | next->apbPrescalerBits;
+        RCC->CFGR = (RCC->CFGR & ~(RCC_CFGR_SW)) | RCC_CFGR_SW_PLL;
+        while ((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_PLL) {}
+    }
+
+    mcuClockProfile = profile;
+    SystemCoreClockUpdate();
+
+    // HAL_Delay() counts SysTick interrupts which must stay at 1ms
+    HAL_InitTick(uwTickPrio);
+}
 
-    RCC->CR |= (0x01 << 3); // Set MSI clock range to operate on RCC_CR register
+void mcu_clock_finish(const McuClockProfile* next, uint8_t speedingUp) {
 
-    // Set MSI clock to operate at 32Mhz
-    RCC->CR &= ~(0x0F << 4); // Reset the MSI clock range
-    RCC->CR |= (SYSTEM_CLOCK << 4); // Set the MSI clock range to 32Mhz
+    if (next->pllN == 0) {
+        RCC->CR &= ~(RCC_CR_PLLON);
+        while ((RCC->CR & RCC_CR_PLLRDY) != 0) {}
+    }
 
-    // Turn MSI clock on
-    RCC->CR |= 0x01;
+    // The voltage and wait states can only come down once the clock has
+    if (speedingUp == FALSE) {
+        mcu_clock_set_flash_latency(next->flashLatency);
+        mcu_clock_set_voltage_range(next->voltageRange);
+    }
+}
 
-    // Store the system clock
-    systemClock = msiClockRanges[SYSTEM_CLOCK];
+void mcu_clock_set_voltage_range(uint32_t voltageRange) {
+    PWR->CR1 = (PWR->CR1 & ~(PWR_CR1_VOS)) | voltageRange;
+    while ((PWR->SR2 & PWR_SR2_VOSF) != 0) {}
+}
 
-    // Wait for MSI clock to stabalise
-    while ((RCC->CR & (0x01 << 1)) == 0) {}
+void mcu_clock_set_flash_latency(uint32_t flashLatency) {
 
-    // Set MCO output prescaler to 1
-    RCC->CFGR &= ~(0x07 << 28); // Set MCO prescaler to 1
-    RCC->CFGR &= ~(0x0F << 24); // Reset MCU clock output
-    RCC->CFGR |= (0x02 << 24); // Set MSI clock as MCU clock output
-    
-    RCC->CFGR &= ~(0x07 << 11); // Set APB2 prescaler to 1
-    RCC->CFGR &= ~(0x07 << 8); // Set APB1 prescaler to 1
-}
\ No newline at end of file
+    // Read the latency back to make sure it has taken effect
+    FLASH->ACR = (FLASH->ACR & ~(FLASH_ACR_LATENCY)) | flashLatency;
+    while ((FLASH->ACR & FLASH_ACR_LATENCY) != flashLatency) {}
+}
@@ -0,0 +1,173 @@
+/**
+ * @file peripheral_clock.c
+ * @author Gian Barta-Dougall
+ * @brief Reference counted bus clocks of the peripherals. Drivers request a
+ * clock before touching a peripheral and release it when they are done. The
+ * clock is only gated once every request has been released
+ * @version 0.1
+ * @date --
+ *
+ * @copyright Copyright (c)
+ *
+ */
+/* Public Includes */
+
+/* Private Includes */
+#include "peripheral_clock.h"
+#include "utilities.h"
+#include "log.h"
+
+/* Private STM Includes */
+
+/* Private #defines */
+#define PCLK_INVALID(clock) (clock >= PCLK_NUM_CLOCKS)
+
+/* Private Structures and Enumerations */
+
+typedef struct PeripheralClock {
+    const char* name;
+    volatile uint32_t* enableRegister;
+    uint32_t enableBit;
+} PeripheralClock;
+
+/* Private Variable Declarations */
+
+const PeripheralClock peripheralClocks[PCLK_NUM_CLOCKS] = {
+    [PCLK_GPIOA]  = {.name = "GPIOA", .enableRegister = &RCC->AHB2ENR, .enableBit = RCC_AHB2ENR_GPIOAEN},
+    [PCLK_GPIOB]  = {.name = "GPIOB", .enableRegister = &RCC->AHB2ENR, .enableBit = RCC_AHB2ENR_GPIOBEN},
+    [PCLK_TIM1]   = {.name = "TIM1", .enableRegister = &RCC->APB2ENR, .enableBit = RCC_APB2ENR_TIM1EN},
+    [PCLK_TIM2]   = {.name = "TIM2", .enableRegister = &RCC->APB1ENR1, .enableBit = RCC_APB1ENR1_TIM2EN},
+    [PCLK_TIM6]   = {.name = "TIM6", .enableRegister = &RCC->APB1ENR1, .enableBit = RCC_APB1ENR1_TIM6EN},
+    [PCLK_TIM7]   = {.name = "TIM7", .enableRegister = &RCC->APB1ENR1, .enableBit = RCC_APB1ENR1_TIM7EN},
+    [PCLK_TIM15]  = {.name = "TIM15", .enableRegister = &RCC->APB2ENR, .enableBit = RCC_APB2ENR_TIM15EN},
+    [PCLK_TIM16]  = {.name = "TIM16", .enableRegister = &RCC->APB2ENR, .enableBit = RCC_APB2ENR_TIM16EN},
+    [PCLK_USART2] = {.name = "USART2", .enableRegister = &RCC->APB1ENR1, .enableBit = RCC_APB1ENR1_USART2EN},
+    [PCLK_ADC]    = {.name = "ADC", .enableRegister = &RCC->AHB2ENR, .enableBit = RCC_AHB2ENR_ADCEN},
+    [PCLK_LPTIM1] = {.name = "LPTIM1", .enableRegister = &RCC->APB1ENR1, .enableBit = RCC_APB1ENR1_LPTIM1EN},
+};
+
+// Number of requests holding each clock
+uint8_t pclkRequests[PCLK_NUM_CLOCKS] = {0};
+
+/* Private Function Prototypes */
+
+/* Public Functions */
+
+void pclk_request(uint8_t clock) {
+
+    if (PCLK_INVALID(clock)) {
+        return;
+    }
+
+    uint32_t primask;
+    ENTER_CRITICAL_SECTION(primask);
+
+    if (pclkRequests[clock] == 0) {
+        *peripheralClocks[clock].enableRegister |= peripheralClocks[clock].enableBit;
+
+        // The peripheral can't be written until two bus cycles after its clock
+        // is enabled. Reading the enable register back waits long enough
+        (void)*peripheralClocks[clock].enableRegister;
+    }
+
+    pclkRequests[clock]++;
+
+    EXIT_CRITICAL_SECTION(primask);
+}
+
+void pclk_release(uint8_t clock) {
+
+    if (PCLK_INVALID(clock)) {
+        return;
+    }
+
+    uint32_t primask;
+    ENTER_CRITICAL_SECTION(primask);
+
+    // A release without a request would gate a clock someone else still needs
+    if (pclkRequests[clock] != 0) {
+        pclkRequests[clock]--;
+
+        if (pclkRequests[clock] == 0) {
+            *peripheralClocks[clock].enableRegister &= ~(peripheralClocks[clock].enableBit);
+        }
+    }
+
+    EXIT_CRITICAL_SECTION(primask);
+}
+
+uint8_t pclk_is_live(uint8_t clock) {
+
+    if (PCLK_INVALID(clock)) {
+        return FALSE;
+    }
+
+    return ((*peripheralClocks[clock].enableRegister & peripheralClocks[clock].enableBit) != 0) ? TRUE : FALSE;
+}
+
+void pclk_print(void) {
+
+    char m[40];
+
+    for (uint8_t i = 0; i < PCLK_NUM_CLOCKS; i++) {
+        sprintf(m, "%s: %s (%i)\r\n", peripheralClocks[i].name, (pclk_is_live(i) == TRUE) ? "on" : "off",
+                pclkRequests[i]);
+        log_prints(m);
+    }
+}
+
+/* Private Functions */
+
+/************************************ UNIT TESTING ************************************/
+
+#if (PROJECT_STATUS == UNIT_TESTS)
+uint8_t pclkTestsFailed = 0;
+
+#    define PCLK_ASSERT(test)                                                                       \
+        do {                                                                                        \
+            if (!(test)) {                                                                          \
+                char msg[100];                                                                      \
+                sprintf(msg, "Unit test failed in File %s line number %d\r\n", __FILE__, __LINE__); \
+                log_prints(msg);                                                                    \
+                pclkTestsFailed++;                                                                  \
+            }                                                                                       \
+        } while (0)
+
+/* Function definitions */
+void pclk_reference_count_test(void);
+
+void pclk_run_unit_tests(void) {
+    log_prints("STARTING PERIPHERAL CLOCK TESTS\r\n");
+
+    pclk_reference_count_test();
+
+    char m[50];
+    sprintf(m, "PERIPHERAL CLOCK TESTS FAILED: %i\r\n", pclkTestsFailed);
+    log_prints(m);
+}
+
+void pclk_reference_count_test(void) {
+
+    // The piezo buzzer is silent during the tests so nothing else holds its clock
+    uint8_t requests = pclkRequests[PCLK_TIM16];
+    PCLK_ASSERT(requests == 0);
+    PCLK_ASSERT(pclk_is_live(PCLK_TIM16) == FALSE);
+
+    pclk_request(PCLK_TIM16);
+    pclk_request(PCLK_TIM16);
+    PCLK_ASSERT(pclk_is_live(PCLK_TIM16) == TRUE);
+    PCLK_ASSERT(pclkRequests[PCLK_TIM16] == 2);
+
+    // The clock stays on until the last request is released
+    pclk_release(PCLK_TIM16);
+    PCLK_ASSERT(pclk_is_live(PCLK_TIM16) == TRUE);
+    pclk_release(PCLK_TIM16);
+    PCLK_ASSERT(pclk_is_live(PCLK_TIM16) == FALSE);
+
+    // Releasing a clock that isn't held must not wrap the count
+    pclk_release(PCLK_TIM16);
+    PCLK_ASSERT(pclkRequests[PCLK_TIM16] == 0);
+
+    PCLK_ASSERT(pclk_is_live(PCLK_NUM_CLOCKS) == FALSE);
+}
+#endif
@@ -15,6 +15,8 @@
 /* Private Includes */
 #include "utilities.h"
 #include "button.h"
+#include "event_queue.h"
+#include "low_power.h"
 
 /**
  * @brief Interrupt routine for EXTI1
@@ -41,7 +43,7 @@ void EXTI0_IRQHandler(void) {
  * @brief Interrupt routine for EXTI1
  *
  */
-void EXTI1_IRQHandler(void) {
+RAM_FUNCTION void EXTI1_IRQHandler(void) {
     // log_prints("EXTI 1\r\n");
     // Clear the pending interrupt call
     NVIC_ClearPendingIRQ(EXTI1_IRQn);
@@ -103,7 +105,10 @@ void EXTI3_IRQHandler(void) {
  *
  */
 void EXTI4_IRQHandler(void) {
-    log_prints("EXTI 4\r\n");
+    // Logged from the main loop. Writing to the uart here would block
+    // every other interrupt of the same priority
+    event_queue_push(EQ_PRIORITY_5_QUEUE_ID, EVENT_INTERRUPT_LOG, EXTI4_IRQn);
+
     // Clear the pending interrupt call
     NVIC_ClearPendingIRQ(EXTI4_IRQn);
 
@@ -123,7 +128,7 @@ void EXTI4_IRQHandler(void) {
  * @brief Interrupt handler for EXTI5 - EXTI9
  *
  */
-void EXTI9_5_IRQHandler(void) {
+RAM_FUNCTION void EXTI9_5_IRQHandler(void) {
     // log_prints("EXTI 9_5\r\n");
 
     // Clear the pending interrupt call
@@ -184,11 +189,20 @@ void EXTI9_5_IRQHandler(void) {
  * @brief Interrupt handler for EXTI10 - EXTI15
  *
  */
-void EXTI15_10_IRQHandler(void) {
-    log_prints("EXTI 15 10\r\n");
+RAM_FUNCTION void EXTI15_10_IRQHandler(void) {
+
     // Clear the pending interrupt call
     NVIC_ClearPendingIRQ(EXTI15_10_IRQn);
 
+    // EXTI line 15 is the uart rx pin. It is only unmasked while in Stop 2
+    if ((EXTI->PR1 & EXTI_PR1_PIF15) == EXTI_PR1_PIF15) {
+        lp_serial_wake_isr();
+        return;
+    }
+
+    // Logged from the main loop like EXTI4
+    event_queue_push(EQ_PRIORITY_5_QUEUE_ID, EVENT_INTERRUPT_LOG, EXTI15_10_IRQn);
+
     // // Confirm pending interrupt exists on EXTI line 10
     // if ((EXTI->PR1 & EXTI_PR1_PIF10) == EXTI_PR1_PIF10) {
 
@@ -251,7 +265,9 @@ void EXTI15_10_IRQHandler(void) {
 }
 
 void COMP_IRQHandler(void) {
-    log_prints("EXTI COMP\r\n");
+    // Logged from the main loop like EXTI4
+    event_queue_push(EQ_PRIORITY_5_QUEUE_ID, EVENT_INTERRUPT_LOG, COMP_IRQn);
+
     // Clear the pending interrupt call
     NVIC_ClearPendingIRQ(COMP_IRQn);
 
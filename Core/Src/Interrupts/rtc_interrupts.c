@@ -0,0 +1,25 @@
+/**
+ * @file rtc_interrupts.c
+ * @author Gian Barta-Dougall
+ * @brief File to store interrupt handlers for the real time clock for STM32L432KC mcu
+ * @version 0.1
+ * @date --
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+/* Public Includes */
+#include "stm32l432xx.h"
+
+/* Private Includes */
+#include "real_time_clock.h"
+
+void RTC_Alarm_IRQHandler(void) {
+
+    // The alarm passes its event to the main loop which runs the schedule
+    rtc_alarm_isr();
+
+    // The alarm interrupt comes through EXTI line 18 so its pending bit must
+    // be cleared as well as the alarm flag
+    EXTI->PR1 = EXTI_PR1_PIF18;
+}
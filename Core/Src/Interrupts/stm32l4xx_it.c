@@ -1,6 +1,7 @@
 #include "main.h"
 #include "stm32l4xx_it.h"
 #include "log.h"
+#include "task_scheduler_1.h"
 
 /**
  * @brief This function handles Non maskable interrupt.
@@ -66,7 +67,8 @@ void DebugMon_Handler(void) {
  * @brief This function handles Pendable request for system service.
  */
 void PendSV_Handler(void) {
-    log_prints("Pendable request\r\n");
+    // Pended by the task scheduler when preemptive tasks are due
+    ts_preemptive_isr();
 }
 
 /**
@@ -15,8 +15,15 @@
 #include "blind.h"
 #include "utilities.h"
 #include "task_scheduler_1.h"
+#include "cyclic_executive.h"
+#include "task_scheduler_us.h"
 #include "piezo_buzzer.h"
 #include "encoder.h"
+#include "blind_motor.h"
+#include "event_queue.h"
+#include "monotonic_time.h"
+#include "low_power.h"
+#include "cycle_counter.h"
 
 /* STM32 Includes */
 #include "stm32l432xx.h"
@@ -25,7 +32,9 @@
 /**
  * @brief Interrupt handler for timer 1 and timer 15
  */
-void TIM1_BRK_TIM15_IRQHandler(void) {
+RAM_FUNCTION void TIM1_BRK_TIM15_IRQHandler(void) {
+    CC_MARK_ISR_ENTRY();
+
     // char m[50];
     // sprintf(m, "TIM 1 15 ---> CNT: %lu\tSR: %lu\r\n", TIM15->CNT, TIM15->SR);
     // log_prints(m);
@@ -38,6 +47,7 @@ void TIM1_BRK_TIM15_IRQHandler(void) {
         TIM15->SR = ~TIM_SR_UIF;
 
         /* Call required functions */
+        ts_overflow_isr();
     }
 
     // Check and clear CCR1 flag for TIM15
@@ -47,7 +57,9 @@ void TIM1_BRK_TIM15_IRQHandler(void) {
         TIM15->SR = ~TIM_SR_CC1IF;
 
         /* Call required functions */
+        uint32_t start = CC_GET_CYCLES();
         ts_isr();
+        ts_record_isr_cycles(CC_CYCLES_SINCE(start));
     }
 
     // Check and clear CCR2 flag for TIM15
@@ -57,6 +69,28 @@ void TIM1_BRK_TIM15_IRQHandler(void) {
         TIM15->SR = ~TIM_SR_CC2IF;
 
         /* Call required functions */
+        ce_isr();
+    }
+}
+
+/**
+ * @brief Interrupt handler for timer 6
+ */
+RAM_FUNCTION void TIM6_DAC_IRQHandler(void) {
+
+    // The flag is cleared by the monotonic time when the overflow is counted
+    if ((TIM6->SR & TIM_SR_UIF) == TIM_SR_UIF) {
+        time_overflow_isr();
+    }
+}
+
+/**
+ * @brief Interrupt handler for low power timer 1
+ */
+void LPTIM1_IRQHandler(void) {
+
+    if ((LPTIM1->ISR & LPTIM_ISR_CMPM) == LPTIM_ISR_CMPM) {
+        lp_timer_isr();
     }
 }
 
@@ -120,7 +154,7 @@ void TIM1_TRG_COM_IRQHandler(void) {
 /**
  * @brief Capture compare interrupt handler for timer 1
  */
-void TIM1_CC_IRQHandler(void) {
+RAM_FUNCTION void TIM1_CC_IRQHandler(void) {
     // log_prints("ISR TIM CC\r\n");
     // Check for overflow flag
 
@@ -136,15 +170,11 @@ void TIM1_CC_IRQHandler(void) {
 
         /* Call required functions */
 
-        // Call encoder isr to turn motor off
-        log_prints("REACHED MAX HEIGHT\r\n");
-
-        // Stopping blind from ISR ensures the blind stops whilst the
-        // encoder still reads high. This means the system can always
-        // assume if it reads the encoder pin whilst the motor is not
-        // moving and the encoder is not high then the encoder is not
-        // connected
-        blind_stop_moving(BLIND_1_ID);
+        // Brake straight away so the blind stops whilst the encoder still
+        // reads high. Logging and the rest of stopping the blind is left
+        // to the main loop
+        bm_encoder_limit_reached_isr(ENCODER_1_ID);
+        event_queue_push(EQ_PRIORITY_5_QUEUE_ID, EVENT_ENCODER_MAX_HEIGHT_REACHED, ENCODER_1_ID);
     }
 
     // Check if interrupt for CC3 was triggered
@@ -155,15 +185,11 @@ void TIM1_CC_IRQHandler(void) {
 
         /* Call required functions */
 
-        // Call encoder isr to turn motor off
-        log_prints("REACHED MIN HEIGHT\r\n");
-
-        // Stopping blind from ISR ensures the blind stops whilst the
-        // encoder still reads high. This means the system can always
-        // assume if it reads the encoder pin whilst the motor is not
-        // moving and the encoder is not high then the encoder is not
-        // connected
-        blind_stop_moving(BLIND_1_ID);
+        // Brake straight away so the blind stops whilst the encoder still
+        // reads high. Logging and the rest of stopping the blind is left
+        // to the main loop
+        bm_encoder_limit_reached_isr(ENCODER_1_ID);
+        event_queue_push(EQ_PRIORITY_5_QUEUE_ID, EVENT_ENCODER_MIN_HEIGHT_REACHED, ENCODER_1_ID);
     }
 }
 
@@ -179,7 +205,7 @@ void TIM1_IRQHandler(void) {
  * @brief Interrupt handler for timer 2
  *
  */
-void TIM2_IRQHandler(void) {
+RAM_FUNCTION void TIM2_IRQHandler(void) {
 
     // Check for event
     if ((TIM2->SR & TIM_SR_UIF) == TIM_SR_UIF) {
@@ -233,6 +259,18 @@ void TIM2_IRQHandler(void) {
  * @brief Interrupt handler for timer 7
  *
  */
-void TIM7_IRQHandler(void) {
-    log_prints("IRW\r\n");
+RAM_FUNCTION void TIM7_IRQHandler(void) {
+
+    // Check and clear overflow flag. The isr can also be pended by the
+    // scheduler lane without the flag being set
+    if ((TIM7->SR & TIM_SR_UIF) == TIM_SR_UIF) {
+
+        // Clear the UIF flag
+        TIM7->SR = ~TIM_SR_UIF;
+
+        /* Call required functions */
+        tsu_overflow_isr();
+    }
+
+    tsu_isr();
 }
\ No newline at end of file
@@ -12,8 +12,7 @@
 #include "stm32l432xx.h"
 
 /* Private Includes */
-#include "serial_comms.h"
-#include "log.h"
+#include "event_queue.h"
 
 void USART2_IRQHandler(void) {
 
@@ -29,11 +28,13 @@ void USART2_IRQHandler(void) {
         // Print the character to the console
         USART2->TDR = c;
 
-        // Copy bit into buffer. Reading RDR automatically clears flag
-        serial_comms_add_to_buffer(c);
+        // Hand the character to the main loop which processes the command.
+        // Reading RDR automatically clears flag
+        event_queue_push(EQ_MAX_PRIORITY_QUEUE_ID, EVENT_SERIAL_CHARACTER_RECEIVED, c);
     }
 
     if ((USART2->ISR & USART_ISR_PE) != 0) {
-        log_prints("Parity error\r\n");
+        USART2->ICR = USART_ICR_PECF;
+        event_queue_push(EQ_MAX_PRIORITY_QUEUE_ID, EVENT_SERIAL_PARITY_ERROR, 0);
     }
 }
\ No newline at end of file
@@ -20,6 +20,7 @@
 #include "blind_motor.h"
 #include "led.h"
 #include "hardware_config.h"
+#include "solar.h"
 
 /* Private STM Includes */
 
@@ -50,33 +51,35 @@
 
 /* Private Structures and Enumerations */
 
+void blind_switch_to_day_light_mode(void* context);
+
+// Shared by every blind. The blind the task is for is given as the context
 const struct Task1 switchBlindToDayLightModeTask = {
-    .delay      = 5000,
-    .functionId = FUNC_ID_SWITCH_BLIND_MODE_TO_DAYLIGHT,
-    .group      = BLIND_GROUP,
-    .nextTask   = NULL,
+    .delay    = 5000,
+    .handler  = blind_switch_to_day_light_mode,
+    .nextTask = NULL,
 };
 
 Blind Blind1 = {
-    .id                       = BLIND_1_ID,
-    .blindMotorId             = BLIND_MOTOR_1_ID,
-    .alSensorId               = AL_SENSOR_1_ID,
-    .userInterfaceId          = USER_INTERFACE_1_ID,
-    .switchToDayLightModeTask = switchBlindToDayLightModeTask,
-    .mode                     = DAY_LIGHT,
-    .previousMode             = DAY_LIGHT,
-    .status                   = DISCONNECTED,
+    .id                             = BLIND_1_ID,
+    .blindMotorId                   = BLIND_MOTOR_1_ID,
+    .alSensorId                     = AL_SENSOR_1_ID,
+    .userInterfaceId                = USER_INTERFACE_1_ID,
+    .switchToDayLightModeTaskHandle = TS_INVALID_HANDLE,
+    .mode                           = DAY_LIGHT,
+    .previousMode                   = DAY_LIGHT,
+    .status                         = DISCONNECTED,
 };
 
 Blind Blind2 = {
-    .id                       = BLIND_2_ID,
-    .blindMotorId             = BLIND_MOTOR_2_ID,
-    .alSensorId               = AL_SENSOR_2_ID,
-    .userInterfaceId          = USER_INTERFACE_2_ID,
-    .switchToDayLightModeTask = switchBlindToDayLightModeTask,
-    .mode                     = DAY_LIGHT,
-    .previousMode             = DAY_LIGHT,
-    .status                   = DISCONNECTED,
+    .id                             = BLIND_2_ID,
+    .blindMotorId                   = BLIND_MOTOR_2_ID,
+    .alSensorId                     = AL_SENSOR_2_ID,
+    .userInterfaceId                = USER_INTERFACE_2_ID,
+    .switchToDayLightModeTaskHandle = TS_INVALID_HANDLE,
+    .mode                           = DAY_LIGHT,
+    .previousMode                   = DAY_LIGHT,
+    .status                         = DISCONNECTED,
 };
 
 /* Private Variable Declarations */
@@ -204,7 +207,7 @@ void blind_set_bif_mode(uint8_t mode) {
     // mode is selected in case the user clicked day light mode and then
     // clicked manual mode before the daylight mode could take affect
     if (blindInFocus->mode == BLIND_MODE_MANUAL) {
-        ts_cancel_running_task(&blindInFocus->switchToDayLightModeTask);
+        ts_cancel_running_task(&blindInFocus->switchToDayLightModeTaskHandle);
     }
 
     // To set the mode back to normal, the encoder min max
@@ -253,6 +256,11 @@ void blind_toggle_bif(void) {
 
 /* Private Functions */
 
+void blind_switch_to_day_light_mode(void* context) {
+    Blind* blind = (Blind*)context;
+    blind->mode  = DAY_LIGHT;
+}
+
 void blind_set_bif(Blind* blind) {
 
     user_interface_off(blindInFocus->userInterfaceId);
@@ -283,37 +291,31 @@ void blind_user_interface_on(Blind* blind) {
 
 void blind_process_internal_flags(void) {
 
-    if (FLAG_IS_SET(blindTasksFlag, FUNC_ID_BLINK_RED_LED)) {
-        FLAG_CLEAR(blindTasksFlag, FUNC_ID_BLINK_RED_LED);
-        led_toggle(LED_RED_ID);
-    }
-
-    if (FLAG_IS_SET(blindTasksFlag, FUNC_ID_BLINK_ORANGE_LED)) {
-        FLAG_CLEAR(blindTasksFlag, FUNC_ID_BLINK_ORANGE_LED);
-        led_toggle(LED_ORANGE_ID);
-    }
-
-    if (FLAG_IS_SET(blindTasksFlag, FUNC_ID_SWITCH_BLIND_MODE_TO_DAYLIGHT)) {
-        FLAG_CLEAR(blindTasksFlag, FUNC_ID_SWITCH_BLIND_MODE_TO_DAYLIGHT);
-        blindInFocus->mode = DAY_LIGHT;
-    }
-
-    if (FLAG_IS_SET(blindTasksFlag, FUNC_ID_PLAY_CONFIG_SETTINGS_SOUND)) {
-        FLAG_CLEAR(blindTasksFlag, FUNC_ID_PLAY_CONFIG_SETTINGS_SOUND);
-        piezo_buzzer_play_sound(SOUND);
-    }
-
     if (FLAG_IS_SET(blindTasksFlag, FUNC_ID_BLINDS_DAY_LIGHT_UPDATE)) {
         FLAG_CLEAR(blindTasksFlag, FUNC_ID_BLINDS_DAY_LIGHT_UPDATE);
         // log_prints("Light update occured\r\n");
 
+        // The sunrise and sunset decide whether it is light outside. The light
+        // sensor is only used close to them, or if the time isn't known, so
+        // clouds in the middle of the day don't move the blinds
+        uint8_t solarPeriod = solar_get_period();
+        uint8_t useSensor   = (solarPeriod == SOLAR_UNKNOWN) || (solar_is_twilight() == TRUE);
+
         for (uint8_t i = 0; i < NUM_BLINDS; i++) {
 
             if (blinds[i]->mode != DAY_LIGHT) {
                 continue;
             }
 
-            if (PIN_IDR_IS_HIGH(HC_ALS_PORT_1, HC_ALS_PIN_1)) {
+            uint8_t lightFound;
+            if ((useSensor == FALSE) ||
+                ((solarPeriod != SOLAR_UNKNOWN) && (al_sensor_status(blinds[i]->alSensorId) == DISCONNECTED))) {
+                lightFound = (solarPeriod == SOLAR_DAY) ? TRUE : FALSE;
+            } else {
+                lightFound = PIN_IDR_IS_HIGH(HC_ALS_PORT_1, HC_ALS_PIN_1) ? TRUE : FALSE;
+            }
+
+            if (lightFound == TRUE) {
                 bm_move_blind(blinds[i]->blindMotorId, BLIND_UP);
             } else {
                 bm_move_blind(blinds[i]->blindMotorId, BLIND_DOWN);
@@ -337,7 +339,4 @@ void blind_process_internal_flags(void) {
             // }
         }
     }
-
-    // Process internal flags of lower level abstraction layers
-    bm_process_internal_flags();
 }
\ No newline at end of file
@@ -52,9 +52,6 @@
 
 enum BlindMotorEnums {
     FUNC_ID_TIMEOUT_REACHED,
-    FUNC_ID_CONFIRM_ENCODER_1_IN_OPERATION,
-    FUNC_ID_CONFIRM_ENCODER_2_IN_OPERATION,
-    FUNC_ID_PRINT_TIMER_COUNT,
 };
 
 enum BlindMotorModes {
@@ -69,25 +66,32 @@ const struct Task1 TimeoutTask = {
     .nextTask   = NULL,
 };
 
+void bm_confirm_encoder_in_operation(void* context);
+void bm_print_timer_count(void* context);
+void bm_release_encoder_clock(void* context);
+
 struct Task1 printTimerCount = {
-    .delay      = 500,
-    .functionId = FUNC_ID_PRINT_TIMER_COUNT,
-    .group      = BLIND_MOTOR_GROUP,
-    .nextTask   = &printTimerCount,
+    .delay    = 500,
+    .handler  = bm_print_timer_count,
+    .nextTask = &printTimerCount,
 };
 
-struct Task1 encoder1InOperation = {
-    .delay      = 500,
-    .functionId = FUNC_ID_CONFIRM_ENCODER_1_IN_OPERATION,
-    .group      = BLIND_MOTOR_GROUP,
-    .nextTask   = &encoder1InOperation,
+// Shared by every blind motor. The blind motor the task is for is given as the context.
+// Preemptive so a stalled motor is stopped on time regardless of the main loop
+struct Task1 encoderInOperationTask = {
+    .delay    = 500,
+    .slack    = 20,
+    .handler  = bm_confirm_encoder_in_operation,
+    .priority = TS_PRIORITY_PREEMPTIVE,
+    .nextTask = &encoderInOperationTask,
 };
 
-struct Task1 encoder2InOperation = {
-    .delay      = 500,
-    .functionId = FUNC_ID_CONFIRM_ENCODER_2_IN_OPERATION,
-    .group      = BLIND_MOTOR_GROUP,
-    .nextTask   = &encoder2InOperation,
+// Shared by every blind motor. The encoder keeps counting for a while after
+// the motor brakes so the blind coasting to a stop is still measured
+const struct Task1 encoderSettleTask = {
+    .delay    = 200,
+    .handler  = bm_release_encoder_clock,
+    .nextTask = NULL,
 };
 
 typedef struct BlindMotor {
@@ -95,37 +99,44 @@ typedef struct BlindMotor {
     uint8_t encoderId;
     uint8_t motorId;
     uint32_t lastEncoderCount;
-    Task1* encoderCheckingTask;
+    TsHandle encoderCheckingTaskHandle;
+    TsHandle encoderSettleTaskHandle;
+    uint8_t encoderClockOn;
     uint8_t mode;
 } BlindMotor;
 
 BlindMotor BlindMotor1 = {
-    .id                  = BLIND_MOTOR_1_ID,
-    .encoderId           = ENCODER_1_ID,
-    .motorId             = MOTOR_1_ID,
-    .lastEncoderCount    = 0,
-    .encoderCheckingTask = &encoder1InOperation,
-    .mode                = DISCONNECTED,
+    .id                        = BLIND_MOTOR_1_ID,
+    .encoderId                 = ENCODER_1_ID,
+    .motorId                   = MOTOR_1_ID,
+    .lastEncoderCount          = 0,
+    .encoderCheckingTaskHandle = TS_INVALID_HANDLE,
+    .encoderSettleTaskHandle   = TS_INVALID_HANDLE,
+    .encoderClockOn            = FALSE,
+    .mode                      = DISCONNECTED,
 };
 
 BlindMotor BlindMotor2 = {
-    .id                  = BLIND_MOTOR_2_ID,
-    .encoderId           = ENCODER_2_ID,
-    .motorId             = MOTOR_2_ID,
-    .lastEncoderCount    = 0,
-    .encoderCheckingTask = &encoder2InOperation,
-    .mode                = DISCONNECTED,
+    .id                        = BLIND_MOTOR_2_ID,
+    .encoderId                 = ENCODER_2_ID,
+    .motorId                   = MOTOR_2_ID,
+    .lastEncoderCount          = 0,
+    .encoderCheckingTaskHandle = TS_INVALID_HANDLE,
+    .encoderSettleTaskHandle   = TS_INVALID_HANDLE,
+    .encoderClockOn            = FALSE,
+    .mode                      = DISCONNECTED,
 };
 
 BlindMotor* BlindMotors[NUM_BLINDS] = {&BlindMotor1, &BlindMotor2};
 
+TsHandle timeoutTaskHandle = TS_INVALID_HANDLE;
+
 /* Private Variable Declarations */
-extern uint32_t blindMotorFlag;
-extern uint32_t encoderTaskFlags;
 
 /* Private Function Prototypes */
 uint8_t bm_attempt_align_encoder(uint8_t blindId);
 uint8_t emergency_motor_stop(uint8_t blindMotorId);
+void bm_hold_encoder_clock(BlindMotor* blindMotor);
 
 /* Public Functions */
 
@@ -159,7 +170,13 @@ void bm_stop_blind_moving(uint8_t blindMotorId) {
 
     // log_prints("STOPPING MOTOR\r\n");
     motor_brake(BlindMotors[index]->motorId);
-    ts_cancel_running_task(BlindMotors[index]->encoderCheckingTask);
+    ts_cancel_running_task(&BlindMotors[index]->encoderCheckingTaskHandle);
+
+    // Let the blind come to a stop before the encoder stops counting
+    if (BlindMotors[index]->encoderClockOn == TRUE) {
+        ts_add_task_with_context_to_queue(&encoderSettleTask, BlindMotors[index],
+                                          &BlindMotors[index]->encoderSettleTaskHandle);
+    }
 }
 
 void bm_move_blind(uint8_t blindMotorId, uint8_t motorDirection) {
@@ -193,10 +210,14 @@ void bm_move_blind(uint8_t blindMotorId, uint8_t motorDirection) {
         return;
     }
 
+    // The encoder only counts while its clock is on
+    bm_hold_encoder_clock(BlindMotors[index]);
+
     // Blind needs to move either up or down. Update the last count and begin
     // task to ensure encoder is updating correctly
     BlindMotors[index]->lastEncoderCount = encoder_get_count(encoderId);
-    ts_add_task_to_queue(BlindMotors[index]->encoderCheckingTask);
+    ts_add_task_with_context_to_queue(&encoderInOperationTask, BlindMotors[index],
+                                      &BlindMotors[index]->encoderCheckingTaskHandle);
 
     // Move the motor in the desired direction
     if (motorDirection == MOTOR_FORWARD) {
@@ -210,45 +231,28 @@ void bm_move_blind(uint8_t blindMotorId, uint8_t motorDirection) {
     }
 }
 
-void bm_process_internal_flags(void) {
+RAM_FUNCTION void bm_encoder_limit_reached_isr(uint8_t encoderId) {
 
-    if (FLAG_IS_SET(blindMotorFlag, FUNC_ID_CONFIRM_ENCODER_1_IN_OPERATION)) {
-        FLAG_CLEAR(blindMotorFlag, FUNC_ID_CONFIRM_ENCODER_1_IN_OPERATION);
-        if (BlindMotor1.lastEncoderCount == encoder_get_count(BlindMotor1.encoderId)) {
-            bm_stop_blind_moving(BlindMotor1.id);
+    // Braking whilst the encoder still reads high means the system can always
+    // assume the encoder is disconnected if it reads low while the motor is
+    // stopped
+    for (uint8_t i = 0; i < NUM_BLINDS; i++) {
+        if (BlindMotors[i]->encoderId == encoderId) {
+            motor_brake(BlindMotors[i]->motorId);
+            return;
         }
     }
+}
 
-    if (FLAG_IS_SET(blindMotorFlag, FUNC_ID_CONFIRM_ENCODER_2_IN_OPERATION)) {
-        FLAG_CLEAR(blindMotorFlag, FUNC_ID_CONFIRM_ENCODER_2_IN_OPERATION);
+void bm_process_encoder_limit_reached(uint8_t encoderId) {
 
-        if (BlindMotor2.lastEncoderCount == encoder_get_count(BlindMotor2.encoderId)) {
-            bm_stop_blind_moving(BlindMotor2.id);
+    // Stop the motor that is driven by the encoder that reached its limit
+    for (uint8_t i = 0; i < NUM_BLINDS; i++) {
+        if (BlindMotors[i]->encoderId == encoderId) {
+            bm_stop_blind_moving(BlindMotors[i]->id);
+            return;
         }
     }
-
-    if (FLAG_IS_SET(blindMotorFlag, FUNC_ID_PRINT_TIMER_COUNT)) {
-        FLAG_CLEAR(blindMotorFlag, FUNC_ID_PRINT_TIMER_COUNT);
-        char m[60];
-        sprintf(m, "TIM: %li\tCCR2: %li\t CCR3: %li\r\n", TIM1->CNT, TIM1->CCR2, TIM1->CCR3);
-        log_prints(m);
-    }
-
-    /****** START CODE BLOCK ******/
-    // Description: Process the encoder flags that tell the motor when
-    // it needs to stop
-
-    if (FLAG_IS_SET(encoderTaskFlags, ENCODER_1_LIMIT_REACHED)) {
-        FLAG_CLEAR(encoderTaskFlags, ENCODER_1_LIMIT_REACHED);
-        bm_stop_blind_moving(BlindMotor1.id);
-    }
-
-    if (FLAG_IS_SET(encoderTaskFlags, ENCODER_2_LIMIT_REACHED)) {
-        FLAG_CLEAR(encoderTaskFlags, ENCODER_2_LIMIT_REACHED);
-        bm_stop_blind_moving(BlindMotor2.id);
-    }
-
-    /****** END CODE BLOCK ******/
 }
 
 void bm_set_new_min_height(uint8_t blindMotorId) {
@@ -335,6 +339,51 @@ uint16_t bm_get_height(uint8_t blindMotorId) {
 
 /* Private Functions */
 
+void bm_confirm_encoder_in_operation(void* context) {
+
+    BlindMotor* blindMotor = (BlindMotor*)context;
+
+    // Stop the motor if the encoder hasn't moved since the last check. Each
+    // check compares against the one before it so a stall is caught in any period
+    uint32_t count = encoder_get_count(blindMotor->encoderId);
+
+    if (blindMotor->lastEncoderCount == count) {
+        bm_stop_blind_moving(blindMotor->id);
+        return;
+    }
+
+    blindMotor->lastEncoderCount = count;
+}
+
+void bm_hold_encoder_clock(BlindMotor* blindMotor) {
+
+    // A blind that moves again before it has settled keeps its clock
+    ts_cancel_running_task(&blindMotor->encoderSettleTaskHandle);
+
+    if (blindMotor->encoderClockOn == FALSE) {
+        encoder_request_clock(blindMotor->encoderId);
+        blindMotor->encoderClockOn = TRUE;
+    }
+}
+
+void bm_release_encoder_clock(void* context) {
+
+    BlindMotor* blindMotor = (BlindMotor*)context;
+
+    if ((blindMotor->encoderClockOn == FALSE) || (motor_is_driving(blindMotor->motorId) == TRUE)) {
+        return;
+    }
+
+    encoder_release_clock(blindMotor->encoderId);
+    blindMotor->encoderClockOn = FALSE;
+}
+
+void bm_print_timer_count(void* context) {
+    char m[60];
+    sprintf(m, "TIM: %li\tCCR2: %li\t CCR3: %li\r\n", TIM1->CNT, TIM1->CCR2, TIM1->CCR3);
+    log_prints(m);
+}
+
 /**
  * @brief Attempts to align the gears of the encoder with the encoder sensor.
  * This is done by moving the motor slowly for a short duration of time and
@@ -353,7 +402,8 @@ uint8_t bm_attempt_align_encoder(uint8_t blindMotorId) {
     uint8_t index = BLIND_MOTOR_ID_TO_INDEX(blindMotorId);
 
     // Start timeout count down then turn motor on
-    ts_add_task_to_queue(&TimeoutTask);
+    ts_add_task_to_queue(&TimeoutTask, &timeoutTaskHandle);
+    encoder_request_clock(BlindMotors[index]->encoderId);
 
     for (uint8_t i = 0; i < 20; i++) {
 
@@ -364,11 +414,69 @@ uint8_t bm_attempt_align_encoder(uint8_t blindMotorId) {
         motor_brake(BlindMotors[index]->motorId);
 
         if (encoder_get_state(BlindMotors[index]->encoderId) == PIN_HIGH) {
+            encoder_release_clock(BlindMotors[index]->encoderId);
             log_prints("CONNECTED\r\n");
             return CONNECTED;
         }
     }
 
+    encoder_release_clock(BlindMotors[index]->encoderId);
     log_prints("DISCONNECTED\r\n");
     return DISCONNECTED;
-}
\ No newline at end of file
+}
+
+/************************************ UNIT TESTING ************************************/
+
+#if (PROJECT_STATUS == UNIT_TESTS)
+#    include "hardware_config.h"
+
+uint8_t bmTestsFailed = 0;
+
+#    define BM_ASSERT(test)                                                                         \
+        do {                                                                                        \
+            if (!(test)) {                                                                          \
+                char msg[100];                                                                      \
+                sprintf(msg, "Unit test failed in File %s line number %d\r\n", __FILE__, __LINE__); \
+                log_prints(msg);                                                                    \
+                bmTestsFailed++;                                                                    \
+            }                                                                                       \
+        } while (0)
+
+/* Function definitions */
+void bm_stall_test(void);
+
+void bm_run_unit_tests(void) {
+    log_prints("STARTING BLIND MOTOR TESTS\r\n");
+
+    bm_stall_test();
+
+    char m[50];
+    sprintf(m, "BLIND MOTOR TESTS FAILED: %i\r\n", bmTestsFailed);
+    log_prints(m);
+}
+
+void bm_stall_test(void) {
+
+    // The motor isn't driven. The encoder count is written straight into its
+    // timer and the check is called directly instead of waiting for the task
+    BlindMotor* blindMotor = &BlindMotor1;
+    bm_hold_encoder_clock(blindMotor);
+    uint32_t startCount = HC_ENCODER_1_TIMER->CNT;
+
+    HC_ENCODER_1_TIMER->CNT      = 100;
+    blindMotor->lastEncoderCount = encoder_get_count(blindMotor->encoderId);
+    ts_add_task_with_context_to_queue(&encoderInOperationTask, blindMotor, &blindMotor->encoderCheckingTaskHandle);
+
+    // The encoder moved in the first period so the motor keeps going
+    HC_ENCODER_1_TIMER->CNT = 150;
+    bm_confirm_encoder_in_operation(blindMotor);
+    BM_ASSERT(ts_task_is_running(blindMotor->encoderCheckingTaskHandle) == TRUE);
+    BM_ASSERT(blindMotor->lastEncoderCount == 150);
+
+    // The encoder stalls in the second period so the motor is stopped
+    bm_confirm_encoder_in_operation(blindMotor);
+    BM_ASSERT(ts_task_is_running(blindMotor->encoderCheckingTaskHandle) == FALSE);
+
+    HC_ENCODER_1_TIMER->CNT = startCount;
+}
+#endif
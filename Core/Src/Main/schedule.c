@@ -0,0 +1,283 @@
+/**
+ * @file schedule.c
+ * @author Gian Barta-Dougall
+ * @brief Table of times to move the blinds at. Only the next move is given to
+ * the real time clock as an alarm so the table is only looked at when it is due
+ * @version 0.1
+ * @date --
+ *
+ * @copyright Copyright (c)
+ *
+ */
+/* Public Includes */
+
+/* Private Includes */
+#include "schedule.h"
+#include "real_time_clock.h"
+#include "blind.h"
+#include "blind_motor.h"
+#include "utilities.h"
+#include "log.h"
+
+/* Private STM Includes */
+
+/* Private #defines */
+
+// Times in the schedule are compared as the minute of the week starting
+// from Monday 00:00
+#define SCHEDULE_MINUTES_PER_DAY  1440
+#define SCHEDULE_MINUTES_PER_WEEK (7 * SCHEDULE_MINUTES_PER_DAY)
+#define SCHEDULE_NO_ALARM         0xFFFF
+
+#define SCHEDULE_ALARM RTC_ALARM_A
+
+#define SCHEDULE_BLIND_ID_INVALID(id) ((id < BLIND_1_ID) || (id > (NUM_BLINDS - 1 + BLIND_1_ID)))
+
+/* Private Structures and Enumerations */
+
+/* Private Variable Declarations */
+ScheduleEntry scheduleEntries[SCHEDULE_MAX_ENTRIES];
+uint8_t scheduleNumEntries = 0;
+
+// Minute of the week the schedule alarm is set for
+uint16_t scheduleNextMinute = SCHEDULE_NO_ALARM;
+
+/* Private Function Prototypes */
+uint16_t schedule_get_minute_of_week(uint8_t weekday, uint8_t hours, uint8_t minutes);
+uint16_t schedule_find_next_minute(uint16_t currentMinute);
+void schedule_run_entry(ScheduleEntry* entry);
+
+/* Public Functions */
+
+void schedule_init(void) {
+    schedule_update_alarm();
+}
+
+uint8_t schedule_add_entry(ScheduleEntry* entry) {
+
+    if (scheduleNumEntries == SCHEDULE_MAX_ENTRIES) {
+        return FALSE;
+    }
+
+    if (SCHEDULE_BLIND_ID_INVALID(entry->blindId)) {
+        return FALSE;
+    }
+
+    if ((entry->direction != BLIND_UP) && (entry->direction != BLIND_DOWN)) {
+        return FALSE;
+    }
+
+    if ((entry->hours > 23) || (entry->minutes > 59) || (entry->days == 0) || (entry->days > SCHEDULE_DAILY)) {
+        return FALSE;
+    }
+
+    scheduleEntries[scheduleNumEntries] = *entry;
+    scheduleNumEntries++;
+
+    schedule_update_alarm();
+    return TRUE;
+}
+
+uint8_t schedule_remove_entry(uint8_t index) {
+
+    if (index >= scheduleNumEntries) {
+        return FALSE;
+    }
+
+    for (uint8_t i = index; i < (scheduleNumEntries - 1); i++) {
+        scheduleEntries[i] = scheduleEntries[i + 1];
+    }
+
+    scheduleNumEntries--;
+
+    schedule_update_alarm();
+    return TRUE;
+}
+
+void schedule_update_alarm(void) {
+
+    // Nothing can be scheduled until the calendar has been set
+    if ((scheduleNumEntries == 0) || (rtc_calendar_is_set() == FALSE)) {
+        rtc_disable_alarm(SCHEDULE_ALARM);
+        scheduleNextMinute = SCHEDULE_NO_ALARM;
+        return;
+    }
+
+    RtcDateTime now;
+    rtc_get_date_time(&now);
+
+    scheduleNextMinute = schedule_find_next_minute(schedule_get_minute_of_week(now.weekday, now.hours, now.minutes));
+
+    uint8_t weekday = (scheduleNextMinute / SCHEDULE_MINUTES_PER_DAY) + RTC_MONDAY;
+    uint8_t hours   = (scheduleNextMinute % SCHEDULE_MINUTES_PER_DAY) / 60;
+    uint8_t minutes = scheduleNextMinute % 60;
+
+    rtc_set_alarm(SCHEDULE_ALARM, weekday, hours, minutes, 0);
+}
+
+void schedule_process_alarm(void) {
+
+    if (scheduleNextMinute == SCHEDULE_NO_ALARM) {
+        return;
+    }
+
+    // The alarm was set for the next minute any entry is due so run every
+    // entry that is due at that minute
+    for (uint8_t i = 0; i < scheduleNumEntries; i++) {
+
+        for (uint8_t weekday = RTC_MONDAY; weekday <= RTC_SUNDAY; weekday++) {
+
+            if ((scheduleEntries[i].days & SCHEDULE_DAY(weekday)) == 0) {
+                continue;
+            }
+
+            if (schedule_get_minute_of_week(weekday, scheduleEntries[i].hours, scheduleEntries[i].minutes) ==
+                scheduleNextMinute) {
+                schedule_run_entry(&scheduleEntries[i]);
+            }
+        }
+    }
+
+    schedule_update_alarm();
+}
+
+void schedule_print(void) {
+
+    char m[80];
+
+    for (uint8_t i = 0; i < scheduleNumEntries; i++) {
+
+        ScheduleEntry* entry = &scheduleEntries[i];
+        uint8_t length       = sprintf(m, "%i: blind %i %s %02i:%02i", i, entry->blindId - BLIND_1_ID + 1,
+                                       (entry->direction == BLIND_UP) ? "up" : "down", entry->hours, entry->minutes);
+
+        for (uint8_t weekday = RTC_MONDAY; weekday <= RTC_SUNDAY; weekday++) {
+            if ((entry->days & SCHEDULE_DAY(weekday)) != 0) {
+                length += sprintf(m + length, " %s", rtc_get_weekday_name(weekday));
+            }
+        }
+
+        sprintf(m + length, "\r\n");
+        log_prints(m);
+    }
+
+    if (scheduleNextMinute == SCHEDULE_NO_ALARM) {
+        log_prints("No moves scheduled\r\n");
+        return;
+    }
+
+    sprintf(m, "Next move: %s %02i:%02i\r\n",
+            rtc_get_weekday_name((scheduleNextMinute / SCHEDULE_MINUTES_PER_DAY) + RTC_MONDAY),
+            (scheduleNextMinute % SCHEDULE_MINUTES_PER_DAY) / 60, scheduleNextMinute % 60);
+    log_prints(m);
+}
+
+/* Private Functions */
+
+uint16_t schedule_get_minute_of_week(uint8_t weekday, uint8_t hours, uint8_t minutes) {
+    return ((weekday - RTC_MONDAY) * SCHEDULE_MINUTES_PER_DAY) + (hours * 60) + minutes;
+}
+
+uint16_t schedule_find_next_minute(uint16_t currentMinute) {
+
+    uint16_t nextMinute = SCHEDULE_NO_ALARM;
+    uint16_t minWait    = SCHEDULE_MINUTES_PER_WEEK + 1;
+
+    for (uint8_t i = 0; i < scheduleNumEntries; i++) {
+
+        for (uint8_t weekday = RTC_MONDAY; weekday <= RTC_SUNDAY; weekday++) {
+
+            if ((scheduleEntries[i].days & SCHEDULE_DAY(weekday)) == 0) {
+                continue;
+            }
+
+            // Entries due this minute have already run so they wait a whole week
+            uint16_t minute = schedule_get_minute_of_week(weekday, scheduleEntries[i].hours, scheduleEntries[i].minutes);
+            uint16_t wait =
+                ((minute + SCHEDULE_MINUTES_PER_WEEK - currentMinute - 1) % SCHEDULE_MINUTES_PER_WEEK) + 1;
+
+            if (wait < minWait) {
+                minWait    = wait;
+                nextMinute = minute;
+            }
+        }
+    }
+
+    return nextMinute;
+}
+
+void schedule_run_entry(ScheduleEntry* entry) {
+
+    char m[40];
+    sprintf(m, "Schedule: blind %i %s\r\n", entry->blindId - BLIND_1_ID + 1,
+            (entry->direction == BLIND_UP) ? "up" : "down");
+    log_prints(m);
+
+    if (entry->direction == BLIND_UP) {
+        blind_move_up(entry->blindId);
+    } else {
+        blind_move_down(entry->blindId);
+    }
+}
+
+/************************************ UNIT TESTING ************************************/
+
+#if (PROJECT_STATUS == UNIT_TESTS)
+uint8_t scheduleTestsFailed = 0;
+
+#    define SCHEDULE_ASSERT(test)                                                                   \
+        do {                                                                                        \
+            if (!(test)) {                                                                          \
+                char msg[100];                                                                      \
+                sprintf(msg, "Unit test failed in File %s line number %d\r\n", __FILE__, __LINE__); \
+                log_prints(msg);                                                                    \
+                scheduleTestsFailed++;                                                              \
+            }                                                                                       \
+        } while (0)
+
+/* Function definitions */
+void schedule_next_minute_test(void);
+
+void schedule_run_unit_tests(void) {
+    log_prints("STARTING SCHEDULE TESTS\r\n");
+
+    schedule_next_minute_test();
+
+    char m[50];
+    sprintf(m, "SCHEDULE TESTS FAILED: %i\r\n", scheduleTestsFailed);
+    log_prints(m);
+}
+
+void schedule_next_minute_test(void) {
+
+    // Entries are written directly so the alarm isn't changed
+    scheduleNumEntries = 0;
+    SCHEDULE_ASSERT(schedule_find_next_minute(0) == SCHEDULE_NO_ALARM);
+
+    ScheduleEntry weekdays = {.blindId = BLIND_1_ID, .direction = BLIND_UP, .hours = 7, .minutes = 0,
+                              .days = SCHEDULE_WEEKDAYS};
+    ScheduleEntry weekends = {.blindId = BLIND_2_ID, .direction = BLIND_DOWN, .hours = 9, .minutes = 30,
+                              .days = SCHEDULE_WEEKENDS};
+
+    scheduleEntries[0] = weekdays;
+    scheduleEntries[1] = weekends;
+    scheduleNumEntries = 2;
+
+    uint16_t monday7am   = schedule_get_minute_of_week(RTC_MONDAY, 7, 0);
+    uint16_t tuesday7am  = schedule_get_minute_of_week(RTC_TUESDAY, 7, 0);
+    uint16_t friday8am   = schedule_get_minute_of_week(RTC_FRIDAY, 8, 0);
+    uint16_t saturday930 = schedule_get_minute_of_week(RTC_SATURDAY, 9, 30);
+    uint16_t sunday10am  = schedule_get_minute_of_week(RTC_SUNDAY, 10, 0);
+
+    SCHEDULE_ASSERT(schedule_find_next_minute(friday8am) == saturday930);
+
+    // The search wraps from the end of the week back to Monday
+    SCHEDULE_ASSERT(schedule_find_next_minute(sunday10am) == monday7am);
+
+    // An entry due now is not next again until the following day it runs on
+    SCHEDULE_ASSERT(schedule_find_next_minute(monday7am) == tuesday7am);
+    SCHEDULE_ASSERT(schedule_find_next_minute(monday7am - 1) == monday7am);
+
+    scheduleNumEntries = 0;
+}
+#endif
@@ -16,11 +16,28 @@
 #include "synchronous_timer.h"
 #include "button.h"
 #include "blind.h"
+#include "ambient_light_sensor.h"
+#include "blind_motor.h"
+#include "serial_comms.h"
+#include "event_queue.h"
+#include "cyclic_executive.h"
+#include "task_scheduler_us.h"
+#include "real_time_clock.h"
+#include "schedule.h"
+#include "solar.h"
+#include "monotonic_time.h"
+#include "low_power.h"
+#include "motor.h"
+#include "piezo_buzzer.h"
+#include "residency.h"
 
 /* Private STM Includes */
 
 /* Private Macros */
 
+// Length of time the idle percentage is measured over
+#define TEMPEST_IDLE_WINDOW_MS 1000
+
 /* Private Structures and Enumerations */
 extern uint32_t buttonTasksFlag;
 extern uint32_t tempestTasksFlag;
@@ -28,7 +45,15 @@ extern uint32_t tempestTasksFlag;
 /* Private Variable Declarations */
 uint8_t blindIds[NUM_BLINDS] = {BLIND_1_ID, BLIND_2_ID};
 
+uint32_t idleCycles      = 0;
+uint64_t idleWindowStart = 0;
+uint8_t idlePercentage   = 0;
+
 /* Private Function Prototypes */
+void tempest_process_events(void);
+void tempest_idle(void);
+uint8_t tempest_stop_is_allowed(void);
+void tempest_update_idle_percentage(void);
 void tempest_process_external_button_flags(void);
 void tempest_process_internal_flags(void);
 
@@ -41,23 +66,38 @@ void tempest_init(void) {
 
     // Initialise all the required peripherals
     ts_init();
+    tsu_init();
+    ce_init();
     button_init();
     blind_init();
+    al_sensor_init();
     synchronous_timer_enable();
+    rtc_init();
+    schedule_init();
+    solar_init();
 
     log_prints("Initialised\r\n");
+
+    idleWindowStart = time_now_ms();
+    res_reset();
+}
+
+uint8_t tempest_get_idle_percentage(void) {
+    return idlePercentage;
 }
 
 /* Private Functions */
 
 void tempest_update(void) {
 
-    /* Ensures button debouncing is processed */
-    button_process_internal_flags();
+    /* Drain the events added by interrupts. Doing this first means any
+        flags or tasks the events create are processed in this same loop */
+    tempest_process_events();
 
     /* Task scheduler internal flags need to be processed as they
         handle things like removing tasks that have been completed
-        from the scheduler and running new tasks */
+        from the scheduler and running new tasks. This also calls the
+        handlers of tasks that have finished such as button debouncing */
     ts_process_internal_flags();
 
     /* Process any buttons clicks/holds by the user */
@@ -68,9 +108,146 @@ void tempest_update(void) {
         of the blinds */
     blind_process_internal_flags();
 
-    /* The ambient light sensor does not currently work properly
-        so it is not being run */
-    al_sensor_process_internal_flags();
+    /* Sleep until the next interrupt if there is nothing left to do */
+    tempest_idle();
+}
+
+void tempest_idle(void) {
+
+    uint32_t primask;
+
+    // Interrupts are disabled while checking for work so an interrupt can't add
+    // an event between the check and going to sleep. WFI still wakes the core
+    // when an interrupt becomes pending and it is serviced once they are enabled.
+    // Flags are only ever set from the main loop by processing events and
+    // finished tasks so there is no need to check them separately
+    ENTER_CRITICAL_SECTION(primask);
+
+    if ((event_queue_is_empty() == TRUE) && (ts_has_finished_tasks() == FALSE)) {
+
+        uint32_t stoppedUs = 0;
+
+#ifdef LOW_POWER_MODULE_ENABLED
+        if (tempest_stop_is_allowed() == TRUE) {
+            stoppedUs = lp_enter_stop_2(ts_get_time_until_next_wake());
+        }
+#endif
+
+        if (stoppedUs != 0) {
+
+            // SysTick doesn't run in Stop 2 so the whole time counts as idle
+            idleCycles += (uint32_t)(((uint64_t)stoppedUs * (SysTick->LOAD + 1)) / TIME_US_PER_MS);
+            res_add_idle_time(RES_STOP, stoppedUs);
+
+        } else {
+
+            uint64_t sleepStartUs = time_now_us();
+            uint32_t start        = SysTick->VAL;
+            __DSB();
+            __WFI();
+            uint32_t end = SysTick->VAL;
+            res_add_idle_time(RES_SLEEP, (uint32_t)(time_now_us() - sleepStartUs));
+
+            // SysTick counts down and its interrupt wakes the core every time it
+            // reloads so it can only have reloaded once while asleep
+            idleCycles += (start >= end) ? (start - end) : (start + (SysTick->LOAD + 1) - end);
+        }
+    }
+
+    EXIT_CRITICAL_SECTION(primask);
+
+    tempest_update_idle_percentage();
+}
+
+/**
+ * @brief Stop 2 freezes every timer except the low power timer so the mcu
+ * can only stop when nothing is being timed by the others
+ *
+ * @return uint8_t TRUE if the mcu can enter Stop 2 else FALSE
+ */
+uint8_t tempest_stop_is_allowed(void) {
+
+    // The encoders are counted by TIM1 and TIM2 so their limits can't be
+    // detected while stopped
+    if ((motor_is_driving(MOTOR_1_ID) == TRUE) || (motor_is_driving(MOTOR_2_ID) == TRUE)) {
+        return FALSE;
+    }
+
+    if ((piezo_buzzer_is_playing() == TRUE) || (ce_is_running() == TRUE)) {
+        return FALSE;
+    }
+
+    return (tsu_get_num_tasks_in_queue() == 0) ? TRUE : FALSE;
+}
+
+void tempest_update_idle_percentage(void) {
+
+    uint32_t elapsedMs = time_now_ms() - idleWindowStart;
+
+    if (elapsedMs < TEMPEST_IDLE_WINDOW_MS) {
+        return;
+    }
+
+    // SysTick reloads every 1ms so each ms is LOAD + 1 cycles
+    uint64_t windowCycles = (uint64_t)elapsedMs * (SysTick->LOAD + 1);
+    uint64_t percentage   = ((uint64_t)idleCycles * 100) / windowCycles;
+
+    idlePercentage  = (percentage > 100) ? 100 : (uint8_t)percentage;
+    idleCycles      = 0;
+    idleWindowStart = idleWindowStart + elapsedMs;
+}
+
+void tempest_process_events(void) {
+
+    Event event;
+
+    // Events are returned oldest first regardless of which interrupt
+    // priority they were added from
+    while (event_queue_pop(&event) == TRUE) {
+
+        switch (event.type) {
+            case EVENT_BUTTON_EDGE:
+                button_process_edge_event(event.data);
+                break;
+            case EVENT_ENCODER_MAX_HEIGHT_REACHED:
+                log_prints("REACHED MAX HEIGHT\r\n");
+                bm_process_encoder_limit_reached(event.data);
+                break;
+            case EVENT_ENCODER_MIN_HEIGHT_REACHED:
+                log_prints("REACHED MIN HEIGHT\r\n");
+                bm_process_encoder_limit_reached(event.data);
+                break;
+            case EVENT_SERIAL_CHARACTER_RECEIVED:
+#ifdef LOW_POWER_MODULE_ENABLED
+                lp_keep_awake(LP_SERIAL_AWAKE_MS);
+#endif
+                serial_comms_add_to_buffer((char)event.data);
+                break;
+            case EVENT_SERIAL_PARITY_ERROR:
+                log_prints("Parity error\r\n");
+                break;
+            case EVENT_INTERRUPT_LOG: {
+                // Interrupts that are only traced are logged here so the uart
+                // isn't written to from interrupt context
+                char m[40];
+                sprintf(m, "%lu ms: ISR IRQn %i\r\n", (uint32_t)(time_extend_us(event.timestamp) / TIME_US_PER_MS),
+                        event.data);
+                log_prints(m);
+                break;
+            }
+            case EVENT_RTC_ALARM:
+                // The schedule is only checked when its alarm goes off and
+                // the sunrise and sunset are found once a day
+                if (event.data == RTC_ALARM_A) {
+                    schedule_process_alarm();
+                } else if (event.data == RTC_ALARM_B) {
+                    solar_update();
+                }
+                break;
+            default:
+                break;
+        }
+    }
 }
 
 void tempest_process_external_button_flags(void) {
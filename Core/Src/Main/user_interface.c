@@ -34,6 +34,24 @@
 /* Private Variable Declarations */
 
 /* Private Function Prototypes */
+void user_interface_blink_led(void* context);
+void user_interface_play_config_settings_sound(void* context);
+
+// The following tasks are shared by every user interface. The user interface
+// the task is for is given as the context when the task is added
+struct Task1 blinkLedTask = {
+    .delay    = 1000,
+    .slack    = 50,
+    .handler  = user_interface_blink_led,
+    .nextTask = &blinkLedTask,
+};
+
+struct Task1 configSettingsSoundTask = {
+    .delay    = 3000,
+    .slack    = 100,
+    .handler  = user_interface_play_config_settings_sound,
+    .nextTask = &configSettingsSoundTask,
+};
 
 /* Public Functions */
 
@@ -42,7 +60,7 @@ void user_interface_manual_mode_on(const uint8_t uiId) {
     ASSERT_VALID_UI_ID(uiId);
 
     const uint8_t index = UI_ID_TO_INDEX(uiId);
-    ts_add_task_to_queue(interfaces[index].blinkLedTask);
+    ts_add_task_with_context_to_queue(&blinkLedTask, &interfaces[index], &interfaces[index].blinkLedTaskHandle);
 }
 
 void user_interface_daylight_mode_on(const uint8_t uiId) {
@@ -58,17 +76,27 @@ void user_interface_update_settings_mode_on(const uint8_t uiId) {
     ASSERT_VALID_UI_ID(uiId);
 
     const uint8_t index = UI_ID_TO_INDEX(uiId);
-    ts_add_task_to_queue(interfaces[index].blinkLedTask);
-    ts_add_task_to_queue(interfaces[index].configureSettingsSound);
+    ts_add_task_with_context_to_queue(&blinkLedTask, &interfaces[index], &interfaces[index].blinkLedTaskHandle);
+    ts_add_task_with_context_to_queue(&configSettingsSoundTask, &interfaces[index],
+                                      &interfaces[index].configureSettingsSoundHandle);
 }
 
 void user_interface_off(const uint8_t uiId) {
     ASSERT_VALID_UI_ID(uiId);
 
     const uint8_t index = UI_ID_TO_INDEX(uiId);
-    ts_cancel_running_task(interfaces[index].blinkLedTask);
-    ts_cancel_running_task(interfaces[index].configureSettingsSound);
+    ts_cancel_running_task(&interfaces[index].blinkLedTaskHandle);
+    ts_cancel_running_task(&interfaces[index].configureSettingsSoundHandle);
     led_off(interfaces[index].ledId);
 }
 
-/* Private Functions */
\ No newline at end of file
+/* Private Functions */
+
+void user_interface_blink_led(void* context) {
+    UserInterface* interface = (UserInterface*)context;
+    led_toggle(interface->ledId);
+}
+
+void user_interface_play_config_settings_sound(void* context) {
+    piezo_buzzer_play_sound(SOUND);
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+/**
+ * @file hardware_config.h
+ * @author Gian Barta-Dougall
+ * @brief Host stand in for the hardware configuration. Only the macros the
+ * task scheduler needs are defined and they point at the simulated timer
+ * @version 0.1
+ * @date --
+ *
+ * @copyright Copyright (c)
+ *
+ */
+#ifndef HARDWARE_CONFIG_H
+#define HARDWARE_CONFIG_H
+
+/* Public Includes */
+#include "stm32l4xx.h"
+
+/* Public #defines */
+#define TIMER_FREQUENCY_1KHz 1000
+
+#define HC_TS_TIMER              TIM15
+#define HC_TS_TIMER_FREQUENCY    TIMER_FREQUENCY_1KHz
+#define HC_TS_TIMER_MAX_COUNT    UINT_16_BIT_MAX_VALUE
+#define HC_TS_TIMER_IRQn         TIM1_BRK_TIM15_IRQn
+
+#endif // HARDWARE_CONFIG_H
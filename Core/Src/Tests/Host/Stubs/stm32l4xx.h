@@ -0,0 +1,104 @@
+/**
+ * @file stm32l4xx.h
+ * @author Gian Barta-Dougall
+ * @brief Host stand in for the STM32L4 device header. Only what the task
+ * scheduler uses is defined. The timer and core registers are simulated in
+ * sim_mcu.c
+ * @version 0.1
+ * @date --
+ *
+ * @copyright Copyright (c)
+ *
+ */
+#ifndef STM32L4XX_H
+#define STM32L4XX_H
+
+/* Public Includes */
+#include <stdint.h>
+#include <stdio.h>
+
+/* Public Structures and Enumerations */
+
+typedef enum {
+    PendSV_IRQn         = -2,
+    TIM1_BRK_TIM15_IRQn = 24,
+} IRQn_Type;
+
+typedef struct {
+    volatile uint32_t CR1;
+    volatile uint32_t CR2;
+    volatile uint32_t SMCR;
+    volatile uint32_t DIER;
+    volatile uint32_t SR;
+    volatile uint32_t EGR;
+    volatile uint32_t CCMR1;
+    volatile uint32_t CCMR2;
+    volatile uint32_t CCER;
+    volatile uint32_t CNT;
+    volatile uint32_t PSC;
+    volatile uint32_t ARR;
+    volatile uint32_t RCR;
+    volatile uint32_t CCR1;
+    volatile uint32_t CCR2;
+} TIM_TypeDef;
+
+typedef struct {
+    volatile uint32_t ICSR;
+} SCB_Type;
+
+// Only needed so utilities.h compiles. Nothing on the host uses the gpio ports
+typedef struct {
+    volatile uint32_t MODER;
+    volatile uint32_t IDR;
+    volatile uint32_t ODR;
+} GPIO_TypeDef;
+
+/* Public #defines */
+
+#define TIM_CR1_CEN (0x01U << 0)
+#define TIM_CR1_URS (0x01U << 2)
+
+#define TIM_DIER_UIE   (0x01U << 0)
+#define TIM_DIER_CC1IE (0x01U << 1)
+#define TIM_DIER_CC2IE (0x01U << 2)
+
+#define TIM_SR_UIF   (0x01U << 0)
+#define TIM_SR_CC1IF (0x01U << 1)
+#define TIM_SR_CC2IF (0x01U << 2)
+
+#define TIM_EGR_UG   (0x01U << 0)
+#define TIM_EGR_CC1G (0x01U << 1)
+#define TIM_EGR_CC2G (0x01U << 2)
+
+#define SCB_ICSR_PENDSVSET_Msk (0x01U << 28)
+
+// Every access to the timer goes through the simulation so writes to the
+// status and event registers behave like the hardware does
+#define TIM15 (sim_mcu_timer())
+#define SCB   (&simScb)
+
+/* Public Variable Declarations */
+extern SCB_Type simScb;
+
+/* Public Function Prototypes */
+TIM_TypeDef* sim_mcu_timer(void);
+void sim_mcu_run_interrupts(void);
+
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t priMask);
+void __disable_irq(void);
+
+// Interrupts pended by the code before the barrier are taken at the barrier
+// so that is where the simulation runs them
+#define __DSB() __sync_synchronize()
+#define __ISB() sim_mcu_run_interrupts()
+
+static inline uint32_t __CLZ(uint32_t value) {
+    return (value == 0) ? 32 : (uint32_t)__builtin_clz(value);
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type irq);
+void HAL_NVIC_DisableIRQ(IRQn_Type irq);
+uint32_t HAL_GetTick(void);
+
+#endif // STM32L4XX_H
@@ -0,0 +1,16 @@
+/**
+ * @file stm32l4xx_hal.h
+ * @author Gian Barta-Dougall
+ * @brief Host stand in that forwards to the simulated device header
+ * @version 0.1
+ * @date --
+ *
+ * @copyright Copyright (c)
+ *
+ */
+#ifndef STM32L4XX_HAL_H
+#define STM32L4XX_HAL_H
+
+#include "stm32l4xx.h"
+
+#endif // STM32L4XX_HAL_H
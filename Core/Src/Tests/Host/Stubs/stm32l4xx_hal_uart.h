@@ -0,0 +1,16 @@
+/**
+ * @file stm32l4xx_hal_uart.h
+ * @author Gian Barta-Dougall
+ * @brief Host stand in that forwards to the simulated device header
+ * @version 0.1
+ * @date --
+ *
+ * @copyright Copyright (c)
+ *
+ */
+#ifndef STM32L4XX_HAL_UART_H
+#define STM32L4XX_HAL_UART_H
+
+#include "stm32l4xx.h"
+
+#endif // STM32L4XX_HAL_UART_H
@@ -0,0 +1,187 @@
+/**
+ * @file sim_mcu.c
+ * @author Gian Barta-Dougall
+ * @brief Simulation of the parts of the mcu the task scheduler uses so it can
+ * be built and run on a host machine
+ * @version 0.1
+ * @date --
+ *
+ * @copyright Copyright (c)
+ *
+ */
+/* Public Includes */
+
+/* Private Includes */
+#include "sim_mcu.h"
+#include "task_scheduler_1.h"
+#include "utilities.h"
+
+/* Private #defines */
+
+// Interrupts that keep pending themselves would hang the simulation
+#define SIM_MAX_NESTED_INTERRUPTS 100
+
+/* Private Variable Declarations */
+TIM_TypeDef simTimer;
+SCB_Type simScb;
+
+// The real state of the status flags. The register in simTimer holds whatever
+// was last written to it until the next access works out what the write did
+uint32_t simStatus = 0;
+
+uint32_t simPriMask         = 0;
+uint8_t simTimerIrqEnabled = TRUE;
+uint32_t simTick            = 0;
+
+/* Private Function Prototypes */
+void sim_mcu_sync_timer(void);
+
+/* Public Functions */
+
+void sim_mcu_reset(void) {
+
+    TIM_TypeDef emptyTimer = {0};
+    simTimer               = emptyTimer;
+    simTimer.ARR           = UINT_16_BIT_MAX_VALUE;
+    simScb.ICSR            = 0;
+    simStatus              = 0;
+    simPriMask             = 0;
+    simTimerIrqEnabled     = TRUE;
+    simTick                = 0;
+}
+
+TIM_TypeDef* sim_mcu_timer(void) {
+    sim_mcu_sync_timer();
+    return &simTimer;
+}
+
+void sim_mcu_tick(void) {
+
+    sim_mcu_sync_timer();
+    simTick++;
+
+    if ((simTimer.CR1 & TIM_CR1_CEN) == TIM_CR1_CEN) {
+
+        if (simTimer.CNT >= simTimer.ARR) {
+            simTimer.CNT = 0;
+            simStatus |= TIM_SR_UIF;
+        } else {
+            simTimer.CNT++;
+        }
+
+        if (simTimer.CNT == simTimer.CCR1) {
+            simStatus |= TIM_SR_CC1IF;
+        }
+
+        if (simTimer.CNT == simTimer.CCR2) {
+            simStatus |= TIM_SR_CC2IF;
+        }
+
+        simTimer.SR = simStatus;
+    }
+
+    sim_mcu_run_interrupts();
+}
+
+void sim_mcu_run_interrupts(void) {
+
+    if (simPriMask != 0) {
+        return;
+    }
+
+    // Same order as TIM1_BRK_TIM15_IRQHandler() followed by PendSV_Handler()
+    for (uint8_t i = 0; i < SIM_MAX_NESTED_INTERRUPTS; i++) {
+
+        uint8_t interruptRan = FALSE;
+        sim_mcu_sync_timer();
+
+        if (simTimerIrqEnabled == TRUE) {
+
+            if (((simStatus & TIM_SR_UIF) != 0) && ((simTimer.DIER & TIM_DIER_UIE) != 0)) {
+                TIM15->SR = ~TIM_SR_UIF;
+                ts_overflow_isr();
+                interruptRan = TRUE;
+            }
+
+            if (((simStatus & TIM_SR_CC1IF) != 0) && ((simTimer.DIER & TIM_DIER_CC1IE) != 0)) {
+                TIM15->SR = ~TIM_SR_CC1IF;
+                ts_isr();
+                interruptRan = TRUE;
+            }
+        }
+
+        if ((simScb.ICSR & SCB_ICSR_PENDSVSET_Msk) != 0) {
+            simScb.ICSR &= ~SCB_ICSR_PENDSVSET_Msk;
+            ts_preemptive_isr();
+            interruptRan = TRUE;
+        }
+
+        if (interruptRan == FALSE) {
+            return;
+        }
+    }
+
+    fprintf(stderr, "Interrupts are pending themselves forever\n");
+}
+
+/* Stand ins for the CMSIS and HAL functions */
+
+uint32_t __get_PRIMASK(void) {
+    return simPriMask;
+}
+
+void __set_PRIMASK(uint32_t priMask) {
+    simPriMask = priMask;
+}
+
+void __disable_irq(void) {
+    simPriMask = 1;
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type irq) {
+    if (irq == TIM1_BRK_TIM15_IRQn) {
+        simTimerIrqEnabled = TRUE;
+    }
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type irq) {
+    if (irq == TIM1_BRK_TIM15_IRQn) {
+        simTimerIrqEnabled = FALSE;
+    }
+}
+
+uint32_t HAL_GetTick(void) {
+    return simTick;
+}
+
+void log_prints(char* msg) {
+    fputs(msg, stderr);
+}
+
+/* Private Functions */
+
+void sim_mcu_sync_timer(void) {
+
+    // Status flags are cleared by writing 0 to them and writing 1 has no effect
+    simStatus &= simTimer.SR;
+
+    if ((simTimer.EGR & TIM_EGR_UG) != 0) {
+        simTimer.CNT = 0;
+
+        if ((simTimer.CR1 & TIM_CR1_URS) == 0) {
+            simStatus |= TIM_SR_UIF;
+        }
+    }
+
+    if ((simTimer.EGR & TIM_EGR_CC1G) != 0) {
+        simStatus |= TIM_SR_CC1IF;
+    }
+
+    if ((simTimer.EGR & TIM_EGR_CC2G) != 0) {
+        simStatus |= TIM_SR_CC2IF;
+    }
+
+    // Event generation bits clear themselves
+    simTimer.EGR = 0;
+    simTimer.SR  = simStatus;
+}
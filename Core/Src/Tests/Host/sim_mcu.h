@@ -0,0 +1,39 @@
+/**
+ * @file sim_mcu.h
+ * @author Gian Barta-Dougall
+ * @brief Simulation of the parts of the mcu the task scheduler uses so it can
+ * be built and run on a host machine
+ * @version 0.1
+ * @date --
+ *
+ * @copyright Copyright (c)
+ *
+ */
+#ifndef SIM_MCU_H
+#define SIM_MCU_H
+
+/* Public Includes */
+#include "stm32l4xx.h"
+
+/* Public Function Prototypes */
+
+/**
+ * @brief Resets the simulated timer, interrupt mask and tick count
+ */
+void sim_mcu_reset(void);
+
+/**
+ * @brief Moves the simulated timer forward by one count (1ms) and runs any
+ * interrupts that became pending
+ */
+void sim_mcu_tick(void);
+
+/**
+ * @brief Runs the scheduler timer and PendSV interrupts if they are pending
+ * and interrupts are enabled. Interrupts on the mcu would preempt the main
+ * loop as soon as they are pending so this should be called after every call
+ * into the scheduler from the main loop
+ */
+void sim_mcu_run_interrupts(void);
+
+#endif // SIM_MCU_H
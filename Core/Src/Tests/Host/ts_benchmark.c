@@ -0,0 +1,333 @@
+/**
+ * @file ts_benchmark.c
+ * @author Gian Barta-Dougall
+ * @brief Benchmarks the task scheduler on a host machine against a simulated
+ * scheduler timer. Results are printed as csv so runs before and after a change
+ * to the scheduler can be compared
+ * @version 0.1
+ * @date --
+ *
+ * @copyright Copyright (c)
+ *
+ */
+/* Public Includes */
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Private Includes */
+#include "sim_mcu.h"
+#include "task_scheduler_1.h"
+#include "utilities.h"
+
+/* Private #defines */
+
+// Longest random delay given to a task in scheduler ticks
+#define BENCH_MAX_DELAY 10000
+
+// Number of re-arms and cancels done in the churn benchmark
+#define BENCH_CHURN_OPERATIONS 100000
+
+// Most scheduler ticks the main loop can be busy for before it dispatches the
+// tasks that have finished in the dispatch benchmark
+#define BENCH_MAX_BACKLOG 4
+
+#define BENCH_DEFAULT_SEED 1
+
+#define BENCH_MAX_TASKS 1000
+
+#if (BENCH_MAX_TASKS > TS_QUEUE_CAPACITY)
+#    error The queue must be able to hold every task in the benchmarks
+#endif
+
+/* Private Structures and Enumerations */
+
+typedef struct BenchResult {
+    const char* benchmark;
+    uint32_t tasks;
+    uint32_t operations;
+    uint64_t totalNs;
+    uint64_t maxNs;
+    uint32_t maxLateness;
+} BenchResult;
+
+typedef struct BenchTask {
+    uint32_t deadline;
+    uint8_t dispatched;
+} BenchTask;
+
+/* Private Variable Declarations */
+
+const uint32_t benchTaskCounts[] = {10, 100, 250, 500, 1000};
+
+uint32_t benchSeed = BENCH_DEFAULT_SEED;
+
+BenchTask benchTasks[BENCH_MAX_TASKS];
+TsHandle benchHandles[BENCH_MAX_TASKS];
+uint32_t benchOrder[BENCH_MAX_TASKS];
+
+uint32_t benchNumDispatched = 0;
+uint32_t benchMaxLateness   = 0;
+
+/* Private Function Prototypes */
+void bench_handler(void* context);
+
+const Task1 benchTask = {.delay = 0, .handler = bench_handler, .nextTask = NULL};
+
+void bench_reset(void);
+uint32_t bench_random(void);
+uint32_t bench_random_delay(void);
+uint64_t bench_now_ns(void);
+void bench_record(BenchResult* result, uint64_t start);
+void bench_print(BenchResult* result);
+void bench_add_task(uint32_t i);
+void bench_fill_queue(uint32_t numTasks, BenchResult* result);
+void bench_add(uint32_t numTasks);
+void bench_cancel(uint32_t numTasks);
+void bench_churn(uint32_t numTasks);
+void bench_dispatch(uint32_t numTasks);
+
+/* Public Functions */
+
+int main(int argc, char** argv) {
+
+    for (int i = 1; i < argc; i++) {
+
+        if (strcmp(argv[i], "--unit-tests") == 0) {
+            extern uint8_t UNIT_TESTS_FAILED;
+            sim_mcu_reset();
+            ts_run_unit_tests();
+            return UNIT_TESTS_FAILED;
+        }
+
+        if ((strcmp(argv[i], "--seed") == 0) && ((i + 1) < argc)) {
+            benchSeed = (uint32_t)strtoul(argv[++i], NULL, 0);
+            continue;
+        }
+
+        fprintf(stderr, "Usage: %s [--seed n] [--unit-tests]\n", argv[0]);
+        return 1;
+    }
+
+    printf("benchmark,tasks,operations,mean_ns,max_ns,max_lateness_ticks\n");
+
+    for (uint32_t i = 0; i < (sizeof(benchTaskCounts) / sizeof(benchTaskCounts[0])); i++) {
+        bench_add(benchTaskCounts[i]);
+        bench_cancel(benchTaskCounts[i]);
+        bench_churn(benchTaskCounts[i]);
+        bench_dispatch(benchTaskCounts[i]);
+    }
+
+    return 0;
+}
+
+void bench_handler(void* context) {
+
+    BenchTask* task = (BenchTask*)context;
+    uint32_t lateness = ts_get_time() - task->deadline;
+
+    if (lateness > benchMaxLateness) {
+        benchMaxLateness = lateness;
+    }
+
+    task->dispatched = TRUE;
+    benchNumDispatched++;
+}
+
+/* Private Functions */
+
+void bench_reset(void) {
+    sim_mcu_reset();
+    ts_init();
+    benchNumDispatched = 0;
+    benchMaxLateness   = 0;
+}
+
+uint32_t bench_random(void) {
+    // xorshift32 so every run with the same seed does the same operations
+    benchSeed ^= benchSeed << 13;
+    benchSeed ^= benchSeed >> 17;
+    benchSeed ^= benchSeed << 5;
+    return benchSeed;
+}
+
+uint32_t bench_random_delay(void) {
+    return (bench_random() % BENCH_MAX_DELAY) + 1;
+}
+
+uint64_t bench_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000000ULL) + (uint64_t)now.tv_nsec;
+}
+
+void bench_record(BenchResult* result, uint64_t start) {
+
+    uint64_t elapsed = bench_now_ns() - start;
+
+    result->totalNs += elapsed;
+    result->operations++;
+
+    if (elapsed > result->maxNs) {
+        result->maxNs = elapsed;
+    }
+}
+
+void bench_print(BenchResult* result) {
+
+    uint64_t meanNs = (result->operations == 0) ? 0 : (result->totalNs / result->operations);
+
+    printf("%s,%u,%u,%llu,%llu,%u\n", result->benchmark, result->tasks, result->operations,
+           (unsigned long long)meanNs, (unsigned long long)result->maxNs, result->maxLateness);
+}
+
+void bench_add_task(uint32_t i) {
+    uint32_t delay                = bench_random_delay();
+    benchTasks[i].deadline   = ts_get_time() + delay;
+    benchTasks[i].dispatched = FALSE;
+    ts_add_task_with_delay_to_queue(&benchTask, &benchTasks[i], delay, &benchHandles[i]);
+}
+
+void bench_fill_queue(uint32_t numTasks, BenchResult* result) {
+
+    for (uint32_t i = 0; i < numTasks; i++) {
+        benchHandles[i] = TS_INVALID_HANDLE;
+
+        uint64_t start = bench_now_ns();
+        bench_add_task(i);
+
+        if (result != NULL) {
+            bench_record(result, start);
+        }
+
+        sim_mcu_run_interrupts();
+    }
+
+    if (ts_get_overflow_count() != 0) {
+        fprintf(stderr, "%lu tasks didn't fit in the queue\n", (unsigned long)ts_get_overflow_count());
+    }
+}
+
+void bench_add(uint32_t numTasks) {
+
+    BenchResult result = {.benchmark = "add", .tasks = numTasks};
+
+    bench_reset();
+    bench_fill_queue(numTasks, &result);
+    bench_print(&result);
+}
+
+void bench_cancel(uint32_t numTasks) {
+
+    BenchResult result = {.benchmark = "cancel", .tasks = numTasks};
+
+    bench_reset();
+    bench_fill_queue(numTasks, NULL);
+
+    // Cancel in a random order so tasks are taken from all over the heap
+    for (uint32_t i = 0; i < numTasks; i++) {
+        benchOrder[i] = i;
+    }
+
+    for (uint32_t i = numTasks - 1; i > 0; i--) {
+        uint32_t j    = bench_random() % (i + 1);
+        uint32_t temp = benchOrder[i];
+        benchOrder[i] = benchOrder[j];
+        benchOrder[j] = temp;
+    }
+
+    for (uint32_t i = 0; i < numTasks; i++) {
+        uint64_t start = bench_now_ns();
+        ts_cancel_running_task(&benchHandles[benchOrder[i]]);
+        bench_record(&result, start);
+        sim_mcu_run_interrupts();
+    }
+
+    bench_print(&result);
+}
+
+void bench_churn(uint32_t numTasks) {
+
+    BenchResult result = {.benchmark = "churn", .tasks = numTasks};
+
+    bench_reset();
+    bench_fill_queue(numTasks, NULL);
+
+    // Same pattern as the buttons. Presses re-arm tasks that are already queued
+    // and releases cancel them and queue a different one
+    for (uint32_t i = 0; i < BENCH_CHURN_OPERATIONS; i++) {
+
+        uint32_t index = bench_random() % numTasks;
+        uint64_t start = bench_now_ns();
+
+        if ((bench_random() & 0x01) == 0) {
+            bench_add_task(index);
+        } else {
+            ts_cancel_running_task(&benchHandles[index]);
+            bench_add_task(index);
+        }
+
+        bench_record(&result, start);
+        sim_mcu_run_interrupts();
+
+        // Let time pass now and then so some of the tasks become due
+        if ((i % 64) == 0) {
+            sim_mcu_tick();
+            ts_process_internal_flags();
+            sim_mcu_run_interrupts();
+        }
+    }
+
+    result.maxLateness = benchMaxLateness;
+    bench_print(&result);
+}
+
+void bench_dispatch(uint32_t numTasks) {
+
+    BenchResult result = {.benchmark = "dispatch", .tasks = numTasks};
+
+    bench_reset();
+    bench_fill_queue(numTasks, NULL);
+
+    // Each pass is the main loop being busy for a random number of ticks, with
+    // the scheduler timer interrupt still running, before it dispatches the
+    // tasks that finished. The busy ticks are what makes tasks late. Both the
+    // mean and the max are the time per task dispatched. The max comes from the
+    // pass with the most time per task
+    uint32_t tick = 0;
+
+    while ((tick <= BENCH_MAX_DELAY) && (benchNumDispatched < numTasks)) {
+
+        uint32_t busyTicks  = bench_random() % (BENCH_MAX_BACKLOG + 1);
+        uint32_t dispatched = benchNumDispatched;
+        uint64_t start      = bench_now_ns();
+
+        for (uint32_t i = 0; i <= busyTicks; i++) {
+            sim_mcu_tick();
+        }
+
+        ts_process_internal_flags();
+        sim_mcu_run_interrupts();
+        uint64_t elapsed = bench_now_ns() - start;
+
+        tick += busyTicks + 1;
+        dispatched = benchNumDispatched - dispatched;
+
+        if (dispatched == 0) {
+            continue;
+        }
+
+        result.totalNs += elapsed;
+        if ((elapsed / dispatched) > result.maxNs) {
+            result.maxNs = elapsed / dispatched;
+        }
+    }
+
+    if (benchNumDispatched != numTasks) {
+        fprintf(stderr, "Only %u of %u tasks were dispatched\n", benchNumDispatched, numTasks);
+    }
+
+    result.operations  = benchNumDispatched;
+    result.maxLateness = benchMaxLateness;
+    bench_print(&result);
+}
@@ -19,9 +19,9 @@
 #include "hardware_config.h"
 #include "ambient_light_sensor.h"
 #include "button.h"
+#include "event_queue.h"
 #include "encoder.h"
 #include "piezo_buzzer.h"
-#include "synchronous_interrupts.h"
 #include "synchronous_timer.h"
 #include "led.h"
 #include "log.h"
@@ -80,9 +80,18 @@ void button_test(void) {
     // GPIOA->MODER &= ~(0x03 << 12);
     // GPIOA->MODER |= (0x01 << 12);
 
+    Event event;
+
     while (1) {
+
+        // Button edges are added to the event queue by the isr
+        while (event_queue_pop(&event) == TRUE) {
+            if (event.type == EVENT_BUTTON_EDGE) {
+                button_process_edge_event(event.data);
+            }
+        }
+
         ts_process_internal_flags();
-        button_process_internal_flags();
     }
 }
 
@@ -110,9 +119,10 @@ void als_test(void) {
     uint8_t status1 = 0;
     uint8_t status2 = 0;
 
+    al_sensor_init();
+
     while (1) {
 
-        al_sensor_process_internal_flags();
         ts_process_internal_flags();
 
         if (status1 != al_sensor_light_found(AL_SENSOR_1_ID)) {
@@ -164,15 +174,19 @@ void piezo_buzzer_test(void) {
 void al_sensor_test(void) {
 
     hardware_config_init();
-    synchronous_timer_enable();
     log_clear();
 
     log_prints("Initialised\r\n");
 
+    // The synchronous timer runs on the scheduler so it must be started after
+    ts_init();
+    synchronous_timer_enable();
+    al_sensor_init();
+
     while (1) {
         HAL_Delay(1000);
 
-        al_sensor_process_internal_flags();
+        ts_process_internal_flags();
 
         if (al_sensor_status(AL_SENSOR_1_ID) == CONNECTED) {
             led_on(LED_ORANGE_ID);
@@ -208,7 +222,7 @@ void motor_test(void) {
     log_clear();
     encoder_init();
     ts_init();
-    ts_add_task_to_queue(&printTimerCount1);
+    ts_add_task_to_queue(&printTimerCount1, NULL);
 
     SET_PIN_MODE_INPUT(GPIOA, 9);
     SET_PIN_MODE_INPUT(GPIOA, 10);
@@ -13,7 +13,21 @@
 /* Private Includes */
 #include "utilities.h"
 #include "unit_tests.h"
-// #include "task_scheduler.h"
+#include "cycle_counter.h"
+#include "monotonic_time.h"
+#include "task_scheduler_1.h"
+#include "event_queue.h"
+#include "ts_sequence.h"
+#include "cyclic_executive.h"
+#include "task_scheduler_us.h"
+#include "synchronous_timer.h"
+#include "real_time_clock.h"
+#include "schedule.h"
+#include "solar.h"
+#include "low_power.h"
+#include "peripheral_clock.h"
+#include "residency.h"
+#include "blind_motor.h"
 
 /* Private STM Includes */
 
@@ -32,7 +46,21 @@ void unit_tests_init(void) {
     log_clear();
 
     /* Run unit tests for each module */
-    // ts_run_unit_tests(); // Task scheduler
+    cc_run_unit_tests();                // Cycle counter
+    time_run_unit_tests();              // Monotonic time
+    ts_run_unit_tests();                // Task scheduler
+    event_queue_run_unit_tests();       // Event queues
+    ts_sequence_run_unit_tests();       // Sequences
+    ce_run_unit_tests();                // Cyclic executive
+    tsu_run_unit_tests();               // Microsecond scheduler lane
+    synchronous_timer_run_unit_tests(); // Time service
+    rtc_run_unit_tests();               // Real time clock calendar
+    schedule_run_unit_tests();          // Blind schedule
+    solar_run_unit_tests();             // Sunrise and sunset
+    lp_run_unit_tests();                // Stop 2 time keeping
+    pclk_run_unit_tests();              // Peripheral clock gating
+    res_run_unit_tests();               // Power state residency
+    bm_run_unit_tests();                // Blind motor stall detection
 }
 
 /* Private Functions */
@@ -18,12 +18,10 @@
 
 /* Public #defines */
 enum ButtonFunctions {
-    FUNC_ID_BUTTON_UP_PROCESS_ISR,
     FUNC_ID_BUTTON_UP_SINGLE_CLICK,
     FUNC_ID_BUTTON_UP_DOUBLE_CLICK,
     FUNC_ID_BUTTON_UP_PRESS_AND_HOLD,
     FUNC_ID_BUTTON_UP_PRESS_AND_HOLD_RELEASED,
-    FUNC_ID_BUTTON_DOWN_PROCESS_ISR,
     FUNC_ID_BUTTON_DOWN_SINGLE_CLICK,
     FUNC_ID_BUTTON_DOWN_DOUBLE_CLICK,
     FUNC_ID_BUTTON_DOWN_PRESS_AND_HOLD,
@@ -51,12 +49,12 @@ void button_init(void);
 void button_isr(uint8_t buttonId);
 
 /**
- * @brief Processes flags that activate internal processes
- * in the button .c file. This function needs to run often
- * to ensure automatic processes like button debouncing are
- * handled correctly
+ * @brief Processes a button edge event added by button_isr(). Must be
+ * called from the main loop
+ *
+ * @param buttonId The id of the button the edge occured on
  */
-void button_process_internal_flags(void);
+void button_process_edge_event(uint8_t buttonId);
 
 uint8_t button_get_state(uint8_t buttonId);
 
@@ -55,8 +55,11 @@ typedef struct ButtonTypeDef {
     const GPIO_TypeDef* port;
     const uint32_t pin;
     const ButtonSettingsTypeDef settings;
-    uint32_t t1Released;
-    uint32_t t2Released;
+    uint64_t t1Released;
+    uint64_t t2Released;
+    TsHandle processISRTask;
+    TsHandle singleClickTask;
+    TsHandle pressAndHoldTask;
 } ButtonTypeDef;
 
 /**
@@ -79,20 +82,26 @@ const struct ButtonSettingsTypeDef ButtonSettings = {
 
 // Declare a structure for button 1
 const struct ButtonTypeDef ButtonUp = {
-    .port       = HC_BUTTON_1_PORT,
-    .pin        = HC_BUTTON_1_PIN,
-    .t1Released = 0,
-    .t2Released = 0,
-    .settings   = ButtonSettings,
+    .port             = HC_BUTTON_1_PORT,
+    .pin              = HC_BUTTON_1_PIN,
+    .t1Released       = 0,
+    .t2Released       = 0,
+    .settings         = ButtonSettings,
+    .processISRTask   = TS_INVALID_HANDLE,
+    .singleClickTask  = TS_INVALID_HANDLE,
+    .pressAndHoldTask = TS_INVALID_HANDLE,
 };
 
 // Declare a structure for button 2
 const struct ButtonTypeDef ButtonDown = {
-    .port       = HC_BUTTON_2_PORT,
-    .pin        = HC_BUTTON_2_PIN,
-    .t1Released = 0,
-    .t2Released = 0,
-    .settings   = ButtonSettings,
+    .port             = HC_BUTTON_2_PORT,
+    .pin              = HC_BUTTON_2_PIN,
+    .t1Released       = 0,
+    .t2Released       = 0,
+    .settings         = ButtonSettings,
+    .processISRTask   = TS_INVALID_HANDLE,
+    .singleClickTask  = TS_INVALID_HANDLE,
+    .pressAndHoldTask = TS_INVALID_HANDLE,
 };
 
     /* Configure generic macros based on the number of buttons being used */
@@ -100,22 +109,24 @@ const struct ButtonTypeDef ButtonDown = {
 
 #endif
 
-/******************** Button 1 Process ISR ********************/
+/******************** Process ISR ********************/
 /**
  * @note Delay for short period of time before processing ISR. Processing ISR means
  * determining whether the interrupt was a rising or falling edge and calling
  * appropriate functions based on the rising/falling interrupt. Experimentally,
  * 12ms delay worked quite well as it gave  enough time for the button to stop
  * debouncing but not too long such that it would prevent ISR from occuring if
- * the button was repeatedly click very quicky
+ * the button was repeatedly click very quicky. The task is shared by all the
+ * buttons, the button the ISR occured on is given as the context
  */
-const struct Task1 bUpProcessISR = {
-    .delay      = 12, // Experimentally 12 seemed to be a good delay time
-    .functionId = FUNC_ID_BUTTON_UP_PROCESS_ISR,
-    .group      = BUTTON_GROUP,
-    .nextTask   = NULL,
+void button_process_isr(void* context);
+
+const struct Task1 bProcessISRTask = {
+    .delay    = 12, // Experimentally 12 seemed to be a good delay time
+    .handler  = button_process_isr,
+    .nextTask = NULL,
 };
-/******************************************************************/
+/*****************************************************/
 
 /******************** Button 1 Single Click Process ********************/
 /**
@@ -149,18 +160,6 @@ const struct Task1 bUpPressAndHold = {
 };
 /*************************************************************************/
 
-/******************** Button 2 Process ISR ********************/
-/**
- * @note Refer to Button 1 Process ISR task for a description
- */
-const struct Task1 bDownProcessISR = {
-    .delay      = 12,
-    .functionId = FUNC_ID_BUTTON_DOWN_PROCESS_ISR,
-    .group      = BUTTON_GROUP,
-    .nextTask   = NULL,
-};
-/******************************************************************/
-
 /******************** Button 2 Single Click Process ********************/
 /**
  * @note Refer to Button 2 Single Click Process task for a description
@@ -187,7 +186,6 @@ const struct Task1 bDownPressAndHold = {
 
 Task1 bSingleClickTasks[NUM_BUTTONS]  = {bUpSingleClick, bDownSingleClick};
 Task1 bPressAndHoldTasks[NUM_BUTTONS] = {bUpPressAndHold, bDownPressAndHold};
-Task1 bProcessISRTasks[NUM_BUTTONS]   = {bUpProcessISR, bDownProcessISR};
 
 ButtonTypeDef buttons[NUM_BUTTONS] = {ButtonUp, ButtonDown};
 
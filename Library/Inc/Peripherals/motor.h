@@ -49,4 +49,13 @@ void motor_brake(uint8_t motorId);
 void motor_stop(uint8_t motorId);
 uint8_t motor_get_state(uint8_t motorId);
 
+/**
+ * @brief Returns whether a motor is being driven forward or in reverse.
+ * Braking is the state the motors rest in so it doesn't count
+ *
+ * @param motorId The ID of the motor
+ * @return uint8_t TRUE if the motor is driving else FALSE
+ */
+uint8_t motor_is_driving(uint8_t motorId);
+
 #endif // MOTOR_H
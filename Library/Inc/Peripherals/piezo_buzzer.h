@@ -22,5 +22,6 @@ typedef struct PiezoNote {
 void piezo_buzzer_init(void);
 void piezo_buzzer_isr(void);
 void piezo_buzzer_play_sound(uint8_t sound);
+uint8_t piezo_buzzer_is_playing(void);
 
 #endif // PIEZO_BUZER_H
\ No newline at end of file
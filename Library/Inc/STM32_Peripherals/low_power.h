@@ -0,0 +1,75 @@
+/**
+ * @file low_power.h
+ * @author Gian Barta-Dougall
+ * @brief Stop 2 mode. LPTIM1 runs from the LSE while the mcu is stopped and
+ * wakes it when the next scheduler task is due
+ * @version 0.1
+ * @date --
+ *
+ * @copyright Copyright (c)
+ *
+ */
+#ifndef LOW_POWER_H
+#define LOW_POWER_H
+
+/* Public Includes */
+
+/* Public STM Includes */
+#include "stm32l4xx.h"
+
+/* Public #defines */
+
+// The uart is off in Stop 2 so the character that wakes the mcu is lost. The
+// mcu stays out of Stop 2 for this long after any character so the rest of a
+// command is received
+#define LP_SERIAL_AWAKE_MS 10000
+
+/* Public Structures and Enumerations */
+
+/* Public Variable Declarations */
+
+/* Public Function Prototypes */
+
+/**
+ * @brief Enters Stop 2 until an interrupt wakes the mcu or the scheduler
+ * needs to run a task. On waking the clocks are restored and the time spent
+ * stopped is added to the scheduler and monotonic time. Must be called with
+ * interrupts disabled. The interrupt that woke the mcu runs once they are
+ * enabled again
+ *
+ * @param maxTicks The longest the mcu can stop for in scheduler ticks
+ * @return uint32_t The time spent stopped in us or 0 if the mcu did not stop
+ * because the time was too short or something needs it to stay awake
+ */
+uint32_t lp_enter_stop_2(uint32_t maxTicks);
+
+/**
+ * @brief Stops the mcu from entering Stop 2 for a length of time
+ *
+ * @param ms The time to stay awake for
+ */
+void lp_keep_awake(uint32_t ms);
+
+/**
+ * @brief Returns the number of times the mcu has entered Stop 2
+ *
+ * @return uint32_t The number of times
+ */
+uint32_t lp_get_stop_count(void);
+
+/**
+ * @brief Clears the compare flag of LPTIM1. Called from the LPTIM1 interrupt
+ */
+void lp_timer_isr(void);
+
+/**
+ * @brief Clears the wake flag of the uart rx pin. Called from the EXTI
+ * interrupt
+ */
+void lp_serial_wake_isr(void);
+
+#if (PROJECT_STATUS == UNIT_TESTS)
+void lp_run_unit_tests(void);
+#endif
+
+#endif // LOW_POWER_H
@@ -0,0 +1,134 @@
+/**
+ * @file real_time_clock.h
+ * @author Gian Barta-Dougall
+ * @brief Calendar and alarms of the real time clock. The clock runs from the
+ * LSE so it keeps time while the mcu is asleep
+ * @version 0.1
+ * @date --
+ *
+ * @copyright Copyright (c)
+ *
+ */
+#ifndef REAL_TIME_CLOCK_H
+#define REAL_TIME_CLOCK_H
+
+/* Public Includes */
+
+/* Public STM Includes */
+#include "stm32l4xx.h"
+
+/* Public #defines */
+#define RTC_ALARM_A    0
+#define RTC_ALARM_B    1
+#define RTC_NUM_ALARMS 2
+
+// Alarms set for this day go off every day
+#define RTC_EVERY_DAY 0
+
+// The calendar can't tell year 2000 apart from a calendar that was never set
+#define RTC_MIN_YEAR 2001
+#define RTC_MAX_YEAR 2099
+
+/* Public Structures and Enumerations */
+
+// Same numbering as the weekday in the calendar registers
+enum RtcWeekdays {
+    RTC_MONDAY = 1,
+    RTC_TUESDAY,
+    RTC_WEDNESDAY,
+    RTC_THURSDAY,
+    RTC_FRIDAY,
+    RTC_SATURDAY,
+    RTC_SUNDAY,
+};
+
+typedef struct RtcDateTime {
+    uint16_t year;
+    uint8_t month;
+    uint8_t day;
+    uint8_t weekday;
+    uint8_t hours;
+    uint8_t minutes;
+    uint8_t seconds;
+} RtcDateTime;
+
+/* Public Variable Declarations */
+
+/* Public Function Prototypes */
+
+/**
+ * @brief Waits for the calendar to be readable. The clock source and alarm
+ * interrupt are configured in hardware_config_init()
+ */
+void rtc_init(void);
+
+/**
+ * @brief Returns whether the calendar has been set since the backup domain
+ * was last reset
+ *
+ * @return uint8_t TRUE if the calendar has been set else FALSE
+ */
+uint8_t rtc_calendar_is_set(void);
+
+/**
+ * @brief Sets the calendar. The weekday is worked out from the date so it
+ * doesn't need to be given
+ *
+ * @param dateTime The date and time to set. The weekday is written back
+ * @return uint8_t TRUE if the calendar was set else FALSE if the date or time
+ * is not valid
+ */
+uint8_t rtc_set_date_time(RtcDateTime* dateTime);
+
+/**
+ * @brief Waits for the shadow registers to be copied from the calendar. Must
+ * be called after waking from Stop mode as the copies stop while the mcu is
+ * stopped and reads would return the time it stopped at
+ */
+void rtc_wait_for_sync(void);
+
+/**
+ * @brief Reads the calendar
+ *
+ * @param dateTime The date and time are written here
+ */
+void rtc_get_date_time(RtcDateTime* dateTime);
+
+/**
+ * @brief Sets an alarm and enables its interrupt. When the alarm goes off an
+ * EVENT_RTC_ALARM event is added with the alarm as the data
+ *
+ * @param alarm RTC_ALARM_A or RTC_ALARM_B
+ * @param weekday The day the alarm goes off on or RTC_EVERY_DAY
+ * @param hours Hours in 24 hour time
+ * @param minutes Minutes
+ * @param seconds Seconds
+ */
+void rtc_set_alarm(uint8_t alarm, uint8_t weekday, uint8_t hours, uint8_t minutes, uint8_t seconds);
+
+/**
+ * @brief Disables an alarm and its interrupt
+ *
+ * @param alarm RTC_ALARM_A or RTC_ALARM_B
+ */
+void rtc_disable_alarm(uint8_t alarm);
+
+/**
+ * @brief Clears the flags of the alarms that went off and passes them to the
+ * main loop. Called from the rtc alarm interrupt
+ */
+void rtc_alarm_isr(void);
+
+/**
+ * @brief Returns the short name of a weekday
+ *
+ * @param weekday The weekday
+ * @return const char* The name or "---" if the weekday isn't valid
+ */
+const char* rtc_get_weekday_name(uint8_t weekday);
+
+#if (PROJECT_STATUS == UNIT_TESTS)
+void rtc_run_unit_tests(void);
+#endif
+
+#endif // REAL_TIME_CLOCK_H
@@ -4,13 +4,14 @@
 #include "stm32l432xx.h"
 #include "stm32l4xx_hal.h"
 
-#define ENCODER_1_LIMIT_REACHED (0x01 << 0)
-#define ENCODER_2_LIMIT_REACHED (0x01 << 1)
-
 #define ENCODER_ID_OFFSET 23
 #define ENCODER_1_ID      (0 + ENCODER_ID_OFFSET)
 #define ENCODER_2_ID      (1 + ENCODER_ID_OFFSET)
 
+// Status of the connection while it is still being probed. This number is
+// arbitrary but unique like CONNECTED and DISCONNECTED
+#define ENCODER_PROBE_RUNNING 95
+
 void encoder_init(void);
 
 uint32_t encoder_get_count(uint8_t encoderId);
@@ -18,7 +19,6 @@ uint32_t encoder_get_count(uint8_t encoderId);
 void encoder_set_direction_up(uint8_t encoderId);
 void encoder_set_direction_down(uint8_t encoderId);
 
-void encoder_limit_reached_isr(uint8_t encoderId);
 void encoder_disable_limits(uint8_t encoderId);
 uint8_t encoder_limits_are_valid(uint8_t encoderId);
 
@@ -28,7 +28,40 @@ uint8_t encoder_at_max_height(uint8_t encoderId);
 void encoder_enable(uint8_t encoderId);
 void encoder_disable(uint8_t encoderId);
 
-uint8_t encoder_probe_connection(uint8_t encoderId);
+/**
+ * @brief Keeps the clock of the encoder timer on so it counts. The timer
+ * only counts edges while its clock is requested. Every other function turns
+ * the clock on for as long as it needs it so only counting needs a request
+ *
+ * @param encoderId The id of the encoder
+ */
+void encoder_request_clock(uint8_t encoderId);
+
+/**
+ * @brief Gives back a request made with encoder_request_clock()
+ *
+ * @param encoderId The id of the encoder
+ */
+void encoder_release_clock(uint8_t encoderId);
+
+/**
+ * @brief Starts probing whether the encoder is connected. The probe waits for
+ * the pin to charge and discharge on the microsecond scheduler lane so it
+ * doesn't block. The result is read with encoder_get_probe_status()
+ *
+ * @param encoderId The id of the encoder
+ */
+void encoder_probe_connection(uint8_t encoderId);
+
+/**
+ * @brief Gets the result of the last probe of the encoder connection
+ *
+ * @param encoderId The id of the encoder
+ * @return uint8_t CONNECTED or DISCONNECTED, ENCODER_PROBE_RUNNING while the
+ * probe hasn't finished or INVALID_ID if the id is invalid
+ */
+uint8_t encoder_get_probe_status(uint8_t encoderId);
+
 uint8_t encoder_get_state(uint8_t encoderId);
 
 void encoder_set_lower_bound_interrupt(uint8_t encoderId);
@@ -3,6 +3,7 @@
 
 #include "encoder.h"
 #include "hardware_config.h"
+#include "task_scheduler_us.h"
 
 /* Includes for repeated recipes */
 #define UNSET 0
@@ -17,8 +18,11 @@ typedef struct Encoder {
     GPIO_TypeDef* port;
     const uint32_t pin;
     TIM_TypeDef* timer;
+    const uint8_t clock;
     uint32_t minCount;
     uint32_t maxCount;
+    uint8_t probeStatus;
+    TsHandle probeHandle;
 } Encoder;
 
 /* Initialise encoder configurations */
@@ -30,6 +34,7 @@ const Encoder encoder1 = {
     .port     = HC_ENCODER_1_PORT,
     .pin      = HC_ENCODER_1_PIN,
     .timer    = HC_ENCODER_1_TIMER,
+    .clock    = HC_ENCODER_1_TIMER_CLOCK,
     .minCount = ZERO_COUNT,
     .maxCount = ZERO_COUNT + 10,
 };
@@ -39,6 +44,7 @@ const Encoder encoder2 = {
     .port  = HC_ENCODER_2_PORT,
     .pin   = HC_ENCODER_2_PIN,
     .timer = HC_ENCODER_2_TIMER,
+    .clock = HC_ENCODER_2_TIMER_CLOCK,
 };
 
     #define NUM_ENCODERS 2
@@ -9,4 +9,6 @@
 
 uint8_t chars_same(char* str1, char* str2);
 
+uint8_t chars_starts_with(char* str, char* prefix);
+
 #endif // CHAR_H
\ No newline at end of file
@@ -0,0 +1,123 @@
+/**
+ * @file cycle_counter.h
+ * @author Gian Barta-Dougall
+ * @brief Short delays and time measurements using the cycle counter of the
+ * DWT unit. The counter runs at the system clock so it resolves a single cycle
+ * @version 0.1
+ * @date --
+ *
+ * @copyright Copyright (c)
+ *
+ */
+#ifndef CYCLE_COUNTER_H
+#define CYCLE_COUNTER_H
+
+/* Public Includes */
+#include "version_config.h"
+
+/* Public STM Includes */
+#include "stm32l4xx.h"
+
+/* Public #defines */
+
+// Longest delay that can be compared without the counter wrapping in between
+#define CC_MAX_DELAY_CYCLES 0x7FFFFFFF
+
+#define CC_GET_CYCLES()        (DWT->CYCCNT)
+#define CC_CYCLES_SINCE(start) (DWT->CYCCNT - (start))
+
+// TRUE once the counter has reached the target. Stays correct when the
+// counter wraps as long as the two are less than CC_MAX_DELAY_CYCLES apart
+#define CC_CYCLES_REACHED(now, target) (((int32_t)((now) - (target))) >= 0)
+
+// Called first thing in an isr so cc_measure_isr_latency() can see when it
+// was entered
+#define CC_MARK_ISR_ENTRY() (ccIsrEntryCycles = CC_GET_CYCLES())
+
+/* Public Structures and Enumerations */
+
+/* Public Variable Declarations */
+
+extern volatile uint32_t ccIsrEntryCycles;
+
+/* Public Function Prototypes */
+
+/**
+ * @brief Starts the cycle counter. Can be called more than once
+ */
+void cc_init(void);
+
+/**
+ * @brief Converts microseconds to cycles at the current system clock
+ *
+ * @param us Microseconds
+ * @return uint32_t Cycles. Capped at CC_MAX_DELAY_CYCLES
+ */
+uint32_t cc_us_to_cycles(uint32_t us);
+
+/**
+ * @brief Converts nanoseconds to cycles at the current system clock. Rounds up
+ * so a delay is never shorter than asked for
+ *
+ * @param ns Nanoseconds
+ * @return uint32_t Cycles
+ */
+uint32_t cc_ns_to_cycles(uint32_t ns);
+
+/**
+ * @brief Converts cycles to microseconds at the current system clock
+ *
+ * @param cycles Cycles
+ * @return uint32_t Microseconds, rounded down
+ */
+uint32_t cc_cycles_to_us(uint32_t cycles);
+
+/**
+ * @brief Converts cycles to nanoseconds at the current system clock
+ *
+ * @param cycles Cycles
+ * @return uint32_t Nanoseconds, rounded down. Capped at UINT_32_BIT_MAX_VALUE
+ */
+uint32_t cc_cycles_to_ns(uint32_t cycles);
+
+/**
+ * @brief Spins for at least the given number of cycles. Interrupts that run
+ * during the delay make it longer
+ *
+ * @param cycles Cycles to wait. Capped at CC_MAX_DELAY_CYCLES
+ */
+void cc_delay_cycles(uint32_t cycles);
+
+/**
+ * @brief Spins for at least the given number of microseconds. Only for short
+ * waits, longer waits should be tasks in the task scheduler
+ *
+ * @param us Microseconds to wait
+ */
+void cc_delay_us(uint32_t us);
+
+/**
+ * @brief Spins for at least the given number of nanoseconds. The delay is a
+ * whole number of cycles plus the time taken to call the function
+ *
+ * @param ns Nanoseconds to wait
+ */
+void cc_delay_ns(uint32_t ns);
+
+/**
+ * @brief Measures the cycles from an interrupt being pended to its isr being
+ * entered. The isr must call CC_MARK_ISR_ENTRY(). It is pended several times
+ * with nothing to do and the shortest time is kept so other interrupts don't
+ * inflate the result. Must be called with interrupts enabled from a priority
+ * lower than the interrupt
+ *
+ * @param irq The interrupt to measure
+ * @return uint32_t The entry latency in cycles or 0 if the isr never ran
+ */
+uint32_t cc_measure_isr_latency(IRQn_Type irq);
+
+#if (PROJECT_STATUS == UNIT_TESTS)
+void cc_run_unit_tests(void);
+#endif
+
+#endif // CYCLE_COUNTER_H
@@ -0,0 +1,130 @@
+/**
+ * @file cyclic_executive.h
+ * @author Gian Barta-Dougall
+ * @brief Runs control loop callbacks at fixed rates from a hardware timer
+ * @version 0.1
+ * @date --
+ *
+ * @copyright Copyright (c)
+ *
+ */
+#ifndef CYCLIC_EXECUTIVE_H
+#define CYCLIC_EXECUTIVE_H
+
+/* Public Includes */
+#include "version_config.h"
+
+/* Public STM Includes */
+#include "stm32l4xx.h"
+
+/* Public #defines */
+
+// Maximum number of callbacks that can be added across all rate groups
+#define CE_MAX_SLOTS 8
+
+// Returned when a callback could not be added
+#define CE_INVALID_SLOT 0xFF
+
+// Length of each frame. Every callback in the 1kHz group runs once a frame
+#define CE_FRAME_PERIOD_US 1000
+
+// The total budget of the callbacks that can run in the same frame. The rest
+// of the frame is left for the task scheduler and the other interrupts
+#define CE_FRAME_BUDGET_US 800
+
+/* Public Structures and Enumerations */
+
+// The 100Hz and 10Hz groups run in different frames so they never add to
+// each other's worst case. Only the 1kHz group shares a frame with them
+enum CeRateGroups {
+    CE_RATE_1KHZ,
+    CE_RATE_100HZ,
+    CE_RATE_10HZ,
+    CE_NUM_RATE_GROUPS,
+};
+
+/* Public Variable Declarations */
+
+/* Public Function Prototypes */
+
+/**
+ * @brief Removes all callbacks, stops the frame interrupt and resets the
+ * statistics. Must be called after ts_init() as both share the same timer
+ */
+void ce_init(void);
+
+/**
+ * @brief Adds a callback to a rate group. The frame interrupt is started
+ * when the first callback is added. Callbacks run from the scheduler timer
+ * interrupt so they must be short and must not block
+ *
+ * @param rateGroup The rate the callback is run at
+ * @param handler The callback
+ * @param budgetUs The longest the callback is expected to take in
+ * microseconds. Runs longer than this are counted as overruns
+ * @return uint8_t The slot the callback was added to. CE_INVALID_SLOT if
+ * there are no free slots or the callbacks that share a frame would no
+ * longer fit in CE_FRAME_BUDGET_US
+ */
+uint8_t ce_add_slot(uint8_t rateGroup, void (*handler)(void), uint32_t budgetUs);
+
+/**
+ * @brief Removes a callback. The frame interrupt is stopped when the last
+ * callback is removed
+ *
+ * @param slot The slot returned when the callback was added
+ */
+void ce_remove_slot(uint8_t slot);
+
+/**
+ * @brief Runs the callbacks that are due in the current frame. Must be called
+ * from the capture compare 2 interrupt of the scheduler timer
+ */
+void ce_isr(void);
+
+/**
+ * @brief Gets the number of times the callback ran longer than its budget
+ *
+ * @param slot The slot of the callback
+ * @return uint32_t The number of overruns
+ */
+uint32_t ce_get_slot_overruns(uint8_t slot);
+
+/**
+ * @brief Gets the longest time the callback has taken to run
+ *
+ * @param slot The slot of the callback
+ * @return uint32_t The time in microseconds
+ */
+uint32_t ce_get_slot_max_time_us(uint8_t slot);
+
+/**
+ * @brief Gets the number of frames that were missed because the interrupt
+ * couldn't run in time, normally because the previous frame ran too long
+ *
+ * @return uint32_t The number of missed frames
+ */
+uint32_t ce_get_frame_overruns(void);
+
+/**
+ * @brief Returns whether the cyclic executive has any callbacks to run
+ *
+ * @return uint8_t TRUE if the frames are running else FALSE
+ */
+uint8_t ce_is_running(void);
+
+/**
+ * @brief Prints the budget, longest run time and overruns of each callback
+ */
+void ce_print_statistics(void);
+
+/**
+ * @brief Resets the longest run times and overrun counts
+ */
+void ce_reset_statistics(void);
+
+#if (PROJECT_STATUS == UNIT_TESTS)
+void ce_run_unit_tests(void);
+#endif
+
+#endif // CYCLIC_EXECUTIVE_H
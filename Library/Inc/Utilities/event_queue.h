@@ -0,0 +1,109 @@
+/**
+ * @file event_queue.h
+ * @author Gian Barta-Dougall
+ * @brief Lock free queues for passing events from interrupts to the main loop
+ * @version 0.1
+ * @date --
+ *
+ * @copyright Copyright (c)
+ *
+ */
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+/* Public Includes */
+
+/* Public STM Includes */
+#include "stm32l4xx.h"
+
+/* Public #defines */
+
+// There is one queue for each interrupt priority that produces events. Every
+// interrupt that adds to a queue must have the same priority so they can never
+// interrupt each other. This keeps each queue single producer, single consumer
+#define EVENT_QUEUE_ID_OFFSET    81
+#define EQ_MAX_PRIORITY_QUEUE_ID (0 + EVENT_QUEUE_ID_OFFSET) // USART2
+#define EQ_PRIORITY_2_QUEUE_ID   (1 + EVENT_QUEUE_ID_OFFSET) // Currently unused
+#define EQ_PRIORITY_5_QUEUE_ID   (2 + EVENT_QUEUE_ID_OFFSET) // EXTI, comparators, encoder timers and rtc alarms
+#define NUM_EVENT_QUEUES         3
+
+// Number of events each queue can hold. Must be a power of 2
+#define EVENT_QUEUE_SIZE 32
+
+#if ((EVENT_QUEUE_SIZE & (EVENT_QUEUE_SIZE - 1)) != 0)
+#    error EVENT_QUEUE_SIZE must be a power of 2
+#endif
+
+/* Public Structures and Enumerations */
+
+enum EventTypes {
+    EVENT_BUTTON_EDGE,
+    EVENT_ENCODER_MAX_HEIGHT_REACHED,
+    EVENT_ENCODER_MIN_HEIGHT_REACHED,
+    EVENT_SERIAL_CHARACTER_RECEIVED,
+    EVENT_SERIAL_PARITY_ERROR,
+    EVENT_INTERRUPT_LOG,
+    EVENT_RTC_ALARM,
+};
+
+typedef struct Event {
+    uint32_t timestamp; // Lower 32 bits of time_now_us() when the event was added
+    uint8_t type;
+    uint8_t data;
+} Event;
+
+/* Public Variable Declarations */
+
+/* Public Function Prototypes */
+
+/**
+ * @brief Adds an event to the given queue. Must only be called from an
+ * interrupt with the priority the queue belongs to
+ *
+ * @param queueId The id of the queue to add the event to
+ * @param type The type of event
+ * @param data Data for the event. Its meaning depends on the event type
+ */
+void event_queue_push(uint8_t queueId, uint8_t type, uint8_t data);
+
+/**
+ * @brief Removes the oldest event out of all the queues. Must only be
+ * called from the main loop
+ *
+ * @param event The event is copied into here
+ * @return uint8_t TRUE if an event was removed else FALSE if all the
+ * queues are empty
+ */
+uint8_t event_queue_pop(Event* event);
+
+/**
+ * @brief Returns whether every queue is empty. Must only be called from
+ * the main loop
+ *
+ * @return uint8_t TRUE if there are no events waiting else FALSE
+ */
+uint8_t event_queue_is_empty(void);
+
+/**
+ * @brief Returns the number of events that were lost because the given
+ * queue was full
+ *
+ * @param queueId The id of the queue
+ * @return uint32_t The number of events lost
+ */
+uint32_t event_queue_get_overflow_count(uint8_t queueId);
+
+/**
+ * @brief Returns the most events that have been waiting in the given queue
+ * at once. Useful for sizing the queue and measuring bursts of interrupts
+ *
+ * @param queueId The id of the queue
+ * @return uint32_t The maximum number of events waiting at once
+ */
+uint32_t event_queue_get_max_occupancy(uint8_t queueId);
+
+#if (PROJECT_STATUS == UNIT_TESTS)
+void event_queue_run_unit_tests(void);
+#endif
+
+#endif // EVENT_QUEUE_H
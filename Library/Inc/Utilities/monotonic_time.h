@@ -0,0 +1,73 @@
+/**
+ * @file monotonic_time.h
+ * @author Gian Barta-Dougall
+ * @brief Single time base for the whole system. A free running 1MHz timer is
+ * extended to 64 bits by counting its overflows so every timestamp taken from
+ * here can be compared with every other
+ * @version 0.1
+ * @date --
+ *
+ * @copyright Copyright (c)
+ *
+ */
+#ifndef MONOTONIC_TIME_H
+#define MONOTONIC_TIME_H
+
+/* Public Includes */
+#include "version_config.h"
+
+/* Public STM Includes */
+#include "stm32l4xx.h"
+
+/* Public #defines */
+#define TIME_US_PER_MS 1000
+
+/* Public Structures and Enumerations */
+
+/* Public Variable Declarations */
+
+/* Public Function Prototypes */
+
+/**
+ * @brief Gets the time since the timer was started in hardware_config_init().
+ * Can be called from any priority
+ *
+ * @return uint64_t Microseconds since start up
+ */
+uint64_t time_now_us(void);
+
+/**
+ * @brief Gets the time since the timer was started in hardware_config_init().
+ * Can be called from any priority
+ *
+ * @return uint64_t Milliseconds since start up
+ */
+uint64_t time_now_ms(void);
+
+/**
+ * @brief Gets the full time of a timestamp that only kept the lower 32 bits
+ * of time_now_us(). The timestamp must be less than 71 minutes old
+ *
+ * @param timestamp The lower 32 bits of the time in microseconds
+ * @return uint64_t The time in microseconds
+ */
+uint64_t time_extend_us(uint32_t timestamp);
+
+/**
+ * @brief Counts an overflow of the timer. Called from the timer interrupt
+ */
+void time_overflow_isr(void);
+
+/**
+ * @brief Moves the time forward. The timer doesn't count in Stop 2 so the
+ * time spent stopped is added back on when the mcu wakes up
+ *
+ * @param us Microseconds to move the time forward by
+ */
+void time_advance_us(uint64_t us);
+
+#if (PROJECT_STATUS == UNIT_TESTS)
+void time_run_unit_tests(void);
+#endif
+
+#endif // MONOTONIC_TIME_H
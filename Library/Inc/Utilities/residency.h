@@ -0,0 +1,125 @@
+/**
+ * @file residency.h
+ * @author Gian Barta-Dougall
+ * @brief Records how long the mcu spends running, asleep and stopped and how
+ * long each load on the board is on. Together with the currents in
+ * residency_config.h this estimates the charge each blind uses per day
+ * @version 0.1
+ * @date --
+ *
+ * @copyright Copyright (c)
+ *
+ */
+#ifndef RESIDENCY_H
+#define RESIDENCY_H
+
+/* Public Includes */
+
+/* Public STM Includes */
+#include "stm32l4xx.h"
+
+/* Public #defines */
+
+// Each motor has its own states so the charge can be split between the blinds
+// they move
+#define RES_NUM_MOTORS                (RES_MOTOR_1_BRAKING - RES_MOTOR_1_DRIVING)
+#define RES_MOTOR_DRIVING(motorIndex) (RES_MOTOR_1_DRIVING + (motorIndex))
+#define RES_MOTOR_BRAKING(motorIndex) (RES_MOTOR_1_BRAKING + (motorIndex))
+
+// Run and sleep draw a different current in each mcu clock profile
+#define RES_NUM_PROFILE_STATES           (RES_SLEEP + 1)
+#define RES_STATE_FOLLOWS_PROFILE(state) (state < RES_NUM_PROFILE_STATES)
+
+/* Public Structures and Enumerations */
+
+/**
+ * The mcu is always in exactly one of run, sleep or stop. The rest are loads
+ * that draw current on top of the mcu and can be on in any combination
+ */
+enum ResidencyStates {
+    RES_RUN,
+    RES_SLEEP,
+    RES_STOP,
+    RES_MOTOR_1_DRIVING,
+    RES_MOTOR_2_DRIVING,
+    RES_MOTOR_1_BRAKING,
+    RES_MOTOR_2_BRAKING,
+    RES_BUZZER_ON,
+    RES_ADC_ON,
+    RES_NUM_STATES,
+};
+
+/* Public Variable Declarations */
+
+/* Public Function Prototypes */
+
+/**
+ * @brief Clears every recorded time and starts recording from now
+ */
+void res_reset(void);
+
+/**
+ * @brief Adds time the mcu spent asleep or stopped. Every other moment is
+ * counted as run
+ *
+ * @param state RES_SLEEP or RES_STOP
+ * @param us Microseconds spent in the state
+ */
+void res_add_idle_time(uint8_t state, uint32_t us);
+
+/**
+ * @brief Records that the mcu has switched clock profile. Run and sleep time
+ * from now on are counted against the new profile. Called by
+ * mcu_clock_set_profile()
+ *
+ * @param profile The profile switched to
+ */
+void res_set_clock_profile(uint8_t profile);
+
+/**
+ * @brief Starts timing a load. Does nothing if the load is already on. Can
+ * be called from any priority
+ *
+ * @param state The load
+ */
+void res_load_on(uint8_t state);
+
+/**
+ * @brief Stops timing a load. Does nothing if the load is already off. Can
+ * be called from any priority
+ *
+ * @param state The load
+ */
+void res_load_off(uint8_t state);
+
+/**
+ * @brief Returns the total time recorded in a state since the last reset.
+ * Loads that are still on are counted up to now
+ *
+ * @param state The state
+ * @return uint64_t The time in microseconds
+ */
+uint64_t res_get_time_us(uint8_t state);
+
+/**
+ * @brief Returns the time recorded in run, sleep or stop while the mcu was in
+ * a clock profile since the last reset
+ *
+ * @param state RES_RUN, RES_SLEEP or RES_STOP
+ * @param profile The clock profile
+ * @return uint64_t The time in microseconds
+ */
+uint64_t res_get_profile_time_us(uint8_t state, uint8_t profile);
+
+/**
+ * @brief Prints the percentage of time the mcu spent in each state, the time
+ * each load was on and the estimated charge the board and each blind uses
+ * per day
+ */
+void res_print(void);
+
+#if (PROJECT_STATUS == UNIT_TESTS)
+void res_run_unit_tests(void);
+#endif
+
+#endif // RESIDENCY_H
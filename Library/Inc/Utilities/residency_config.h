@@ -0,0 +1,41 @@
+#ifndef RESIDENCY_CONFIG_H
+#define RESIDENCY_CONFIG_H
+
+/* Public Includes */
+#include "version_config.h"
+#include "residency.h"
+#include "mcu_clock.h"
+
+/* Current drawn in each state in uA */
+
+#if (VERSION_MAJOR == 0)
+
+/**
+ * Run and sleep currents depend on the clock profile. These are the typical
+ * values from the datasheet running from flash, 4MHz MSI in voltage range 2
+ * and 80MHz PLL in voltage range 1
+ */
+const uint32_t residencyProfileCurrents[MCU_CLOCK_NUM_PROFILES][RES_NUM_PROFILE_STATES] = {
+    [MCU_CLOCK_LOW_POWER]   = {[RES_RUN] = 450, [RES_SLEEP] = 150},
+    [MCU_CLOCK_PERFORMANCE] = {[RES_RUN] = 8300, [RES_SLEEP] = 2150},
+};
+
+/**
+ * The stop current is the typical value from the datasheet. The loads are
+ * estimates and should be replaced with measurements of the board. Braking is
+ * the state the motors rest in so its current is the quiescent current of the
+ * motor driver. Run and sleep are in residencyProfileCurrents
+ */
+const uint32_t residencyCurrents[RES_NUM_STATES] = {
+    [RES_STOP]            = 2,
+    [RES_MOTOR_1_DRIVING] = 150000,
+    [RES_MOTOR_2_DRIVING] = 150000,
+    [RES_MOTOR_1_BRAKING] = 10,
+    [RES_MOTOR_2_BRAKING] = 10,
+    [RES_BUZZER_ON]       = 5000,
+    [RES_ADC_ON]          = 250,
+};
+
+#endif
+
+#endif // RESIDENCY_CONFIG_H
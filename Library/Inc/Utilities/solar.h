@@ -0,0 +1,107 @@
+/**
+ * @file solar.h
+ * @author Gian Barta-Dougall
+ * @brief Sunrise and sunset times worked out from the date and the location
+ * of the blinds. The times are found once a day so the light sensor only has
+ * to be read around sunrise and sunset
+ * @version 0.1
+ * @date --
+ *
+ * @copyright Copyright (c)
+ *
+ */
+#ifndef SOLAR_H
+#define SOLAR_H
+
+/* Public Includes */
+
+/* Public STM Includes */
+#include "stm32l4xx.h"
+
+/* Public #defines */
+
+// Minutes either side of sunrise and sunset the light sensor is used for
+#define SOLAR_TWILIGHT_MINUTES 30
+
+/* Public Structures and Enumerations */
+
+enum SolarPeriods {
+    SOLAR_UNKNOWN, // The calendar hasn't been set
+    SOLAR_NIGHT,
+    SOLAR_DAY,
+};
+
+// Near the poles the sun can stay up or down for the whole day
+enum SolarPolarStates {
+    SOLAR_POLAR_NONE,
+    SOLAR_POLAR_DAY,
+    SOLAR_POLAR_NIGHT,
+};
+
+typedef struct SolarLocation {
+    float latitude;    // Degrees, north is positive
+    float longitude;   // Degrees, east is positive
+    int16_t utcOffset; // Minutes the local time is ahead of UTC
+} SolarLocation;
+
+typedef struct SolarTimes {
+    uint16_t sunrise; // Minute of the local day
+    uint16_t sunset;  // Minute of the local day
+    uint8_t polarState;
+} SolarTimes;
+
+/* Public Variable Declarations */
+
+/* Public Function Prototypes */
+
+/**
+ * @brief Finds the sunrise and sunset for today. The real time clock must be
+ * initialised first
+ */
+void solar_init(void);
+
+/**
+ * @brief Finds the sunrise and sunset for the current date and sets an alarm
+ * to find them again after midnight. Must be called whenever the calendar
+ * is changed
+ */
+void solar_update(void);
+
+/**
+ * @brief Works out the sunrise and sunset at a location on a date
+ *
+ * @param location The location
+ * @param year The year
+ * @param month The month from 1 to 12
+ * @param day The day of the month
+ * @param times The sunrise and sunset in local time are written here
+ */
+void solar_calculate(const SolarLocation* location, uint16_t year, uint8_t month, uint8_t day, SolarTimes* times);
+
+/**
+ * @brief Returns whether the sun is currently up
+ *
+ * @return uint8_t SOLAR_DAY, SOLAR_NIGHT or SOLAR_UNKNOWN if the calendar
+ * hasn't been set
+ */
+uint8_t solar_get_period(void);
+
+/**
+ * @brief Returns whether it is currently close to sunrise or sunset. The
+ * light sensor decides whether it is light outside during this time
+ *
+ * @return uint8_t TRUE if within SOLAR_TWILIGHT_MINUTES of sunrise or sunset
+ * else FALSE
+ */
+uint8_t solar_is_twilight(void);
+
+/**
+ * @brief Prints the sunrise and sunset for today
+ */
+void solar_print(void);
+
+#if (PROJECT_STATUS == UNIT_TESTS)
+void solar_run_unit_tests(void);
+#endif
+
+#endif // SOLAR_H
@@ -1,7 +1,9 @@
 /**
  * @file synchronous_timer.h
  * @author Gian Barta-Dougall
- * @brief System file for synchronous_timer
+ * @brief Time service for the system. The time since the service was enabled
+ * is worked out from the monotonic time when it is asked for and the
+ * synchronous events are scheduled as tasks so no timer has to tick in between
  * @version 0.1
  * @date --
  *
@@ -20,18 +22,46 @@
 
 /* Public Structures and Enumerations */
 
+typedef struct SyncTime {
+    uint16_t hours;
+    uint8_t minutes;
+    uint8_t seconds;
+    uint16_t milliseconds;
+} SyncTime;
+
 /* Public Variable Declarations */
 
 /* Public Function Prototypes */
 
 /**
- * @brief Enable the timer which lets the interrupts run
+ * @brief Starts the time at 00:00:00 and schedules the synchronous events.
+ * The task scheduler must be initialised first
  */
 void synchronous_timer_enable(void);
 
 /**
- * @brief Disable the timer which stops the interrupts from running
+ * @brief Cancels the synchronous events. The time keeps counting
  */
 void synchronous_timer_disable(void);
 
+/**
+ * @brief Gets the time since the synchronous timer was enabled. Must only be
+ * called from the main loop
+ *
+ * @param time The hours, minutes, seconds and milliseconds are written here
+ */
+void synchronous_timer_get_time(SyncTime* time);
+
+/**
+ * @brief Gets the number of whole seconds since the synchronous timer was
+ * enabled. Must only be called from the main loop
+ *
+ * @return uint32_t The number of seconds
+ */
+uint32_t synchronous_timer_get_seconds(void);
+
+#if (PROJECT_STATUS == UNIT_TESTS)
+void synchronous_timer_run_unit_tests(void);
+#endif
+
 #endif // SYNCHRONOUS_TIMER_H
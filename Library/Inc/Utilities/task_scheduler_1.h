@@ -24,30 +24,256 @@
 #define AMBIENT_LIGHT_SENSOR_GROUP (2 + TASK_SCHEDULER_OFFSET)
 #define BLIND_MOTOR_GROUP          (3 + TASK_SCHEDULER_OFFSET)
 #define BLIND_GROUP                (4 + TASK_SCHEDULER_OFFSET)
+#define TS_NO_GROUP                (5 + TASK_SCHEDULER_OFFSET)
+#define TS_NUM_GROUPS              6
+
+// Number of bins in the dispatch latency histograms. Latency is measured from
+// the end of the slack of a task. Bin 0 counts tasks that were dispatched on
+// time and bin n counts latencies from 2^(n - 1) up to
+// 2^n - 1 ticks. The last bin also counts everything longer
+#define TS_LATENCY_HISTOGRAM_BINS 16
 
 #define MAX_TASKS_PER_RECIPE 10
 
 #define TS_TASK_CANCELLED 1
 #define TS_TASK_NOT_FOUND 0
 
+// Maximum number of tasks that can be queued at any one time. Can be overridden
+// at compile time. Tasks added when the queue is full are counted as overflows.
+// Large queues are only expected in the host benchmarks
+#ifndef TS_QUEUE_CAPACITY
+#    define TS_QUEUE_CAPACITY 32
+#endif
+
+#if ((TS_QUEUE_CAPACITY < 1) || (TS_QUEUE_CAPACITY > 4096))
+#    error TS_QUEUE_CAPACITY must be between 1 and 4096
+#endif
+
+// Longest delay a task can have. Execution times are compared as signed 32 bit
+// differences so anything longer would appear to be in the past. At 1kHz this
+// is just under 25 days
+#define TS_MAX_DELAY 0x7FFFFFFF
+
+// Returned by ts_get_time_until_next_wake() when the queue is empty
+#define TS_NO_WAKE 0xFFFFFFFF
+
+// Value of a handle that doesn't refer to any task. Modules should initialise
+// their handles to this value
+#define TS_INVALID_HANDLE 0
+
 /* Public Structures and Enumerations */
+
+// What happens when the next deadline of a chained task has already passed by
+// the time the main loop moves onto it. Skipping drops the missed periods so
+// the task stays on its original phase without running multiple times in a
+// row. Catching up runs the task once for every period that was missed
+enum TsOverrunPolicies {
+    TS_OVERRUN_SKIP,
+    TS_OVERRUN_CATCH_UP,
+};
+
+// Tasks with a handler are run from the main loop by default. Preemptive tasks
+// have their handler run from the PendSV interrupt as soon as they are due so
+// they can't be held up by slow work in the main loop such as logging. Their
+// handlers must run to completion quickly and must not block
+enum TsPriorities {
+    TS_PRIORITY_MAIN_LOOP,
+    TS_PRIORITY_PREEMPTIVE,
+};
+
+// A task either sets the flag given by its function id and group when it
+// finishes, or if it has a handler, the handler is called from the main loop
+// in ts_process_internal_flags() with the context the task was added with.
+// The delay of a task added to the queue is measured from the time it was
+// added. The delay of a chained task is measured from the deadline of the
+// task before it so a task that chains to itself runs with a fixed period.
+// The slack is how much later than its delay a task is allowed to run. The
+// scheduler uses it to run tasks with overlapping windows on a single wakeup.
+// The delay plus the slack must be less than TS_MAX_DELAY
 typedef struct Task1 {
-    const uint16_t delay;
+    const uint32_t delay;
+    const uint32_t slack;
     const uint8_t functionId;
     const uint8_t group;
     const struct Task1* nextTask;
+    void (*const handler)(void* context);
+    const uint8_t overrunPolicy;
+    const uint8_t priority;
 } Task1;
 
+// Refers to a single instance of a task in the queue. The handle stays valid
+// while the task (and any tasks chained after it) are running
+typedef uint32_t TsHandle;
+
 /* Public Variable Declarations */
 
 /* Public Function Prototypes */
 
 void ts_init(void);
 void ts_isr(void);
+
+/**
+ * @brief Keeps track of the number of times the scheduler timer has wrapped.
+ * Must be called from the update interrupt of the scheduler timer
+ */
+void ts_overflow_isr(void);
+
+/**
+ * @brief Runs the handlers of preemptive tasks that have finished. Must be
+ * called from the PendSV interrupt
+ */
+void ts_preemptive_isr(void);
+
+
+/**
+ * @brief Calls the handlers of tasks that have finished and moves finished
+ * tasks onto their next task. Needs to be called from the main loop
+ */
 void ts_process_internal_flags(void);
-void ts_add_task_to_queue(const Task1* task);
-uint8_t ts_cancel_running_task(const Task1* task);
-uint8_t ts_task_is_running(const Task1* task);
+
+/**
+ * @brief Adds a task to the queue. If the handle refers to a task that is
+ * still waiting in the queue, that task is re-armed with the new delay
+ * instead of a second copy being added
+ *
+ * @param task The task to add
+ * @param handle Handle to store the queued task in. Can be NULL if the task
+ * never needs to be cancelled or re-armed
+ */
+void ts_add_task_to_queue(const Task1* task, TsHandle* handle);
+
+/**
+ * @brief Adds a task to the queue along with a context that is passed to the
+ * handler of the task when it runs. This allows the same task to be used for
+ * multiple instances of a module. Re-arming works the same as
+ * ts_add_task_to_queue()
+ *
+ * @param task The task to add
+ * @param context Pointer passed to the handler of the task and any tasks chained after it
+ * @param handle Handle to store the queued task in. Can be NULL
+ */
+void ts_add_task_with_context_to_queue(const Task1* task, void* context, TsHandle* handle);
+
+/**
+ * @brief Adds a task to the queue with a delay that is only known at run time.
+ * The delay given is used instead of the delay of the task. Any tasks chained
+ * after it still use their own delays. Re-arming works the same as
+ * ts_add_task_to_queue()
+ *
+ * @param task The task to add
+ * @param context Pointer passed to the handler of the task. Can be NULL
+ * @param delay The delay until the task runs
+ * @param handle Handle to store the queued task in. Can be NULL
+ */
+void ts_add_task_with_delay_to_queue(const Task1* task, void* context, uint32_t delay, TsHandle* handle);
+
+/**
+ * @brief Cancels the task the handle refers to. The handle is invalidated
+ *
+ * @param handle The handle of the task to cancel
+ * @return uint8_t TS_TASK_CANCELLED if the task was running else TS_TASK_NOT_FOUND
+ */
+uint8_t ts_cancel_running_task(TsHandle* handle);
+
+/**
+ * @brief Checks whether the task the handle refers to is still running
+ *
+ * @param handle The handle of the task
+ * @return uint8_t TRUE if the task is running else FALSE
+ */
+uint8_t ts_task_is_running(TsHandle handle);
+
+/**
+ * @brief Returns the total time between the end of the slack of the task and
+ * when the main loop processed it, summed over every task in its chain. A
+ * task processed within its slack isn't late
+ *
+ * @param handle The handle of the task
+ * @return uint32_t The accumulated lateness in scheduler ticks or 0 if the
+ * task is not running
+ */
+uint32_t ts_get_task_lateness(TsHandle handle);
+
+/**
+ * @brief Returns the number of periods that have been skipped by a chained
+ * task with the TS_OVERRUN_SKIP policy because it was running late
+ *
+ * @param handle The handle of the task
+ * @return uint32_t The number of skipped periods or 0 if the task is not running
+ */
+uint32_t ts_get_task_skipped_periods(TsHandle handle);
+
+/**
+ * @brief Returns the number of tasks that could not be added because
+ * the queue was full
+ *
+ * @return uint32_t The number of tasks dropped since ts_init() was called
+ */
+uint32_t ts_get_overflow_count(void);
+
+/**
+ * @brief Returns the current time of the scheduler. Unlike the timer count
+ * this does not wrap every timer period
+ *
+ * @return uint32_t The number of scheduler ticks since ts_init() was called
+ */
+uint32_t ts_get_time(void);
+
+/**
+ * @brief Returns the number of tasks currently waiting in the queue
+ *
+ * @return uint16_t The number of queued tasks
+ */
+uint16_t ts_get_num_tasks_in_queue(void);
+
+/**
+ * @brief Returns how long until the scheduler timer next needs to wake the
+ * mcu to run a task
+ *
+ * @return uint32_t The time in scheduler ticks, 0 if a task is already due or
+ * TS_NO_WAKE if the queue is empty
+ */
+uint32_t ts_get_time_until_next_wake(void);
+
+/**
+ * @brief Moves the time of the scheduler forward. The timer doesn't count in
+ * Stop 2 so the time spent stopped is added back on when the mcu wakes up.
+ * Tasks that became due while stopped run as soon as this returns
+ *
+ * @param ticks Scheduler ticks to move the time forward by
+ */
+void ts_advance_time(uint32_t ticks);
+
+/**
+ * @brief Prints the scheduler statistics recorded since they were last reset.
+ * This includes a histogram of the time between the end of the slack of each
+ * task and when it was dispatched by the main loop for each group, the most
+ * tasks that have been queued at once, the number of tasks dropped because the
+ * queue was full, the number of finished tasks handled per main loop and the
+ * cycles spent in the last and longest scheduler isr
+ */
+void ts_print_statistics(void);
+
+/**
+ * @brief Clears the scheduler statistics. The overflow count is not cleared
+ */
+void ts_reset_statistics(void);
+
+/**
+ * @brief Records the cycles the scheduler isr took to run. The scheduler
+ * doesn't measure this itself so it doesn't depend on the cycle counter
+ *
+ * @param cycles Cycles from entering to leaving the isr
+ */
+void ts_record_isr_cycles(uint32_t cycles);
+
+/**
+ * @brief Returns whether there are tasks that have run but have not yet
+ * been processed by ts_process_internal_flags()
+ *
+ * @return uint8_t TRUE if there are finished tasks waiting else FALSE
+ */
+uint8_t ts_has_finished_tasks(void);
 
 /**
  * @brief Initialise the system library.
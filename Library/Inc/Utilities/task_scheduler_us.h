@@ -0,0 +1,139 @@
+/**
+ * @file task_scheduler_us.h
+ * @author Gian Barta-Dougall
+ * @brief Microsecond resolution lane of the task scheduler
+ * @version 0.1
+ * @date --
+ *
+ * @copyright Copyright (c)
+ *
+ */
+#ifndef TASK_SCHEDULER_US_H
+#define TASK_SCHEDULER_US_H
+
+/* Public Includes */
+#include "task_scheduler_1.h"
+
+/* Public STM Includes */
+#include "stm32l4xx.h"
+
+/* Public #defines */
+
+// Maximum number of tasks that can be queued in the microsecond lane at once.
+// The lane is meant for a few short precise actions so it is kept small
+#ifndef TSU_QUEUE_CAPACITY
+#    define TSU_QUEUE_CAPACITY 8
+#endif
+
+#if ((TSU_QUEUE_CAPACITY < 1) || (TSU_QUEUE_CAPACITY > 32))
+#    error TSU_QUEUE_CAPACITY must be between 1 and 32
+#endif
+
+/* Public Structures and Enumerations */
+
+/* Public Variable Declarations */
+
+/* Public Function Prototypes */
+
+/**
+ * The microsecond lane takes the same Task1 recipes as the task scheduler but
+ * the delays are in microseconds. The handler of each task is called straight
+ * from the lane's timer interrupt as soon as it is due, so handlers must be
+ * short and must not block. Tasks without a handler can't be added because the
+ * scheduler flags are only ever written from the main loop. Chained tasks are
+ * measured from the deadline of the task before them and follow the overrun
+ * policy of the next task. Slack and priority are ignored
+ */
+
+/**
+ * @brief Removes every task and stops the lane's timer. Handles given out
+ * before this are invalidated
+ */
+void tsu_init(void);
+
+/**
+ * @brief Adds the wrapped time of the timer period that just ended. Must be
+ * called from the update interrupt of the lane's timer
+ */
+void tsu_overflow_isr(void);
+
+/**
+ * @brief Runs the handlers of every task that is due and sets the timer for the
+ * next task. Must be called from the interrupt of the lane's timer
+ */
+void tsu_isr(void);
+
+/**
+ * @brief Adds a task to the lane. Re-arming works the same as ts_add_task_to_queue()
+ *
+ * @param task The task to add. Must have a handler
+ * @param handle Handle to store the queued task in. Can be NULL
+ */
+void tsu_add_task_to_queue(const Task1* task, TsHandle* handle);
+
+/**
+ * @brief Adds a task to the lane along with a context that is passed to its
+ * handler. Re-arming works the same as ts_add_task_to_queue()
+ *
+ * @param task The task to add. Must have a handler
+ * @param context Pointer passed to the handler of the task and any tasks chained after it
+ * @param handle Handle to store the queued task in. Can be NULL
+ */
+void tsu_add_task_with_context_to_queue(const Task1* task, void* context, TsHandle* handle);
+
+/**
+ * @brief Adds a task to the lane with a delay that is only known at run time.
+ * Any tasks chained after it still use their own delays
+ *
+ * @param task The task to add. Must have a handler
+ * @param context Pointer passed to the handler of the task. Can be NULL
+ * @param delay The delay in microseconds until the task runs
+ * @param handle Handle to store the queued task in. Can be NULL
+ */
+void tsu_add_task_with_delay_to_queue(const Task1* task, void* context, uint32_t delay, TsHandle* handle);
+
+/**
+ * @brief Cancels the task the handle refers to. The handle is invalidated
+ *
+ * @param handle The handle of the task to cancel
+ * @return uint8_t TS_TASK_CANCELLED if the task was running else TS_TASK_NOT_FOUND
+ */
+uint8_t tsu_cancel_running_task(TsHandle* handle);
+
+/**
+ * @brief Checks whether the task the handle refers to (or a task chained after
+ * it) is still waiting to run
+ *
+ * @param handle The handle of the task
+ * @return uint8_t TRUE if the task is running else FALSE
+ */
+uint8_t tsu_task_is_running(TsHandle handle);
+
+/**
+ * @brief Returns the current time of the lane. The timer is stopped while the
+ * lane is empty so this only advances while tasks are queued
+ *
+ * @return uint32_t The time in microseconds
+ */
+uint32_t tsu_get_time(void);
+
+/**
+ * @brief Returns the number of tasks currently waiting in the lane
+ *
+ * @return uint16_t The number of queued tasks
+ */
+uint16_t tsu_get_num_tasks_in_queue(void);
+
+/**
+ * @brief Returns the number of tasks that could not be added because the lane
+ * was full or the task had no handler
+ *
+ * @return uint32_t The number of tasks dropped since tsu_init() was called
+ */
+uint32_t tsu_get_overflow_count(void);
+
+#if (PROJECT_STATUS == UNIT_TESTS)
+void tsu_run_unit_tests(void);
+#endif
+
+#endif // TASK_SCHEDULER_US_H
@@ -0,0 +1,160 @@
+/**
+ * @file ts_sequence.h
+ * @author Gian Barta-Dougall
+ * @brief Multi-step sequences that wait on the task scheduler instead of blocking
+ * @version 0.1
+ * @date --
+ *
+ * @copyright Copyright (c)
+ *
+ */
+#ifndef TS_SEQUENCE_H
+#define TS_SEQUENCE_H
+
+/* Public Includes */
+#include "task_scheduler_1.h"
+#include "utilities.h"
+
+/* Public STM Includes */
+#include "stm32l4xx.h"
+
+/* Public #defines */
+
+// Value of the awaited event when the sequence isn't waiting for an event
+#define TS_SEQUENCE_NO_EVENT 0xFF
+
+/**
+ * A sequence is a function that can wait part way through without blocking the
+ * main loop. Every wait returns from the function and the next time the function
+ * is called it jumps straight back to where it waited. For example
+ *
+ *  void example_sequence(TsSequence* sequence) {
+ *      TS_SEQUENCE_BEGIN(sequence);
+ *
+ *      led_on(LED_GREEN_ID);
+ *      TS_AWAIT_MS(sequence, 1000);
+ *      led_off(LED_GREEN_ID);
+ *      TS_AWAIT_EVENT(sequence, EXAMPLE_EVENT);
+ *
+ *      TS_SEQUENCE_END(sequence);
+ *  }
+ *
+ * Because the function returns every time it waits, local variables do not keep
+ * their value across a wait. Anything that needs to be remembered must be stored
+ * in the context of the sequence or a static variable. Waits can't be used inside
+ * a switch statement in the sequence function
+ */
+#define TS_SEQUENCE_BEGIN(sequence) \
+    switch ((sequence)->line) {     \
+        case 0:
+
+#define TS_SEQUENCE_END(sequence) \
+    }                             \
+    (sequence)->line    = 0;      \
+    (sequence)->running = FALSE
+
+// Waits the given number of milliseconds before continuing the sequence. The
+// wait is measured from when the sequence was resumed so it is never shorter
+// than asked for, but the time the main loop took to resume the sequence adds
+// up over every wait
+#define TS_AWAIT_MS(sequence, ms)           \
+    do {                                    \
+        (sequence)->line = __LINE__;        \
+        ts_sequence_wait((sequence), (ms)); \
+        return;                             \
+        case __LINE__:;                     \
+    } while (0)
+
+// Waits until the scheduler reaches the given time. Continues straight away if
+// the time has passed. Waiting until a fixed time after the deadline of an
+// earlier wait stops the main loop latency of the steps in between adding up
+#define TS_AWAIT_UNTIL(sequence, time)              \
+    do {                                            \
+        (sequence)->line = __LINE__;                \
+        ts_sequence_wait_until((sequence), (time)); \
+        return;                                     \
+        case __LINE__:;                             \
+    } while (0)
+
+// Waits until the event is posted to the sequence with ts_sequence_post_event().
+// Events posted before the sequence starts waiting for them are ignored
+#define TS_AWAIT_EVENT(sequence, event)      \
+    do {                                     \
+        (sequence)->line         = __LINE__; \
+        (sequence)->awaitedEvent = (event);  \
+        return;                              \
+        case __LINE__:;                      \
+    } while (0)
+
+/* Public Structures and Enumerations */
+
+typedef struct TsSequence {
+    void (*const function)(struct TsSequence* sequence);
+    void* context;
+    uint16_t line;
+    uint8_t running;
+    uint8_t awaitedEvent;
+    TsHandle handle;
+    uint32_t deadline; // Scheduler time the last wait was due to finish at
+} TsSequence;
+
+/* Public Variable Declarations */
+
+/* Public Function Prototypes */
+
+/**
+ * @brief Starts the sequence from the beginning. The sequence function is first
+ * called from the main loop. A sequence that is already running is restarted
+ *
+ * @param sequence The sequence to start
+ */
+void ts_sequence_start(TsSequence* sequence);
+
+/**
+ * @brief Stops the sequence wherever it is currently waiting
+ *
+ * @param sequence The sequence to stop
+ */
+void ts_sequence_stop(TsSequence* sequence);
+
+/**
+ * @brief Continues the sequence if it is waiting for the given event. Must
+ * be called from the main loop
+ *
+ * @param sequence The sequence to post the event to
+ * @param event The event that occured
+ */
+void ts_sequence_post_event(TsSequence* sequence, uint8_t event);
+
+/**
+ * @brief Checks whether the sequence is still running
+ *
+ * @param sequence The sequence to check
+ * @return uint8_t TRUE if the sequence has been started and has not finished
+ * else FALSE
+ */
+uint8_t ts_sequence_is_running(TsSequence* sequence);
+
+/**
+ * @brief Schedules the sequence to continue after the given delay. Used by
+ * TS_AWAIT_MS() and should not be called directly
+ *
+ * @param sequence The sequence to continue
+ * @param delay The delay in milliseconds
+ */
+void ts_sequence_wait(TsSequence* sequence, uint32_t delay);
+
+/**
+ * @brief Schedules the sequence to continue at the given scheduler time. Used
+ * by TS_AWAIT_UNTIL() and should not be called directly
+ *
+ * @param sequence The sequence to continue
+ * @param time The scheduler time to continue at
+ */
+void ts_sequence_wait_until(TsSequence* sequence, uint32_t time);
+
+#if (PROJECT_STATUS == UNIT_TESTS)
+void ts_sequence_run_unit_tests(void);
+#endif
+
+#endif // TS_SEQUENCE_H
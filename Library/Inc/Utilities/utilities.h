@@ -13,6 +13,7 @@
 
 /* Public Includes */
 #include "log.h"
+#include "version_config.h"
 
 /* Public STM Includes */
 #include "stm32l4xx.h"
@@ -55,11 +56,13 @@
 // find any bugs quicker
 #define INVALID_ID 94
 
-// Defines for the different configuration modes for the GPIO pins
-#define SET_PIN_MODE_INPUT(port, pin)              (port->MODER &= ~(0x03 << (pin * 2)))
-#define SET_PIN_MODE_OUTPUT(port, pin)             (port->MODER |= (0x01 << (pin * 2)))
-#define SET_PIN_MODE_ALTERNATE_FUNCTION(port, pin) (port->MODER |= (0x02 << (pin * 2)))
-#define SET_PIN_MODE_ANALOGUE(port, pin)           (port->MODER |= (0x03 << (pin * 2)))
+// Defines for the different configuration modes for the GPIO pins. The mode
+// register of a port is shared by pins changed from the main loop and from
+// interrupts so each read-modify-write is done with interrupts off
+#define SET_PIN_MODE_INPUT(port, pin)              ATOMIC_MODIFY(port->MODER &= ~(0x03 << (pin * 2)))
+#define SET_PIN_MODE_OUTPUT(port, pin)             ATOMIC_MODIFY(port->MODER |= (0x01 << (pin * 2)))
+#define SET_PIN_MODE_ALTERNATE_FUNCTION(port, pin) ATOMIC_MODIFY(port->MODER |= (0x02 << (pin * 2)))
+#define SET_PIN_MODE_ANALOGUE(port, pin)           ATOMIC_MODIFY(port->MODER |= (0x03 << (pin * 2)))
 #define SET_PIN_TYPE_PUSH_PULL(port, pin)          (port->OTYPER &= ~(0x03 << pin))
 #define SET_PIN_TYPE_OPEN_DRAIN(port, pin)         (port->OTYPER |= (0x01 << pin))
 #define SET_PIN_SPEED_LOW(port, pin)               (port->OSPEEDR &= ~(0x03 << (pin * 2)))
@@ -88,6 +91,36 @@
 #define FLAG_CLEAR(flag, bit)  (flag &= ~(0x01 << bit))
 #define FLAG_SET(flag, bit)    (flag |= (0x01 << bit))
 
+// Disables interrupts and records the previous interrupt mask so critical
+// sections can be nested safely. The state variable must be a uint32_t
+#define ENTER_CRITICAL_SECTION(state) \
+    do {                              \
+        state = __get_PRIMASK();      \
+        __disable_irq();              \
+    } while (0)
+#define EXIT_CRITICAL_SECTION(state) __set_PRIMASK(state)
+
+// Runs a single read-modify-write of a register in a critical section
+#define ATOMIC_MODIFY(modification)            \
+    do {                                       \
+        uint32_t atomicPrimask;                \
+        ENTER_CRITICAL_SECTION(atomicPrimask); \
+        modification;                          \
+        EXIT_CRITICAL_SECTION(atomicPrimask);  \
+    } while (0)
+
+// Places a function in SRAM2 so it runs with no flash wait states. The startup
+// copies it out of flash before main. Kept for the interrupt hot paths as
+// SRAM2 is only 16KB. Disabling RAM_FUNCTIONS_ENABLED runs everything from
+// flash to compare the two. The host build of the scheduler has no SRAM2 but
+// RAM_FUNCTIONS_ON_HOST gives it the same attributes so the cost of keeping
+// the functions out of line can be benchmarked
+#if defined(RAM_FUNCTIONS_ENABLED) && (defined(__arm__) || defined(RAM_FUNCTIONS_ON_HOST))
+#    define RAM_FUNCTION __attribute__((section(".ramfunc"), noinline))
+#else
+#    define RAM_FUNCTION
+#endif
+
 #define UINT_8_BIT_MAX_VALUE  255
 #define UINT_16_BIT_MAX_VALUE 65535
 #define UINT_32_BIT_MAX_VALUE 4294967295
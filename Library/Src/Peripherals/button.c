@@ -12,6 +12,8 @@
 
 /* Private Includes */
 #include "utilities.h"
+#include "event_queue.h"
+#include "monotonic_time.h"
 
 /* Private Includes */
 #include "button_configuration.h"
@@ -83,15 +85,20 @@ void button_isr(uint8_t button) {
     // call multiple interrupts
     button_disable_interrupt(button);
 
+    // Let the main loop know the button changed state. The ISR is processed from
+    // there so the interrupt never has to touch the task scheduler
+    event_queue_push(EQ_PRIORITY_5_QUEUE_ID, EVENT_BUTTON_EDGE, button);
+}
+
+void button_process_edge_event(uint8_t button) {
+
     // Schedule processing of ISR to occur after a small delay. All button bouncing
     // should finish before the delay finishes => when the ISr is processed and the
     // IDR is read, the reading is reliable. From testing, reading the IDR in the ISR
     // is not 100% reliable because bounces can be very quick (~10us) - quick
     // enough for signal to bounce back to the wrong value when you read the ISR
     // giving a wrong reading
-    ts_add_task_to_queue(&bProcessISRTasks[button]);
-
-    return;
+    ts_add_task_with_context_to_queue(&bProcessISRTask, &buttons[button], &buttons[button].processISRTask);
 }
 
 void button_action_on_pressed(uint8_t index) {
@@ -106,7 +113,7 @@ void button_action_on_pressed(uint8_t index) {
     // and that timer task will have already finished and left
     // the timer queue thus it doesn't matter if we try cancel
     // it
-    ts_cancel_running_task(&bSingleClickTasks[index]);
+    ts_cancel_running_task(&buttons[index].singleClickTask);
 
     // Any button press may be a 'press and hold' button press.
     // Given this, we need to start a timer task for press and
@@ -116,7 +123,7 @@ void button_action_on_pressed(uint8_t index) {
     // task can finish, it will be cancelled when the button is
     // released
     // // log_prints(("Start press and hold\r\n");
-    ts_add_task_to_queue(&bPressAndHoldTasks[index]);
+    ts_add_task_to_queue(&bPressAndHoldTasks[index], &buttons[index].pressAndHoldTask);
 }
 
 void button_on_action_released(uint8_t index) {
@@ -125,7 +132,7 @@ void button_on_action_released(uint8_t index) {
     // If the difference between time 1 and time 2 < maxDoubleClickTime
     // for the given button then we know a double click has just occured
     TIME_RELEASED_2(index) = TIME_RELEASED_1(index);
-    TIME_RELEASED_1(index) = HAL_GetTick();
+    TIME_RELEASED_1(index) = time_now_ms();
 
     // Anytime the button is pressed, a press and hold timer task is added
     // to the queue. If we try cancel the press and hold timer task and
@@ -135,7 +142,7 @@ void button_on_action_released(uint8_t index) {
     // 'press and hold' => either a double or a single click. If the function
     // returns 0 then the press and hold timer task must have finished and
     // been removed already which means it was a press and hold
-    if (ts_cancel_running_task(&bPressAndHoldTasks[index]) == TS_TASK_CANCELLED) {
+    if (ts_cancel_running_task(&buttons[index].pressAndHoldTask) == TS_TASK_CANCELLED) {
 
         // If the difference between this button release and the last button
         // release < (max time difference between releases for a double click)
@@ -162,7 +169,7 @@ void button_on_action_released(uint8_t index) {
         // to timer. If another click doesn't happen quickly enough the timer task
         // will call the appropriate function. If another click does happen quickly
         // enough, this task will be cancelled
-        ts_add_task_to_queue(&bSingleClickTasks[index]);
+        ts_add_task_to_queue(&bSingleClickTasks[index], &buttons[index].singleClickTask);
 
         // log_prints(("Maybe single click\r\n");
         // Return so only the single click function is called
@@ -181,31 +188,16 @@ void button_on_action_released(uint8_t index) {
     // Call appropriate function for this button when a 'press and hold' has finished
 }
 
-void button_process_internal_flags(void) {
-
-    if (FLAG_IS_SET(buttonTasksFlag, FUNC_ID_BUTTON_UP_PROCESS_ISR)) {
-        FLAG_CLEAR(buttonTasksFlag, FUNC_ID_BUTTON_UP_PROCESS_ISR);
+void button_process_isr(void* context) {
 
-        button_enable_interrupt(BUTTON_UP_INDEX);
+    uint8_t index = (ButtonTypeDef*)context - buttons;
 
-        // Determine whether the ISR was a rising or falling edge
-        if (button_get_state(BUTTON_UP_INDEX) == BUTTON_PRESSED) {
-            button_action_on_pressed(BUTTON_UP_INDEX);
-        } else {
-            button_on_action_released(BUTTON_UP_INDEX);
-        }
-    }
-
-    if (FLAG_IS_SET(buttonTasksFlag, FUNC_ID_BUTTON_DOWN_PROCESS_ISR)) {
-        FLAG_CLEAR(buttonTasksFlag, FUNC_ID_BUTTON_DOWN_PROCESS_ISR);
+    button_enable_interrupt(index);
 
-        button_enable_interrupt(BUTTON_DOWN_INDEX);
-
-        // Determine whether the ISR was a rising or falling edge
-        if (button_get_state(BUTTON_DOWN_INDEX) == BUTTON_PRESSED) {
-            button_action_on_pressed(BUTTON_DOWN_INDEX);
-        } else {
-            button_on_action_released(BUTTON_DOWN_INDEX);
-        }
+    // Determine whether the ISR was a rising or falling edge
+    if (button_get_state(index) == BUTTON_PRESSED) {
+        button_action_on_pressed(index);
+    } else {
+        button_on_action_released(index);
     }
 }
\ No newline at end of file
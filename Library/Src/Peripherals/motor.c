@@ -14,6 +14,7 @@
 #include "motor_config.h"
 #include "utilities.h"
 #include "log.h"
+#include "residency.h"
 
 /* Private STM Includes */
 
@@ -40,6 +41,7 @@
 /* Private Variable Declarations */
 
 /* Private Function Prototypes */
+void motor_record_state(uint8_t index, uint8_t state);
 
 /* Public Functions */
 
@@ -52,6 +54,7 @@ void motor_forward(uint8_t motorId) {
     uint8_t index = motorId - MOTOR_ID_OFFSET;
     SET_PIN_HIGH(motors[index].ports[0], motors[index].pins[0]);
     SET_PIN_LOW(motors[index].ports[1], motors[index].pins[1]);
+    motor_record_state(index, MOTOR_FORWARD);
 }
 
 void motor_reverse(uint8_t motorId) {
@@ -61,15 +64,17 @@ void motor_reverse(uint8_t motorId) {
     uint8_t index = motorId - MOTOR_ID_OFFSET;
     SET_PIN_LOW(motors[index].ports[0], motors[index].pins[0]);
     SET_PIN_HIGH(motors[index].ports[1], motors[index].pins[1]);
+    motor_record_state(index, MOTOR_REVERSE);
 }
 
-void motor_brake(uint8_t motorId) {
+RAM_FUNCTION void motor_brake(uint8_t motorId) {
 
     ASSERT_VALID_MOTOR_ID(motorId);
 
     uint8_t index = motorId - MOTOR_ID_OFFSET;
     SET_PIN_HIGH(motors[index].ports[0], motors[index].pins[0]);
     SET_PIN_HIGH(motors[index].ports[1], motors[index].pins[1]);
+    motor_record_state(index, MOTOR_BRAKE);
 }
 
 void motor_stop(uint8_t motorId) {
@@ -79,6 +84,7 @@ void motor_stop(uint8_t motorId) {
     uint8_t index = motorId - MOTOR_ID_OFFSET;
     SET_PIN_LOW(motors[index].ports[0], motors[index].pins[0]);
     SET_PIN_LOW(motors[index].ports[1], motors[index].pins[1]);
+    motor_record_state(index, MOTOR_STOP);
 }
 
 uint8_t motor_get_state(uint8_t motorId) {
@@ -108,4 +114,33 @@ uint8_t motor_get_state(uint8_t motorId) {
     return MOTOR_BRAKE;
 }
 
-/* Private Functions */
\ No newline at end of file
+uint8_t motor_is_driving(uint8_t motorId) {
+
+    uint8_t state = motor_get_state(motorId);
+
+    return ((state == MOTOR_FORWARD) || (state == MOTOR_REVERSE)) ? TRUE : FALSE;
+}
+
+/* Private Functions */
+
+/**
+ * @brief Records the time the motor spends driving and braking. Called every
+ * time the pins are written, including from the encoder interrupts
+ *
+ * @param index The index of the motor
+ * @param state The state the motor was put in
+ */
+RAM_FUNCTION void motor_record_state(uint8_t index, uint8_t state) {
+
+    if ((state == MOTOR_FORWARD) || (state == MOTOR_REVERSE)) {
+        res_load_on(RES_MOTOR_DRIVING(index));
+    } else {
+        res_load_off(RES_MOTOR_DRIVING(index));
+    }
+
+    if (state == MOTOR_BRAKE) {
+        res_load_on(RES_MOTOR_BRAKING(index));
+    } else {
+        res_load_off(RES_MOTOR_BRAKING(index));
+    }
+}
\ No newline at end of file
@@ -14,6 +14,7 @@
 #include "piezo_buzzer.h"
 #include "hardware_config.h"
 #include "log.h"
+#include "residency.h"
 
 /* STM32 Includes */
 
@@ -61,6 +62,9 @@ PiezoNote sounds[NUM_SOUNDS] = {SOUND_0, SOUND_1, SOUND_2, SOUND_3};
 /* Variable Declarations */
 uint8_t pbIndex = 0;
 
+// Whether the buzzer is holding the clock of its timer
+uint8_t pbClockOn = FALSE;
+
 /* Function prototypes */
 void piezo_buzzer_set_note(void);
 void piezo_buzzer_enable(void);
@@ -74,14 +78,24 @@ void piezo_buzzer_play_sound(uint8_t startIndex) {
     }
 
     pbIndex = startIndex;
-    piezo_buzzer_enable();
+
+    // Stop any sound that is already playing. The clock of the timer is off
+    // when nothing is playing so it has to be turned on before the note is set
     piezo_buzzer_disable();
+    piezo_buzzer_enable();
 
     // Set the next note to be played by the buzzer
     piezo_buzzer_set_note();
+}
 
-    // Enable the buzzer
-    piezo_buzzer_enable();
+uint8_t piezo_buzzer_is_playing(void) {
+
+    // The timer reads back as 0 while its clock is off
+    if (pbClockOn == FALSE) {
+        return FALSE;
+    }
+
+    return ((PIEZO_TIMER->CR1 & TIM_CR1_CEN) == TIM_CR1_CEN) ? TRUE : FALSE;
 }
 
 void piezo_buzzer_isr(void) {
@@ -107,13 +121,30 @@ void piezo_buzzer_set_note(void) {
 }
 
 void piezo_buzzer_disable(void) {
+
+    if (pbClockOn == FALSE) {
+        return;
+    }
+
     PIEZO_TIMER->DIER &= ~(TIM_DIER_UIE);    // Disable interrupts
     PIEZO_TIMER->CR1 &= ~(TIM_CR1_CEN);      // Disable the timer
     PIEZO_TIMER->CCMR1 &= ~(TIM_CCMR1_OC1M); // Reset PWM mode
     PIEZO_TIMER->CCMR1 |= TIM_CCMR1_OC1M_3;  // Force PWM output low
+
+    // The output is held low so the clock can be gated until the next sound
+    pclk_release(HC_PIEZO_BUZZER_TIMER_CLOCK);
+    pbClockOn = FALSE;
+    res_load_off(RES_BUZZER_ON);
 }
 
 void piezo_buzzer_enable(void) {
+
+    if (pbClockOn == FALSE) {
+        pclk_request(HC_PIEZO_BUZZER_TIMER_CLOCK);
+        pbClockOn = TRUE;
+        res_load_on(RES_BUZZER_ON);
+    }
+
     PIEZO_TIMER->DIER |= TIM_DIER_UIE;                           // Enable interrupts
     PIEZO_TIMER->CCMR1 |= (TIM_CCMR1_OC1M_1 | TIM_CCMR1_OC1M_2); // Set mode to PWM mode 1
     PIEZO_TIMER->CR1 |= TIM_CR1_CEN;                             // Enable the counter
@@ -12,16 +12,27 @@
 
 /* Private Includes */
 #include "adc_config.h"
+#include "cycle_counter.h"
+#include "peripheral_clock.h"
+#include "utilities.h"
+#include "residency.h"
 
 /* Private STM Includes */
 
 /* Private #defines */
 
+// Maximum startup time of the ADC voltage regulator from the datasheet
+#define ADC_REGULATOR_STARTUP_US 20
+
 /* Private Structures and Enumerations */
 
 /* Private Variable Declarations */
 
+// Whether the ADC is holding its clock
+uint8_t adcClockOn = FALSE;
+
 /* Private Function Prototypes */
+void adc_config_request_clock(void);
 
 /* Public Functions */
 
@@ -34,7 +45,7 @@ void adc_config_init(void) {}
 void adc_config_als1_init(void) {
 
     // Initialise the system clock for ADC
-    RCC->AHB2ENR |= RCC_AHB2ENR_ADCEN; // Enables the ADC clock
+    adc_config_request_clock();
 
     RCC->CCIPR |= 0x03 << 28; // Selects the system clock to be ADC clock
 
@@ -61,7 +72,7 @@ void adc_config_als1_init(void) {
 
     ADC1->CR &= ~(ADC_CR_DEEPPWD);            // Take ADC out of deep power down mode
     ADC1->CR |= (ADC_CR_ADVREGEN);            // Enable ADC voltage regulator
-    HAL_Delay(1);                             // Max startup time for voltage regulator is 20us
+    cc_delay_us(ADC_REGULATOR_STARTUP_US);    // Wait for the voltage regulator to start
     ADC1->CR &= ~(ADC_CR_ADEN);               // Ensure the ADC is disabled before calibration begins
     ADC1->CR &= ~(ADC_CR_ADCALDIF);           // Select calibration mode to single ended input
     ADC1->CR |= (ADC_CR_ADCAL);               // Start calibration
@@ -72,6 +83,10 @@ void adc_config_als1_init(void) {
 
 uint16_t adc_config_adc1_convert(void) {
 
+    // The clock is released between conversions. The calibration and settings
+    // are kept while it is off
+    adc_config_request_clock();
+
     ADC1->CR |= ADC_CR_ADEN;                    // Enable the ADC
     while ((ADC1->ISR & ADC_ISR_ADRDY) == 0) {} // Wait until ADC is ready
     ADC1->CR |= ADC_CR_ADSTART;                 // Start conversion
@@ -82,6 +97,10 @@ uint16_t adc_config_adc1_convert(void) {
 
 void adc_config_adc1_disable(void) {
 
+    if (adcClockOn == FALSE) {
+        return;
+    }
+
     // Wait until there are no on going conversions
     while ((ADC1->CR & (ADC_CR_ADSTART | ADC_CR_JADSTART)) != 0) {}
 
@@ -90,6 +109,21 @@ void adc_config_adc1_disable(void) {
 
     // Wait until the ADC has been disabled
     while ((ADC1->CR & ADC_CR_ADEN) != 0) {}
+
+    pclk_release(PCLK_ADC);
+    adcClockOn = FALSE;
+    res_load_off(RES_ADC_ON);
 }
 
 /* Private Functions */
+
+void adc_config_request_clock(void) {
+
+    if (adcClockOn == TRUE) {
+        return;
+    }
+
+    pclk_request(PCLK_ADC);
+    adcClockOn = TRUE;
+    res_load_on(RES_ADC_ON);
+}
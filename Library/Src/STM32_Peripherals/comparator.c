@@ -14,6 +14,7 @@
 /* Private Includes */
 #include "comparator.h"
 #include "debug_log.h"
+#include "interrupts_config.h"
 
 /* STM32 Includes */
 
@@ -84,7 +85,7 @@ void comparator_hardware_init(void) {
     EXTI->FTSR1 |= EXTI_FTSR1_FT21; // Disable interrupt on falling edge
 
     // Configure interrupt priorities
-    HAL_NVIC_SetPriority(COMP_IRQn, 9, 0);
+    HAL_NVIC_SetPriority(COMP_IRQn, COMP_ISR_PRIORITY, 0);
 	HAL_NVIC_EnableIRQ(COMP_IRQn);
 
     // Enable comparator 1 and 2
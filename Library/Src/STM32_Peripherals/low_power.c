@@ -0,0 +1,285 @@
+/**
+ * @file low_power.c
+ * @author Gian Barta-Dougall
+ * @brief Stop 2 mode. LPTIM1 runs from the LSE while the mcu is stopped and
+ * wakes it when the next scheduler task is due
+ * @version 0.1
+ * @date --
+ *
+ * @copyright Copyright (c)
+ *
+ */
+/* Public Includes */
+
+/* Private Includes */
+#include "low_power.h"
+#include "hardware_config.h"
+#include "mcu_clock.h"
+#include "monotonic_time.h"
+#include "task_scheduler_1.h"
+#include "real_time_clock.h"
+#include "utilities.h"
+#include "log.h"
+
+/* Private STM Includes */
+#include "stm32l4xx_hal.h"
+
+/* Private #defines */
+#define LP_TIMER        HC_LP_TIMER
+#define LP_TIMER_PERIOD (HC_LP_TIMER_MAX_COUNT + 1)
+
+#define LP_US_PER_SECOND  1000000
+#define LP_US_PER_TS_TICK (LP_US_PER_SECOND / HC_TS_TIMER_FREQUENCY)
+
+// Waking from Stop 2 and restoring the clocks costs more than sleeping for a
+// couple of ticks saves so short waits use sleep instead
+#define LP_MIN_STOP_TICKS 3
+
+// The compare value is kept well short of a full period so the count can't
+// pass it before the mcu has stopped
+#define LP_MAX_STOP_COUNTS (LP_TIMER_PERIOD - 1024)
+
+#define LP_SERIAL_WAKE_LINE (0x01 << HC_DEBUG_LOG_RX_PIN)
+
+/* Private Structures and Enumerations */
+
+/* Private Variable Declarations */
+
+// Parts of a us, of a scheduler tick and of a HAL tick left over from previous
+// stops. They are added to the next stop so the time doesn't drift from the LSE
+uint32_t lpCountRemainder = 0;
+uint32_t lpUsRemainder    = 0;
+uint32_t lpHalUsRemainder = 0;
+
+uint64_t lpAwakeUntilMs = 0;
+uint32_t lpStopCount    = 0;
+
+/* Private Function Prototypes */
+uint32_t lp_get_count(void);
+uint32_t lp_counts_to_us(uint32_t counts);
+uint32_t lp_us_to_ticks(uint32_t us);
+uint32_t lp_us_to_hal_ticks(uint32_t us);
+
+/* Public Functions */
+
+uint32_t lp_enter_stop_2(uint32_t maxTicks) {
+
+    if ((maxTicks < LP_MIN_STOP_TICKS) || (time_now_ms() < lpAwakeUntilMs)) {
+        return 0;
+    }
+
+    // A character still being sent would be cut off when the uart clock stops
+    if ((USART2->ISR & USART_ISR_TC) == 0) {
+        return 0;
+    }
+
+    uint64_t maxCounts = ((uint64_t)maxTicks * LP_US_PER_TS_TICK * HC_LP_TIMER_FREQUENCY) / LP_US_PER_SECOND;
+    uint32_t start     = lp_get_count();
+
+    if (maxCounts > LP_MAX_STOP_COUNTS) {
+        maxCounts = LP_MAX_STOP_COUNTS;
+    }
+
+    // The compare register can only be written once the last write has reached
+    // the LSE clock domain
+    while ((LP_TIMER->ISR & LPTIM_ISR_CMPOK) == 0) {}
+    LP_TIMER->ICR = LPTIM_ICR_CMPOKCF;
+    LP_TIMER->CMP = (start + (uint32_t)maxCounts) % LP_TIMER_PERIOD;
+    LP_TIMER->ICR = LPTIM_ICR_CMPMCF;
+
+    // The uart is off in Stop 2 so a falling edge on the rx pin wakes the mcu
+    EXTI->PR1 = LP_SERIAL_WAKE_LINE;
+    EXTI->IMR1 |= LP_SERIAL_WAKE_LINE;
+
+    PWR->CR1 = (PWR->CR1 & ~(PWR_CR1_LPMS)) | PWR_CR1_LPMS_STOP2;
+    SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+    __DSB();
+    __WFI();
+
+    // Latched before the clocks are restored. The other timers are counting
+    // again while the PLL relocks so reading later would count that time twice
+    uint32_t end = lp_get_count();
+    SCB->SCR &= ~(SCB_SCR_SLEEPDEEP_Msk);
+
+    EXTI->IMR1 &= ~(LP_SERIAL_WAKE_LINE);
+
+    // The mcu wakes up running from the MSI with the PLL off
+    mcu_clock_restore();
+
+#ifdef RTC_MODULE_ENABLED
+    // The calendar shadow registers aren't copied while stopped so without
+    // this the calendar would read as the time the mcu stopped at
+    rtc_wait_for_sync();
+#endif
+
+    // None of the timers count in Stop 2 so they are moved on by the time the
+    // LSE says has passed
+    uint32_t stoppedUs = lp_counts_to_us((end - start) % LP_TIMER_PERIOD);
+    time_advance_us(stoppedUs);
+    ts_advance_time(lp_us_to_ticks(stoppedUs));
+    uwTick += lp_us_to_hal_ticks(stoppedUs);
+
+    lpStopCount++;
+
+    return stoppedUs;
+}
+
+void lp_keep_awake(uint32_t ms) {
+
+    uint64_t awakeUntilMs = time_now_ms() + ms;
+
+    uint32_t primask;
+    ENTER_CRITICAL_SECTION(primask);
+
+    if (awakeUntilMs > lpAwakeUntilMs) {
+        lpAwakeUntilMs = awakeUntilMs;
+    }
+
+    EXIT_CRITICAL_SECTION(primask);
+}
+
+uint32_t lp_get_stop_count(void) {
+    return lpStopCount;
+}
+
+void lp_timer_isr(void) {
+
+    // The compare only needs to wake the mcu. The main loop works out how long
+    // it was stopped for
+    LP_TIMER->ICR = LPTIM_ICR_CMPMCF;
+}
+
+void lp_serial_wake_isr(void) {
+    EXTI->PR1 = LP_SERIAL_WAKE_LINE;
+    lp_keep_awake(LP_SERIAL_AWAKE_MS);
+}
+
+/* Private Functions */
+
+uint32_t lp_get_count(void) {
+
+    // The counter runs from the LSE so it is only safe to use when two reads
+    // in a row are the same
+    uint32_t count = LP_TIMER->CNT;
+    uint32_t check = LP_TIMER->CNT;
+
+    while (count != check) {
+        count = check;
+        check = LP_TIMER->CNT;
+    }
+
+    return count;
+}
+
+uint32_t lp_counts_to_us(uint32_t counts) {
+
+    uint64_t scaled  = ((uint64_t)counts * LP_US_PER_SECOND) + lpCountRemainder;
+    lpCountRemainder = scaled % HC_LP_TIMER_FREQUENCY;
+
+    return (uint32_t)(scaled / HC_LP_TIMER_FREQUENCY);
+}
+
+uint32_t lp_us_to_ticks(uint32_t us) {
+
+    uint32_t total = us + lpUsRemainder;
+    lpUsRemainder  = total % LP_US_PER_TS_TICK;
+
+    return total / LP_US_PER_TS_TICK;
+}
+
+uint32_t lp_us_to_hal_ticks(uint32_t us) {
+
+    uint32_t total   = us + lpHalUsRemainder;
+    lpHalUsRemainder = total % TIME_US_PER_MS;
+
+    return total / TIME_US_PER_MS;
+}
+
+/************************************ UNIT TESTING ************************************/
+
+#if (PROJECT_STATUS == UNIT_TESTS)
+uint8_t lpTestsFailed = 0;
+
+#    define LP_ASSERT(test)                                                                         \
+        do {                                                                                        \
+            if (!(test)) {                                                                          \
+                char msg[100];                                                                      \
+                sprintf(msg, "Unit test failed in File %s line number %d\r\n", __FILE__, __LINE__); \
+                log_prints(msg);                                                                    \
+                lpTestsFailed++;                                                                    \
+            }                                                                                       \
+        } while (0)
+
+// Long enough that a stale calendar would be more than a second behind
+#    define LP_TEST_STOP_TICKS  2500
+#    define LP_SECONDS_PER_DAY 86400
+
+/* Function definitions */
+void lp_conversion_test(void);
+void lp_calendar_after_stop_test(void);
+
+void lp_run_unit_tests(void) {
+    log_prints("STARTING LOW POWER TESTS\r\n");
+
+    lp_conversion_test();
+    lp_calendar_after_stop_test();
+
+    char m[50];
+    sprintf(m, "LOW POWER TESTS FAILED: %i\r\n", lpTestsFailed);
+    log_prints(m);
+}
+
+void lp_conversion_test(void) {
+
+    lpCountRemainder = 0;
+    lpUsRemainder    = 0;
+    lpHalUsRemainder = 0;
+
+    LP_ASSERT(lp_counts_to_us(HC_LP_TIMER_FREQUENCY) == LP_US_PER_SECOND);
+    LP_ASSERT(lp_us_to_ticks(LP_US_PER_SECOND) == HC_TS_TIMER_FREQUENCY);
+    LP_ASSERT(lp_us_to_hal_ticks(LP_US_PER_SECOND) == (LP_US_PER_SECOND / TIME_US_PER_MS));
+
+    // One count is 30.5us. The part of a us left over each time must be carried
+    // so a second of single counts still adds up to a second
+    uint32_t totalUs       = 0;
+    uint32_t totalTicks    = 0;
+    uint32_t totalHalTicks = 0;
+
+    for (uint32_t i = 0; i < HC_LP_TIMER_FREQUENCY; i++) {
+        uint32_t us = lp_counts_to_us(1);
+        totalUs += us;
+        totalTicks += lp_us_to_ticks(us);
+        totalHalTicks += lp_us_to_hal_ticks(us);
+    }
+
+    LP_ASSERT(totalUs == LP_US_PER_SECOND);
+    LP_ASSERT(totalTicks == HC_TS_TIMER_FREQUENCY);
+    LP_ASSERT(totalHalTicks == (LP_US_PER_SECOND / TIME_US_PER_MS));
+    LP_ASSERT((lpCountRemainder == 0) && (lpUsRemainder == 0) && (lpHalUsRemainder == 0));
+}
+
+void lp_calendar_after_stop_test(void) {
+
+#    ifdef RTC_MODULE_ENABLED
+    // A stop is only entered once the uart has finished sending
+    while ((USART2->ISR & USART_ISR_TC) == 0) {}
+
+    RtcDateTime before;
+    RtcDateTime after;
+    rtc_get_date_time(&before);
+
+    uint32_t stoppedUs = lp_enter_stop_2(LP_TEST_STOP_TICKS);
+    rtc_get_date_time(&after);
+    LP_ASSERT(stoppedUs != 0);
+
+    // The calendar read straight after waking must have moved on by the time
+    // the mcu was stopped for. A stale read would be a second or two behind
+    int32_t beforeS  = (before.hours * 3600) + (before.minutes * 60) + before.seconds;
+    int32_t afterS   = (after.hours * 3600) + (after.minutes * 60) + after.seconds;
+    int32_t elapsedS = (afterS >= beforeS) ? (afterS - beforeS) : (afterS + LP_SECONDS_PER_DAY - beforeS);
+
+    LP_ASSERT(elapsedS >= (int32_t)(stoppedUs / LP_US_PER_SECOND));
+    LP_ASSERT(elapsedS <= (int32_t)(stoppedUs / LP_US_PER_SECOND) + 1);
+#    endif
+}
+#endif
@@ -0,0 +1,332 @@
+/**
+ * @file real_time_clock.c
+ * @author Gian Barta-Dougall
+ * @brief Calendar and alarms of the real time clock. The clock runs from the
+ * LSE so it keeps time while the mcu is asleep
+ * @version 0.1
+ * @date --
+ *
+ * @copyright Copyright (c)
+ *
+ */
+/* Public Includes */
+
+/* Private Includes */
+#include "real_time_clock.h"
+#include "event_queue.h"
+#include "hardware_config.h"
+#include "utilities.h"
+#include "log.h"
+
+/* Private STM Includes */
+#include "stm32l4xx.h"
+
+/* Private #defines */
+
+// Writing these keys to WPR unlocks the rtc registers and any other value locks them again
+#define RTC_UNLOCK()             \
+    do {                         \
+        RTC->WPR = 0xCA;         \
+        RTC->WPR = 0x53;         \
+    } while (0)
+#define RTC_LOCK() (RTC->WPR = 0xFF)
+
+// The status flags are cleared by writing 0 to them. INIT is written back as it
+// was so clearing a flag doesn't enter or leave initialisation mode
+#define RTC_CLEAR_FLAG(flag) (RTC->ISR = (~((flag) | RTC_ISR_INIT)) | (RTC->ISR & RTC_ISR_INIT))
+
+#define RTC_TO_BCD(value)   ((((value) / 10) << 4) | ((value) % 10))
+#define RTC_FROM_BCD(value) ((((value) >> 4) * 10) + ((value) & 0x0F))
+
+// The time has the same layout in the time register and the alarm registers
+#define RTC_TIME_BITS(hours, minutes, seconds)                                          \
+    ((RTC_TO_BCD(hours) << RTC_TR_HU_Pos) | (RTC_TO_BCD(minutes) << RTC_TR_MNU_Pos) | \
+     (RTC_TO_BCD(seconds) << RTC_TR_SU_Pos))
+
+#define RTC_ALARM_INVALID(alarm) (alarm >= RTC_NUM_ALARMS)
+
+/* Private Structures and Enumerations */
+
+typedef struct RtcAlarm {
+    volatile uint32_t* alarmRegister;
+    volatile uint32_t* subSecondRegister;
+    uint32_t enableBits;
+    uint32_t interruptBit;
+    uint32_t writeAllowedFlag;
+    uint32_t alarmFlag;
+} RtcAlarm;
+
+/* Private Variable Declarations */
+
+const RtcAlarm rtcAlarms[RTC_NUM_ALARMS] = {
+    {
+        .alarmRegister     = &RTC->ALRMAR,
+        .subSecondRegister = &RTC->ALRMASSR,
+        .enableBits        = (RTC_CR_ALRAE | RTC_CR_ALRAIE),
+        .interruptBit      = RTC_CR_ALRAIE,
+        .writeAllowedFlag  = RTC_ISR_ALRAWF,
+        .alarmFlag         = RTC_ISR_ALRAF,
+    },
+    {
+        .alarmRegister     = &RTC->ALRMBR,
+        .subSecondRegister = &RTC->ALRMBSSR,
+        .enableBits        = (RTC_CR_ALRBE | RTC_CR_ALRBIE),
+        .interruptBit      = RTC_CR_ALRBIE,
+        .writeAllowedFlag  = RTC_ISR_ALRBWF,
+        .alarmFlag         = RTC_ISR_ALRBF,
+    },
+};
+
+const char* rtcWeekdayNames[] = {"---", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"};
+
+/* Private Function Prototypes */
+uint8_t rtc_get_days_in_month(uint16_t year, uint8_t month);
+uint8_t rtc_date_time_is_valid(RtcDateTime* dateTime);
+uint8_t rtc_get_weekday(uint16_t year, uint8_t month, uint8_t day);
+
+/* Public Functions */
+
+void rtc_init(void) {
+    rtc_wait_for_sync();
+}
+
+uint8_t rtc_calendar_is_set(void) {
+    return ((RTC->ISR & RTC_ISR_INITS) == RTC_ISR_INITS) ? TRUE : FALSE;
+}
+
+uint8_t rtc_set_date_time(RtcDateTime* dateTime) {
+
+    if (rtc_date_time_is_valid(dateTime) == FALSE) {
+        return FALSE;
+    }
+
+    dateTime->weekday = rtc_get_weekday(dateTime->year, dateTime->month, dateTime->day);
+
+    RTC_UNLOCK();
+
+    // The calendar stops counting while it is in initialisation mode
+    RTC->ISR |= RTC_ISR_INIT;
+    while ((RTC->ISR & RTC_ISR_INITF) == 0) {}
+
+    // The prescalers must be written one at a time
+    RTC->PRER = (HC_RTC_SYNC_PRESCALER << RTC_PRER_PREDIV_S_Pos);
+    RTC->PRER |= (HC_RTC_ASYNC_PRESCALER << RTC_PRER_PREDIV_A_Pos);
+    RTC->CR &= ~(RTC_CR_FMT); // 24 hour time
+
+    RTC->TR = RTC_TIME_BITS(dateTime->hours, dateTime->minutes, dateTime->seconds);
+    RTC->DR = (RTC_TO_BCD(dateTime->year - 2000) << RTC_DR_YU_Pos) | (dateTime->weekday << RTC_DR_WDU_Pos) |
+              (RTC_TO_BCD(dateTime->month) << RTC_DR_MU_Pos) | (RTC_TO_BCD(dateTime->day) << RTC_DR_DU_Pos);
+
+    RTC->ISR &= ~(RTC_ISR_INIT);
+    RTC_LOCK();
+
+    rtc_wait_for_sync();
+    return TRUE;
+}
+
+void rtc_wait_for_sync(void) {
+
+    // The calendar is read through shadow registers that are copied from the
+    // calendar every 2 rtc clock cycles. Wait for a copy so a read isn't stale
+    RTC_UNLOCK();
+    RTC_CLEAR_FLAG(RTC_ISR_RSF);
+    RTC_LOCK();
+
+    while ((RTC->ISR & RTC_ISR_RSF) == 0) {}
+}
+
+void rtc_get_date_time(RtcDateTime* dateTime) {
+
+    // Reading the time register freezes the date register until it is read so
+    // both are from the same second
+    uint32_t time = RTC->TR;
+    uint32_t date = RTC->DR;
+
+    dateTime->hours   = RTC_FROM_BCD((time & (RTC_TR_HT | RTC_TR_HU)) >> RTC_TR_HU_Pos);
+    dateTime->minutes = RTC_FROM_BCD((time & (RTC_TR_MNT | RTC_TR_MNU)) >> RTC_TR_MNU_Pos);
+    dateTime->seconds = RTC_FROM_BCD((time & (RTC_TR_ST | RTC_TR_SU)) >> RTC_TR_SU_Pos);
+    dateTime->year    = RTC_FROM_BCD((date & (RTC_DR_YT | RTC_DR_YU)) >> RTC_DR_YU_Pos) + 2000;
+    dateTime->month   = RTC_FROM_BCD((date & (RTC_DR_MT | RTC_DR_MU)) >> RTC_DR_MU_Pos);
+    dateTime->day     = RTC_FROM_BCD((date & (RTC_DR_DT | RTC_DR_DU)) >> RTC_DR_DU_Pos);
+    dateTime->weekday = (date & RTC_DR_WDU) >> RTC_DR_WDU_Pos;
+}
+
+void rtc_set_alarm(uint8_t alarm, uint8_t weekday, uint8_t hours, uint8_t minutes, uint8_t seconds) {
+
+    if (RTC_ALARM_INVALID(alarm)) {
+        return;
+    }
+
+    const RtcAlarm* rtcAlarm = &rtcAlarms[alarm];
+    uint32_t value           = RTC_TIME_BITS(hours, minutes, seconds);
+
+    // The day is either ignored or matched against the weekday
+    if (weekday == RTC_EVERY_DAY) {
+        value |= RTC_ALRMAR_MSK4;
+    } else {
+        value |= RTC_ALRMAR_WDSEL | (weekday << RTC_ALRMAR_DU_Pos);
+    }
+
+    RTC_UNLOCK();
+
+    // The alarm can only be written once it is disabled and the hardware says so
+    RTC->CR &= ~(rtcAlarm->enableBits);
+    while ((RTC->ISR & rtcAlarm->writeAllowedFlag) == 0) {}
+
+    *rtcAlarm->alarmRegister     = value;
+    *rtcAlarm->subSecondRegister = 0; // Sub seconds aren't compared
+    RTC_CLEAR_FLAG(rtcAlarm->alarmFlag);
+    RTC->CR |= rtcAlarm->enableBits;
+
+    RTC_LOCK();
+}
+
+void rtc_disable_alarm(uint8_t alarm) {
+
+    if (RTC_ALARM_INVALID(alarm)) {
+        return;
+    }
+
+    RTC_UNLOCK();
+    RTC->CR &= ~(rtcAlarms[alarm].enableBits);
+    RTC_CLEAR_FLAG(rtcAlarms[alarm].alarmFlag);
+    RTC_LOCK();
+}
+
+void rtc_alarm_isr(void) {
+
+    for (uint8_t alarm = 0; alarm < RTC_NUM_ALARMS; alarm++) {
+
+        const RtcAlarm* rtcAlarm = &rtcAlarms[alarm];
+
+        if (((RTC->ISR & rtcAlarm->alarmFlag) == 0) || ((RTC->CR & rtcAlarm->interruptBit) == 0)) {
+            continue;
+        }
+
+        RTC_CLEAR_FLAG(rtcAlarm->alarmFlag);
+        event_queue_push(EQ_PRIORITY_5_QUEUE_ID, EVENT_RTC_ALARM, alarm);
+    }
+}
+
+const char* rtc_get_weekday_name(uint8_t weekday) {
+
+    if ((weekday < RTC_MONDAY) || (weekday > RTC_SUNDAY)) {
+        return rtcWeekdayNames[0];
+    }
+
+    return rtcWeekdayNames[weekday];
+}
+
+/* Private Functions */
+
+uint8_t rtc_get_days_in_month(uint16_t year, uint8_t month) {
+
+    const uint8_t daysInMonth[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+    // Every fourth year is a leap year between 2001 and 2099
+    if ((month == 2) && ((year % 4) == 0)) {
+        return 29;
+    }
+
+    return daysInMonth[month - 1];
+}
+
+uint8_t rtc_date_time_is_valid(RtcDateTime* dateTime) {
+
+    if ((dateTime->year < RTC_MIN_YEAR) || (dateTime->year > RTC_MAX_YEAR)) {
+        return FALSE;
+    }
+
+    if ((dateTime->month < 1) || (dateTime->month > 12)) {
+        return FALSE;
+    }
+
+    if ((dateTime->day < 1) || (dateTime->day > rtc_get_days_in_month(dateTime->year, dateTime->month))) {
+        return FALSE;
+    }
+
+    if ((dateTime->hours > 23) || (dateTime->minutes > 59) || (dateTime->seconds > 59)) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+uint8_t rtc_get_weekday(uint16_t year, uint8_t month, uint8_t day) {
+
+    // Sakamoto's method. Returns 0 for Sunday so it is moved to the end of the week
+    const uint8_t monthOffsets[12] = {0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4};
+
+    if (month < 3) {
+        year--;
+    }
+
+    uint8_t weekday = (year + (year / 4) - (year / 100) + (year / 400) + monthOffsets[month - 1] + day) % 7;
+
+    return (weekday == 0) ? RTC_SUNDAY : weekday;
+}
+
+/************************************ UNIT TESTING ************************************/
+
+#if (PROJECT_STATUS == UNIT_TESTS)
+uint8_t rtcTestsFailed = 0;
+
+#    define RTC_ASSERT(test)                                                                        \
+        do {                                                                                        \
+            if (!(test)) {                                                                          \
+                char msg[100];                                                                      \
+                sprintf(msg, "Unit test failed in File %s line number %d\r\n", __FILE__, __LINE__); \
+                log_prints(msg);                                                                    \
+                rtcTestsFailed++;                                                                   \
+            }                                                                                       \
+        } while (0)
+
+/* Function definitions */
+void rtc_weekday_test(void);
+void rtc_valid_date_time_test(void);
+
+void rtc_run_unit_tests(void) {
+    log_prints("STARTING REAL TIME CLOCK TESTS\r\n");
+
+    // Only the calculations are tested so the calendar isn't changed
+    rtc_weekday_test();
+    rtc_valid_date_time_test();
+
+    char m[50];
+    sprintf(m, "REAL TIME CLOCK TESTS FAILED: %i\r\n", rtcTestsFailed);
+    log_prints(m);
+}
+
+void rtc_weekday_test(void) {
+    RTC_ASSERT(rtc_get_weekday(2001, 1, 1) == RTC_MONDAY);
+    RTC_ASSERT(rtc_get_weekday(2024, 2, 29) == RTC_THURSDAY);
+    RTC_ASSERT(rtc_get_weekday(2024, 3, 1) == RTC_FRIDAY);
+    RTC_ASSERT(rtc_get_weekday(2026, 10, 17) == RTC_SATURDAY);
+    RTC_ASSERT(rtc_get_weekday(2026, 10, 18) == RTC_SUNDAY);
+    RTC_ASSERT(rtc_get_weekday(2099, 12, 31) == RTC_THURSDAY);
+}
+
+void rtc_valid_date_time_test(void) {
+
+    RtcDateTime dateTime = {.year = 2024, .month = 2, .day = 29, .hours = 23, .minutes = 59, .seconds = 59};
+    RTC_ASSERT(rtc_date_time_is_valid(&dateTime) == TRUE);
+
+    // Not a leap year
+    dateTime.year = 2025;
+    RTC_ASSERT(rtc_date_time_is_valid(&dateTime) == FALSE);
+
+    dateTime.day = 28;
+    RTC_ASSERT(rtc_date_time_is_valid(&dateTime) == TRUE);
+
+    dateTime.month = 13;
+    RTC_ASSERT(rtc_date_time_is_valid(&dateTime) == FALSE);
+
+    dateTime.month = 12;
+    dateTime.hours = 24;
+    RTC_ASSERT(rtc_date_time_is_valid(&dateTime) == FALSE);
+
+    dateTime.hours = 0;
+    dateTime.year  = 2000;
+    RTC_ASSERT(rtc_date_time_is_valid(&dateTime) == FALSE);
+}
+#endif
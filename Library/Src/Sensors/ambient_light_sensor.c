@@ -17,6 +17,7 @@
 #include "utilities.h"
 #include "interrupts_config.h"
 #include "adc_config.h"
+#include "ts_sequence.h"
 
 /* STM32 Includes */
 
@@ -50,15 +51,47 @@
 #define CUT_OFF_COUNT 3
 #define MAX_COUNT     (CUT_OFF_COUNT * 2)
 
+// Time between the start of each reading of the sensor
+#define AL_SENSOR_UPDATE_PERIOD_MS 60000
+
+// Time spent on each step of a reading. The pin waits are 2 ticks so they
+// are at least 1ms long no matter where in the current tick they start
+#define AL_SENSOR_DISCHARGE_MS  1000
+#define AL_SENSOR_EXPOSURE_MS   3000
+#define AL_SENSOR_READ_MS       3000
+#define AL_SENSOR_CHARGE_MS     1000
+#define AL_SENSOR_PIN_LOW_MS    2
+#define AL_SENSOR_PIN_SETTLE_MS 2
+#define AL_SENSOR_READING_TIME_MS                                                               \
+    (AL_SENSOR_DISCHARGE_MS + AL_SENSOR_EXPOSURE_MS + AL_SENSOR_READ_MS + AL_SENSOR_CHARGE_MS + \
+     AL_SENSOR_PIN_LOW_MS + AL_SENSOR_PIN_SETTLE_MS)
+
+#if (AL_SENSOR_READING_TIME_MS >= AL_SENSOR_UPDATE_PERIOD_MS)
+#    error A reading of the ambient light sensor must finish within the update period
+#endif
+
 /* Variable Declarations */
-extern uint32_t ambientLightSensorFlag;
 
 // Keeps track of how many times in a row ambient light has or has not been found.
 // This ensures that a light from a passing car or a dark shadow won't fool the
 // sensor into recording a false state
 uint8_t count[NUM_AL_SENSORS] = {0};
 
+// Scheduler time the current reading was due to start. The next reading is
+// due one update period later so the main loop latency of each step doesn't
+// push the readings back
+uint32_t alSensorReadingStart = 0;
+
 /* Function prototypes */
+void al_sensor_update_sequence(TsSequence* sequence);
+
+// Discharges the capacitor, lets it charge from the ambient light, reads it
+// then checks the sensor is still connected before waiting for the next reading
+TsSequence alSensorUpdateSequence = {
+    .function = al_sensor_update_sequence,
+    .context  = &alSensors[0],
+    .handle   = TS_INVALID_HANDLE,
+};
 
 /**
  * @brief Setting the pin to input allows the capacitor in the circuit to discharge
@@ -171,91 +204,76 @@ uint8_t al_sensor_status(uint8_t alSensorId) {
     return alSensors[si].status;
 }
 
-void al_sensor_check_if_connected(uint8_t alSensorId) {
+void al_sensor_init(void) {
 
-    ASSERT_VALID_ENCODER_ID(alSensorId);
-    uint8_t si = AL_SENSOR_ID_TO_INDEX(alSensorId);
+    // Only the first sensor is currently used
+    ts_sequence_start(&alSensorUpdateSequence);
+}
 
-    // I think after you set the pin high, if you change to an input, the
-    // charge still remains on the pin so when you change to an input it
-    // will read high if nothing is connected. If you set the pin low for
-    // a short period of time (short enough for charge on pin to leave
-    // and charge on capacitor to stay) then the input will only read high
-    // if the sensor is connected
-    SET_PIN_LOW(alSensors[si].port, alSensors[si].pin);
-    HAL_Delay(1);
+void al_sensor_update_sequence(TsSequence* sequence) {
 
-    // Read pin to determine if the sensor is connected or not
-    SET_PIN_MODE_INPUT(alSensors[si].port, alSensors[si].pin);
-    HAL_Delay(1);
-    if (PIN_IDR_IS_HIGH(alSensors[si].port, alSensors[si].pin)) {
-        alSensors[si].status = CONNECTED;
-        log_prints("connected\r\n");
-    } else {
-        alSensors[si].status = DISCONNECTED;
-        log_prints("disconnected\r\n");
-    }
-}
+    AmbientLightSensor* alSensor = (AmbientLightSensor*)sequence->context;
+
+    TS_SEQUENCE_BEGIN(sequence);
 
-void al_sensor_process_internal_flags(void) {
+    while (1) {
 
-    // Skip recording ambient light if the sensor is not connected
-    if (alSensors[AL_SENSOR_ID_TO_INDEX(AL_SENSOR_1_ID)].status == CONNECTED) {
-        if (FLAG_IS_SET(ambientLightSensorFlag, ALS1_DISCHARGE_CAPACITOR)) {
-            FLAG_CLEAR(ambientLightSensorFlag, ALS1_DISCHARGE_CAPACITOR);
-            log_prints("Discharging 1\r\n");
-            al_sensor_discharge_capacitor(AL_SENSOR_1_ID);
+        alSensorReadingStart = sequence->deadline;
+
+        // Skip recording ambient light if the sensor is not connected
+        if (alSensor->status == CONNECTED) {
+            log_prints("Discharging\r\n");
+            al_sensor_discharge_capacitor(alSensor->id);
         }
 
-        if (FLAG_IS_SET(ambientLightSensorFlag, ALS1_RECORD_AMBIENT_LIGHT)) {
-            FLAG_CLEAR(ambientLightSensorFlag, ALS1_RECORD_AMBIENT_LIGHT);
-            log_prints("Recording light 1\r\n");
-            al_sensor_record_ambient_light(AL_SENSOR_1_ID);
+        TS_AWAIT_MS(sequence, AL_SENSOR_DISCHARGE_MS);
+
+        if (alSensor->status == CONNECTED) {
+            log_prints("Recording light\r\n");
+            al_sensor_record_ambient_light(alSensor->id);
         }
 
-        if (FLAG_IS_SET(ambientLightSensorFlag, ALS1_READ_AMBIENT_LIGHT)) {
-            FLAG_CLEAR(ambientLightSensorFlag, ALS1_READ_AMBIENT_LIGHT);
-            log_prints("Reading light level 1\r\n");
-            al_sensor_read_capacitor(AL_SENSOR_1_ID);
+        TS_AWAIT_MS(sequence, AL_SENSOR_EXPOSURE_MS);
+
+        if (alSensor->status == CONNECTED) {
+            log_prints("Reading light level\r\n");
+            al_sensor_read_capacitor(alSensor->id);
         }
-    }
 
-    if (FLAG_IS_SET(ambientLightSensorFlag, ALS1_CHARGE_CAPACITOR)) {
-        FLAG_CLEAR(ambientLightSensorFlag, ALS1_CHARGE_CAPACITOR);
-        log_prints("Charging cap 1\r\n");
-        al_sensor_charge_capacitor(AL_SENSOR_1_ID);
-    }
+        TS_AWAIT_MS(sequence, AL_SENSOR_READ_MS);
+
+        log_prints("Charging cap\r\n");
+        al_sensor_charge_capacitor(alSensor->id);
+
+        TS_AWAIT_MS(sequence, AL_SENSOR_CHARGE_MS);
+
+        // I think after you set the pin high, if you change to an input, the
+        // charge still remains on the pin so when you change to an input it
+        // will read high if nothing is connected. If you set the pin low for
+        // a short period of time (short enough for charge on pin to leave
+        // and charge on capacitor to stay) then the input will only read high
+        // if the sensor is connected
+        log_prints("Confirming connection\r\n");
+        SET_PIN_LOW(alSensor->port, alSensor->pin);
+        TS_AWAIT_MS(sequence, AL_SENSOR_PIN_LOW_MS);
+
+        // Read pin to determine if the sensor is connected or not
+        SET_PIN_MODE_INPUT(alSensor->port, alSensor->pin);
+        TS_AWAIT_MS(sequence, AL_SENSOR_PIN_SETTLE_MS);
+
+        if (PIN_IDR_IS_HIGH(alSensor->port, alSensor->pin)) {
+            alSensor->status = CONNECTED;
+            log_prints("connected\r\n");
+        } else {
+            alSensor->status = DISCONNECTED;
+            log_prints("disconnected\r\n");
+        }
 
-    if (FLAG_IS_SET(ambientLightSensorFlag, ALS1_CONFIRM_CONNECTION)) {
-        FLAG_CLEAR(ambientLightSensorFlag, ALS1_CONFIRM_CONNECTION);
-        log_prints("Confirming connection 1\r\n");
-        al_sensor_check_if_connected(AL_SENSOR_1_ID);
+        // Repeat the readings once a minute. The steps above are measured from
+        // when they resumed so they run late, but the next reading is anchored to
+        // when this one was due so the lateness doesn't carry into the next minute
+        TS_AWAIT_UNTIL(sequence, alSensorReadingStart + AL_SENSOR_UPDATE_PERIOD_MS);
     }
 
-    // if (alSensors[AL_SENSOR_ID_TO_INDEX(AL_SENSOR_2_ID)].status == CONNECTED) {
-    //     if (FLAG_IS_SET(ambientLightSensorFlag, ALS2_DISCHARGE_CAPACITOR)) {
-    //         FLAG_CLEAR(ambientLightSensorFlag, ALS2_DISCHARGE_CAPACITOR);
-    //         al_sensor_discharge_capacitor(AL_SENSOR_2_ID);
-    //     }
-
-    //     if (FLAG_IS_SET(ambientLightSensorFlag, ALS2_RECORD_AMBIENT_LIGHT)) {
-    //         FLAG_CLEAR(ambientLightSensorFlag, ALS2_RECORD_AMBIENT_LIGHT);
-    //         al_sensor_record_ambient_light(AL_SENSOR_2_ID);
-    //     }
-
-    //     if (FLAG_IS_SET(ambientLightSensorFlag, ALS2_READ_AMBIENT_LIGHT)) {
-    //         FLAG_CLEAR(ambientLightSensorFlag, ALS2_READ_AMBIENT_LIGHT);
-    //         al_sensor_read_capacitor(AL_SENSOR_2_ID);
-    //     }
-    // }
-
-    // if (FLAG_IS_SET(ambientLightSensorFlag, ALS2_CHARGE_CAPACITOR)) {
-    //     FLAG_CLEAR(ambientLightSensorFlag, ALS2_CHARGE_CAPACITOR);
-    //     al_sensor_charge_capacitor(AL_SENSOR_2_ID);
-    // }
-
-    // if (FLAG_IS_SET(ambientLightSensorFlag, ALS2_CONFIRM_CONNECTION)) {
-    //     FLAG_CLEAR(ambientLightSensorFlag, ALS2_CONFIRM_CONNECTION);
-    //     al_sensor_check_if_connected(AL_SENSOR_2_ID);
-    // }
-}
\ No newline at end of file
+    TS_SEQUENCE_END(sequence);
+}
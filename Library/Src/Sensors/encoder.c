@@ -15,9 +15,15 @@
 #include "encoder_config.h"
 #include "utilities.h"
 #include "log.h"
+#include "cycle_counter.h"
+#include "peripheral_clock.h"
 
 /* STM32 Includes */
 
+// Time for the pull down to discharge the pin and the new level to reach the
+// IDR. The pin only has a few pF on it so this is generous
+#define ENCODER_IDR_SETTLE_US 10
+
 #define ENCODER_ID_INVALID(id)  ((id < ENCODER_ID_OFFSET) || (id > (NUM_ENCODERS - 1 + ENCODER_ID_OFFSET)))
 #define ENCODER_ID_TO_INDEX(id) (id - ENCODER_ID_OFFSET)
 
@@ -32,86 +38,79 @@
     } while (0)
 
 /* Variable Declarations */
-uint32_t encoderTaskFlags = 0;
 
 /* Function prototypes */
 void encoder_timer_init(void);
+void encoder_probe_release_pin(void* context);
+void encoder_probe_discharge_pin(void* context);
+void encoder_probe_set_input(void* context);
+void encoder_probe_read_pin(void* context);
+
+// Steps of probing the connection. Each delay is how long to wait after the
+// step before it
+const Task1 encoderProbeReadPin = {
+    .delay    = 1000, // Wait 1ms so the IDR can update
+    .handler  = encoder_probe_read_pin,
+    .nextTask = NULL,
+};
+
+const Task1 encoderProbeSetInput = {
+    .delay    = 1000, // Keep the pin low for 1ms
+    .handler  = encoder_probe_set_input,
+    .nextTask = &encoderProbeReadPin,
+};
+
+const Task1 encoderProbeDischargePin = {
+    .delay    = 5000, // Wait 5ms so a connected encoder can discharge the pin
+    .handler  = encoder_probe_discharge_pin,
+    .nextTask = &encoderProbeSetInput,
+};
+
+const Task1 encoderProbeReleasePin = {
+    .delay    = 5000, // Wait 5ms so the capacitor can fully charge
+    .handler  = encoder_probe_release_pin,
+    .nextTask = &encoderProbeDischargePin,
+};
 
 void encoder_init(void) {
 
     // Reset all the timer counts
     for (uint8_t i = 0; i < NUM_ENCODERS; i++) {
+        encoders[i].probeStatus = DISCONNECTED;
+        encoders[i].probeHandle = TS_INVALID_HANDLE;
         encoder_enable(encoders[i].id);
     }
 }
 
-uint8_t encoder_probe_connection(uint8_t encoderId) {
+void encoder_probe_connection(uint8_t encoderId) {
 
-    if (ENCODER_ID_INVALID(encoderId)) {
-        return DISCONNECTED;
-    }
+    ASSERT_VALID_ENCODER_ID(encoderId);
 
     // The encoder connects to the micrcontroller through a comparator with a series resistor
-    // To probe whether the encoder is connected to the microcontroller, a high or low voltage
+    // To probe whether the encoder is connected to the microcontroller, a high voltage
     // will be output and then that voltage will be read back by changing the pin to an input.
     // If the encoder is not connected, the input read will be the same as the output written.
     // If the encoder is connected, the input read will not be the same as the output written
-    // for either high or low
-    uint8_t index  = ENCODER_ID_TO_INDEX(encoderId);
-    uint8_t status = DISCONNECTED;
-
-    for (uint8_t i = 0; i < 1; i++) {
-
-        // Description: Check if writing a high also returns a high when reading
-
-        // Set pin mode to output and set pin high
-        SET_PIN_MODE_INPUT(encoders[index].port, encoders[index].pin);
-        SET_PIN_MODE_OUTPUT(encoders[index].port, encoders[index].pin);
-        SET_PIN_TYPE_PUSH_PULL(encoders[index].port, encoders[index].pin);
-
-        // Check high voltage first loop and low voltage on second loop
-        if (i == 0) {
-            SET_PIN_HIGH(encoders[index].port, encoders[index].pin);
-        } else {
-            SET_PIN_LOW(encoders[index].port, encoders[index].pin);
-        }
-
-        HAL_Delay(5); // Delay for 5ms so capacitor can fully charge
-
-        // Set pin to high impedence
-        SET_PIN_MODE_ANALOGUE(encoders[index].port, encoders[index].pin);
-
-        // Delay for 5ms so if encoder is connected, it has time to fully discharge the charge
-        // that was just output on the pin
-        HAL_Delay(5);
-
-        // Need to set the pin low to discharge any charge that has accumated on the wire
-        // on the outside of the GPIO pin. If you don't do this and the encoder is not
-        // connected, it will somtimes read high even when there is no capacitor connected.
-        // Assuming it's because charge has accumulated on the actual pin. Setting the output
-        // low for a short period fixes this
-        SET_PIN_LOW(encoders[index].port, encoders[index].pin);
-        HAL_Delay(1);
-
-        // Set the mode to input and read if the charge on the pin
-        SET_PIN_MODE_INPUT(encoders[index].port, encoders[index].pin);
-        HAL_Delay(1); // Delay for 1ms so IDR can update
-
-        // Check for pin being low on first loop and pin being high on second loop
-        if (i == 0 && PIN_IDR_IS_LOW(encoders[index].port, encoders[index].pin)) {
-            status = CONNECTED;
-        }
-
-        // if (i == 1 && PIN_IS_HIGH(encoders[index].port, encoders[index].pin)) {
-        //     status = CONNECTED;
-        // }
-    }
+    uint8_t index = ENCODER_ID_TO_INDEX(encoderId);
 
-    // Revert pins back to original function
-    // SET_PIN_MODE_INPUT(encoders[index].port, encoders[index].pin);
-    // SET_PIN_MODE_ALTERNATE_FUNCTION(encoders[index].port, encoders[index].pin);
+    // Set pin mode to output and set pin high
+    SET_PIN_MODE_INPUT(encoders[index].port, encoders[index].pin);
+    SET_PIN_MODE_OUTPUT(encoders[index].port, encoders[index].pin);
+    SET_PIN_TYPE_PUSH_PULL(encoders[index].port, encoders[index].pin);
+    SET_PIN_HIGH(encoders[index].port, encoders[index].pin);
 
-    return status;
+    // The rest of the steps are run by the microsecond lane once each wait is over
+    encoders[index].probeStatus = ENCODER_PROBE_RUNNING;
+    tsu_add_task_with_context_to_queue(&encoderProbeReleasePin, &encoders[index], &encoders[index].probeHandle);
+}
+
+uint8_t encoder_get_probe_status(uint8_t encoderId) {
+
+    if (ENCODER_ID_INVALID(encoderId)) {
+        return INVALID_ID;
+    }
+
+    return encoders[ENCODER_ID_TO_INDEX(encoderId)].probeStatus;
 }
 
 void encoder_enable(uint8_t encoderId) {
@@ -119,6 +118,7 @@ void encoder_enable(uint8_t encoderId) {
     ASSERT_VALID_ENCODER_ID(encoderId);
 
     uint8_t index = ENCODER_ID_TO_INDEX(encoderId);
+    pclk_request(encoders[index].clock);
 
     // Reset all the registers in the timer and set the count to 0
     encoders[index].timer->EGR |= (TIM_EGR_UG);
@@ -136,8 +136,9 @@ void encoder_enable(uint8_t encoderId) {
     // Enable interrupts
     encoders[index].timer->DIER |= (TIM_DIER_CC2IE | TIM_DIER_CC3IE);
 
-    // Start the timer
+    // Start the timer. It only counts while its clock is requested
     encoders[index].timer->CR1 |= (TIM_CR1_CEN);
+    pclk_release(encoders[index].clock);
 }
 
 void encoder_disable(uint8_t encoderId) {
@@ -145,8 +146,24 @@ void encoder_disable(uint8_t encoderId) {
     ASSERT_VALID_ENCODER_ID(encoderId);
 
     uint8_t index = ENCODER_ID_TO_INDEX(encoderId);
+    pclk_request(encoders[index].clock);
     encoders[index].timer->CR1 &= ~(TIM_CR1_CEN);
     encoders[index].timer->DIER &= ~(TIM_DIER_CC2IE | TIM_DIER_CC3IE);
+    pclk_release(encoders[index].clock);
+}
+
+void encoder_request_clock(uint8_t encoderId) {
+
+    ASSERT_VALID_ENCODER_ID(encoderId);
+
+    pclk_request(encoders[ENCODER_ID_TO_INDEX(encoderId)].clock);
+}
+
+void encoder_release_clock(uint8_t encoderId) {
+
+    ASSERT_VALID_ENCODER_ID(encoderId);
+
+    pclk_release(encoders[ENCODER_ID_TO_INDEX(encoderId)].clock);
 }
 
 void encoder_set_direction_up(uint8_t encoderId) {
@@ -156,7 +173,9 @@ void encoder_set_direction_up(uint8_t encoderId) {
     uint8_t index = ENCODER_ID_TO_INDEX(encoderId);
     // The maximum height of the blind is the 0 point. So to go upwards, the timer counter
     // needs to count down
+    pclk_request(encoders[index].clock);
     SET_TIMER_DIRECTION_COUNT_DOWN(encoders[index].timer);
+    pclk_release(encoders[index].clock);
 }
 
 void encoder_set_direction_down(uint8_t encoderId) {
@@ -167,7 +186,9 @@ void encoder_set_direction_down(uint8_t encoderId) {
 
     // The maximum height of the blind is the 0 point. So to go downwards, the timer counter
     // needs to count up
+    pclk_request(encoders[index].clock);
     SET_TIMER_DIRECTION_COUNT_UP(encoders[index].timer);
+    pclk_release(encoders[index].clock);
 }
 
 uint32_t encoder_get_count(uint8_t encoderId) {
@@ -176,8 +197,13 @@ uint32_t encoder_get_count(uint8_t encoderId) {
         return UINT_32_BIT_MAX_VALUE;
     }
 
+    // The timer reads back as 0 while its clock is off
     uint8_t index = ENCODER_ID_TO_INDEX(encoderId);
-    return encoders[index].timer->CNT;
+    pclk_request(encoders[index].clock);
+    uint32_t count = encoders[index].timer->CNT;
+    pclk_release(encoders[index].clock);
+
+    return count;
 }
 
 uint8_t encoder_at_max_height(uint8_t encoderId) {
@@ -191,7 +217,11 @@ uint8_t encoder_at_max_height(uint8_t encoderId) {
     // sprintf(m, "CNT: %li\tMax Height: %li\r\n", encoders[index].timer->CNT, encoders[index].minCount);
     // log_prints(m);
 
-    return (encoders[index].timer->CNT == encoders[index].timer->CCR2) ? TRUE : FALSE;
+    pclk_request(encoders[index].clock);
+    uint8_t atMaxHeight = (encoders[index].timer->CNT == encoders[index].timer->CCR2) ? TRUE : FALSE;
+    pclk_release(encoders[index].clock);
+
+    return atMaxHeight;
 }
 
 uint8_t encoder_at_min_height(uint8_t encoderId) {
@@ -206,7 +236,11 @@ uint8_t encoder_at_min_height(uint8_t encoderId) {
     // sprintf(m, "CNT: %li\tMin Height: %li\r\n", encoders[index].timer->CNT, encoders[index].maxCount);
     // log_prints(m);
 
-    return (encoders[index].timer->CNT == encoders[index].timer->CCR3) ? TRUE : FALSE;
+    pclk_request(encoders[index].clock);
+    uint8_t atMinHeight = (encoders[index].timer->CNT == encoders[index].timer->CCR3) ? TRUE : FALSE;
+    pclk_release(encoders[index].clock);
+
+    return atMinHeight;
 }
 
 // void encoder_set_max_height(uint8_t encoderId) {
@@ -237,27 +271,6 @@ uint8_t encoder_at_min_height(uint8_t encoderId) {
 //     encoders[index].timer->CCR3 = encoders[index].maxCount;
 // }
 
-void encoder_isr(uint8_t encoderId) {
-
-    if (ENCODER_ID_INVALID(encoderId)) {
-        return;
-    }
-
-    uint8_t index = ENCODER_ID_TO_INDEX(encoderId);
-
-    switch (index) {
-        case 0:
-            FLAG_SET(encoderTaskFlags, ENCODER_1_LIMIT_REACHED);
-            break;
-        case 1:
-            FLAG_SET(encoderTaskFlags, ENCODER_2_LIMIT_REACHED);
-            break;
-
-        default:
-            break;
-    }
-}
-
 uint32_t encoder_get_lower_bound_interrupt(uint8_t encoderId) {
 
     uint8_t index = ENCODER_ID_TO_INDEX(encoderId);
@@ -266,7 +279,11 @@ uint32_t encoder_get_lower_bound_interrupt(uint8_t encoderId) {
         return UINT_32_BIT_MAX_VALUE;
     }
 
-    return encoders[index].timer->CCR2;
+    pclk_request(encoders[index].clock);
+    uint32_t lowerBound = encoders[index].timer->CCR2;
+    pclk_release(encoders[index].clock);
+
+    return lowerBound;
 }
 
 uint32_t encoder_get_upper_bound_interrupt(uint8_t encoderId) {
@@ -277,24 +294,32 @@ uint32_t encoder_get_upper_bound_interrupt(uint8_t encoderId) {
         return UINT_32_BIT_MAX_VALUE;
     }
 
-    return encoders[index].timer->CCR3;
+    pclk_request(encoders[index].clock);
+    uint32_t upperBound = encoders[index].timer->CCR3;
+    pclk_release(encoders[index].clock);
+
+    return upperBound;
 }
 
 void encoder_set_upper_bound_interrupt(uint8_t encoderId) {
 
     ASSERT_VALID_ENCODER_ID(encoderId);
 
-    uint8_t index               = ENCODER_ID_TO_INDEX(encoderId);
+    uint8_t index = ENCODER_ID_TO_INDEX(encoderId);
+    pclk_request(encoders[index].clock);
     encoders[index].timer->CCR3 = encoders[index].timer->CNT;
+    pclk_release(encoders[index].clock);
 }
 
 void encoder_set_lower_bound_interrupt(uint8_t encoderId) {
 
     ASSERT_VALID_ENCODER_ID(encoderId);
 
-    uint8_t index               = ENCODER_ID_TO_INDEX(encoderId);
+    uint8_t index = ENCODER_ID_TO_INDEX(encoderId);
+    pclk_request(encoders[index].clock);
     encoders[index].timer->CCR2 = ZERO_COUNT;
     encoders[index].timer->CNT  = ZERO_COUNT;
+    pclk_release(encoders[index].clock);
 }
 
 void encoder_enable_interrupts(uint8_t encoderId) {
@@ -303,8 +328,10 @@ void encoder_enable_interrupts(uint8_t encoderId) {
 
     // Clear any pending interrupts and then enable the interrupts
     uint8_t index = ENCODER_ID_TO_INDEX(encoderId);
+    pclk_request(encoders[index].clock);
     encoders[index].timer->SR &= ~(TIM_DIER_CC2IE | TIM_DIER_CC3IE);
     encoders[index].timer->DIER |= (TIM_DIER_CC2IE | TIM_DIER_CC3IE);
+    pclk_release(encoders[index].clock);
 }
 
 void encoder_disable_interrupts(uint8_t encoderId) {
@@ -313,8 +340,10 @@ void encoder_disable_interrupts(uint8_t encoderId) {
 
     // Clear any pending interrupts and disable interrupts
     uint8_t index = ENCODER_ID_TO_INDEX(encoderId);
+    pclk_request(encoders[index].clock);
     encoders[index].timer->SR &= ~(TIM_DIER_CC2IE | TIM_DIER_CC3IE);
     encoders[index].timer->DIER = 0;
+    pclk_release(encoders[index].clock);
 }
 
 uint8_t encoder_get_state(uint8_t encoderId) {
@@ -326,6 +355,7 @@ uint8_t encoder_get_state(uint8_t encoderId) {
     uint8_t index = ENCODER_ID_TO_INDEX(encoderId);
 
     // Disable the timer to ensure the following does not affect the count
+    pclk_request(encoders[index].clock);
     encoders[index].timer->CR1 &= ~TIM_CR1_CEN;
 
     // Encoders are in alternate function mode. Set the pin mode to input
@@ -335,7 +365,7 @@ uint8_t encoder_get_state(uint8_t encoderId) {
     SET_PIN_PULL_AS_PULL_DOWN(encoders[index].port, encoders[index].pin);
 
     // Wait short duration for IDR to update
-    HAL_Delay(1);
+    cc_delay_us(ENCODER_IDR_SETTLE_US);
 
     // Record the IDR
     uint8_t encoderInput = PIN_IDR_STATE(encoders[index].port, encoders[index].pin);
@@ -346,6 +376,43 @@ uint8_t encoder_get_state(uint8_t encoderId) {
 
     // Reenable the timer
     encoders[index].timer->CR1 |= TIM_CR1_CEN;
+    pclk_release(encoders[index].clock);
 
     return encoderInput;
-}
\ No newline at end of file
+}
+
+void encoder_probe_release_pin(void* context) {
+
+    Encoder* encoder = (Encoder*)context;
+
+    // Set pin to high impedence
+    SET_PIN_MODE_ANALOGUE(encoder->port, encoder->pin);
+}
+
+void encoder_probe_discharge_pin(void* context) {
+
+    Encoder* encoder = (Encoder*)context;
+
+    // Need to set the pin low to discharge any charge that has accumated on the wire
+    // on the outside of the GPIO pin. If you don't do this and the encoder is not
+    // connected, it will somtimes read high even when there is no capacitor connected.
+    // Assuming it's because charge has accumulated on the actual pin. Setting the output
+    // low for a short period fixes this
+    SET_PIN_LOW(encoder->port, encoder->pin);
+}
+
+void encoder_probe_set_input(void* context) {
+
+    Encoder* encoder = (Encoder*)context;
+
+    // Set the mode to input and read if the charge on the pin
+    SET_PIN_MODE_INPUT(encoder->port, encoder->pin);
+}
+
+void encoder_probe_read_pin(void* context) {
+
+    Encoder* encoder = (Encoder*)context;
+
+    // A connected encoder will have discharged the high that was written
+    encoder->probeStatus = PIN_IDR_IS_LOW(encoder->port, encoder->pin) ? CONNECTED : DISCONNECTED;
+}
@@ -13,5 +13,22 @@ uint8_t chars_same(char* str1, char* str2) {
         i++;
     }
 
+    // Both strings must end at the same place otherwise one is only the
+    // start of the other
+    return (str1[i] == str2[i]) ? TRUE : FALSE;
+}
+
+uint8_t chars_starts_with(char* str, char* prefix) {
+
+    int i = 0;
+    while (prefix[i] != '\0') {
+
+        if (str[i] != prefix[i]) {
+            return FALSE;
+        }
+
+        i++;
+    }
+
     return TRUE;
-}
\ No newline at end of file
+}
@@ -0,0 +1,208 @@
+/**
+ * @file cycle_counter.c
+ * @author Gian Barta-Dougall
+ * @brief Short delays and time measurements using the cycle counter of the
+ * DWT unit. The counter runs at the system clock so it resolves a single cycle
+ * @version 0.1
+ * @date --
+ *
+ * @copyright Copyright (c)
+ *
+ */
+/* Public Includes */
+#include <stdio.h>
+
+/* Private Includes */
+#include "cycle_counter.h"
+#include "utilities.h"
+#include "log.h"
+
+/* Private STM Includes */
+
+/* Private #defines */
+#define CC_HZ_PER_MHZ 1000000
+#define CC_NS_PER_S   1000000000ULL
+
+#define CC_LATENCY_SAMPLES 16
+
+/* Private Structures and Enumerations */
+
+/* Private Variable Declarations */
+
+volatile uint32_t ccIsrEntryCycles = 0;
+
+/* Private Function Prototypes */
+
+/* Public Functions */
+
+void cc_init(void) {
+
+    // The DWT unit is part of the debug block which is off unless a debugger
+    // is attached, so trace has to be enabled first
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+uint32_t cc_us_to_cycles(uint32_t us) {
+
+    uint64_t cycles = (uint64_t)us * (SystemCoreClock / CC_HZ_PER_MHZ);
+
+    return (cycles > CC_MAX_DELAY_CYCLES) ? CC_MAX_DELAY_CYCLES : cycles;
+}
+
+uint32_t cc_ns_to_cycles(uint32_t ns) {
+    return (((uint64_t)ns * SystemCoreClock) + CC_NS_PER_S - 1) / CC_NS_PER_S;
+}
+
+uint32_t cc_cycles_to_us(uint32_t cycles) {
+    return cycles / (SystemCoreClock / CC_HZ_PER_MHZ);
+}
+
+uint32_t cc_cycles_to_ns(uint32_t cycles) {
+
+    uint64_t ns = ((uint64_t)cycles * CC_NS_PER_S) / SystemCoreClock;
+
+    return (ns > UINT_32_BIT_MAX_VALUE) ? UINT_32_BIT_MAX_VALUE : ns;
+}
+
+void cc_delay_cycles(uint32_t cycles) {
+
+    if (cycles > CC_MAX_DELAY_CYCLES) {
+        cycles = CC_MAX_DELAY_CYCLES;
+    }
+
+    uint32_t target = CC_GET_CYCLES() + cycles;
+    while (!CC_CYCLES_REACHED(CC_GET_CYCLES(), target)) {}
+}
+
+void cc_delay_us(uint32_t us) {
+    cc_delay_cycles(cc_us_to_cycles(us));
+}
+
+void cc_delay_ns(uint32_t ns) {
+    cc_delay_cycles(cc_ns_to_cycles(ns));
+}
+
+uint32_t cc_measure_isr_latency(IRQn_Type irq) {
+
+    uint32_t minCycles = 0;
+
+    for (uint8_t i = 0; i < CC_LATENCY_SAMPLES; i++) {
+
+        uint32_t start   = CC_GET_CYCLES();
+        ccIsrEntryCycles = start;
+        NVIC_SetPendingIRQ(irq);
+
+        // The pend has to reach the NVIC before the isr can be taken
+        __DSB();
+        __ISB();
+
+        uint32_t cycles = ccIsrEntryCycles - start;
+        if ((cycles != 0) && ((minCycles == 0) || (cycles < minCycles))) {
+            minCycles = cycles;
+        }
+    }
+
+    return minCycles;
+}
+
+/* Private Functions */
+
+/************************************ UNIT TESTING ************************************/
+
+#if (PROJECT_STATUS == UNIT_TESTS)
+#    include "hardware_config.h"
+
+uint8_t ccTestsFailed = 0;
+
+// Far more than the 12 cycles the core takes to stack and enter an isr plus
+// the wait states of fetching the vector and the first instructions
+#    define CC_MAX_ISR_LATENCY_CYCLES 1000
+
+#    define CC_ASSERT(test)                                                                         \
+        do {                                                                                        \
+            if (!(test)) {                                                                          \
+                char msg[100];                                                                      \
+                sprintf(msg, "Unit test failed in File %s line number %d\r\n", __FILE__, __LINE__); \
+                log_prints(msg);                                                                    \
+                ccTestsFailed++;                                                                    \
+            }                                                                                       \
+        } while (0)
+
+/* Function definitions */
+void cc_conversion_test(void);
+void cc_wrap_test(void);
+void cc_delay_test(void);
+void cc_isr_latency_test(void);
+
+void cc_run_unit_tests(void) {
+    log_prints("STARTING CYCLE COUNTER TESTS\r\n");
+
+    cc_init();
+
+    cc_conversion_test();
+    cc_wrap_test();
+    cc_delay_test();
+    cc_isr_latency_test();
+
+    char m[50];
+    sprintf(m, "CYCLE COUNTER TESTS FAILED: %i\r\n", ccTestsFailed);
+    log_prints(m);
+}
+
+void cc_conversion_test(void) {
+
+    uint32_t cyclesPerUs = SystemCoreClock / CC_HZ_PER_MHZ;
+
+    CC_ASSERT(cc_us_to_cycles(0) == 0);
+    CC_ASSERT(cc_us_to_cycles(10) == (10 * cyclesPerUs));
+    CC_ASSERT(cc_cycles_to_us(10 * cyclesPerUs) == 10);
+    CC_ASSERT(cc_us_to_cycles(UINT_32_BIT_MAX_VALUE) == CC_MAX_DELAY_CYCLES);
+
+    // Nanoseconds round up to the next whole cycle
+    CC_ASSERT(cc_ns_to_cycles(1) == 1);
+    CC_ASSERT(cc_ns_to_cycles(1000) == cyclesPerUs);
+    CC_ASSERT(cc_cycles_to_ns(cyclesPerUs) == 1000);
+}
+
+void cc_wrap_test(void) {
+    CC_ASSERT(CC_CYCLES_REACHED(100, 100));
+    CC_ASSERT(CC_CYCLES_REACHED(101, 100));
+    CC_ASSERT(!CC_CYCLES_REACHED(99, 100));
+
+    // Targets past the top of the counter are reached after it wraps
+    CC_ASSERT(!CC_CYCLES_REACHED(0xFFFFFFF0, 0x00000010));
+    CC_ASSERT(CC_CYCLES_REACHED(0x00000010, 0xFFFFFFF0));
+}
+
+void cc_delay_test(void) {
+
+    uint32_t interruptState;
+    ENTER_CRITICAL_SECTION(interruptState);
+
+    uint32_t start = CC_GET_CYCLES();
+    cc_delay_us(50);
+    uint32_t elapsed = CC_CYCLES_SINCE(start);
+
+    start = CC_GET_CYCLES();
+    cc_delay_ns(500);
+    uint32_t elapsedNs = CC_CYCLES_SINCE(start);
+
+    EXIT_CRITICAL_SECTION(interruptState);
+
+    // The upper bounds allow for the time taken to call the delay
+    CC_ASSERT(elapsed >= cc_us_to_cycles(50));
+    CC_ASSERT(elapsed < cc_us_to_cycles(52));
+    CC_ASSERT(elapsedNs >= cc_ns_to_cycles(500));
+    CC_ASSERT(elapsedNs < cc_us_to_cycles(2));
+}
+
+void cc_isr_latency_test(void) {
+
+    // The scheduler isr marks its entry and does nothing when pended without
+    // one of its timer flags set
+    uint32_t latency = cc_measure_isr_latency(HC_TS_TIMER_IRQn);
+    CC_ASSERT(latency != 0);
+    CC_ASSERT(latency < CC_MAX_ISR_LATENCY_CYCLES);
+}
+#endif
@@ -0,0 +1,449 @@
+/**
+ * @file cyclic_executive.c
+ * @author Gian Barta-Dougall
+ * @brief Runs control loop callbacks at fixed rates from a hardware timer
+ * @version 0.1
+ * @date --
+ *
+ * @copyright Copyright (c)
+ *
+ */
+/* Public Includes */
+
+/* Private Includes */
+#include "cyclic_executive.h"
+#include "hardware_config.h"
+#include "task_scheduler_1.h"
+#include "utilities.h"
+#include "cycle_counter.h"
+
+/* Private STM Includes */
+
+/* Private #defines */
+#define CE_TIMER        HC_CE_TIMER
+#define CE_TIMER_PERIOD (HC_CE_TIMER_MAX_COUNT + 1)
+
+// Each count of the timer is one frame
+#if (HC_CE_TIMER_FREQUENCY != TIMER_FREQUENCY_1KHz)
+#    error The cyclic executive timer must count at 1kHz
+#endif
+
+// Number of frames before the pattern of rate groups repeats
+#define CE_HYPERPERIOD_FRAMES 100
+
+/* Private Structures and Enumerations */
+
+typedef struct CeSlot {
+    void (*handler)(void);
+    uint8_t rateGroup;
+    uint32_t budgetUs;
+    uint32_t maxTimeUs; // Kept in us so it stays valid when the clock profile changes
+    uint32_t overruns;
+} CeSlot;
+
+/* Private Variable Declarations */
+
+// A rate group runs in the frames where frame % divider == offset. The offsets
+// keep the 100Hz and 10Hz groups out of each others frames
+const uint8_t ceRateGroupDividers[CE_NUM_RATE_GROUPS] = {1, 10, 100};
+const uint8_t ceRateGroupOffsets[CE_NUM_RATE_GROUPS]  = {0, 1, 2};
+
+const char* ceRateGroupNames[CE_NUM_RATE_GROUPS] = {"1kHz", "100Hz", "10Hz"};
+
+CeSlot ceSlots[CE_MAX_SLOTS];
+uint8_t ceNumSlots = 0;
+
+// Position of the current frame in the hyperperiod
+uint8_t ceFrame = 0;
+
+uint32_t ceFrameOverruns = 0;
+
+/* Private Function Prototypes */
+void ce_enable(void);
+void ce_disable(void);
+uint8_t ce_rate_group_is_due(uint8_t rateGroup, uint8_t frame);
+uint32_t ce_rate_group_budget(uint8_t rateGroup);
+void ce_run_slot(CeSlot* slot);
+
+/* Public Functions */
+
+void ce_init(void) {
+
+    ce_disable();
+
+    for (uint8_t i = 0; i < CE_MAX_SLOTS; i++) {
+        ceSlots[i].handler = NULL;
+    }
+
+    ceNumSlots      = 0;
+    ceFrame         = 0;
+    ceFrameOverruns = 0;
+    ce_reset_statistics();
+}
+
+uint8_t ce_add_slot(uint8_t rateGroup, void (*handler)(void), uint32_t budgetUs) {
+
+    if ((rateGroup >= CE_NUM_RATE_GROUPS) || (handler == NULL)) {
+        return CE_INVALID_SLOT;
+    }
+
+    // Only the 1kHz group shares frames with the others so the worst frame
+    // is the 1kHz group plus whichever of the slower groups is larger
+    uint32_t budget1kHz   = ce_rate_group_budget(CE_RATE_1KHZ);
+    uint32_t budget100Hz  = ce_rate_group_budget(CE_RATE_100HZ);
+    uint32_t budget10Hz   = ce_rate_group_budget(CE_RATE_10HZ);
+    uint32_t* groupBudget = (rateGroup == CE_RATE_1KHZ)    ? &budget1kHz
+                            : (rateGroup == CE_RATE_100HZ) ? &budget100Hz
+                                                           : &budget10Hz;
+    (*groupBudget) += budgetUs;
+
+    uint32_t worstFrame = budget1kHz + ((budget100Hz > budget10Hz) ? budget100Hz : budget10Hz);
+    if (worstFrame > CE_FRAME_BUDGET_US) {
+        return CE_INVALID_SLOT;
+    }
+
+    for (uint8_t i = 0; i < CE_MAX_SLOTS; i++) {
+
+        if (ceSlots[i].handler != NULL) {
+            continue;
+        }
+
+        uint32_t interruptState;
+        ENTER_CRITICAL_SECTION(interruptState);
+        ceSlots[i].rateGroup = rateGroup;
+        ceSlots[i].budgetUs  = budgetUs;
+        ceSlots[i].maxTimeUs = 0;
+        ceSlots[i].overruns  = 0;
+        ceSlots[i].handler   = handler;
+        EXIT_CRITICAL_SECTION(interruptState);
+
+        ceNumSlots++;
+        if (ceNumSlots == 1) {
+            ce_enable();
+        }
+
+        return i;
+    }
+
+    return CE_INVALID_SLOT;
+}
+
+void ce_remove_slot(uint8_t slot) {
+
+    if ((slot >= CE_MAX_SLOTS) || (ceSlots[slot].handler == NULL)) {
+        return;
+    }
+
+    // A single write so the interrupt sees the slot either fully there or gone
+    ceSlots[slot].handler = NULL;
+
+    ceNumSlots--;
+    if (ceNumSlots == 0) {
+        ce_disable();
+    }
+}
+
+RAM_FUNCTION void ce_isr(void) {
+
+    // The next frame is measured from the compare that started this one rather
+    // than from when this interrupt was serviced so the frames never drift. If
+    // whole frames went by before this interrupt could run they are skipped
+    uint32_t missedFrames = (CE_TIMER->CNT - CE_TIMER->CCR2) % CE_TIMER_PERIOD;
+    if (missedFrames != 0) {
+        ceFrameOverruns += missedFrames;
+        ceFrame = (ceFrame + missedFrames) % CE_HYPERPERIOD_FRAMES;
+    }
+
+    CE_TIMER->CCR2 = (CE_TIMER->CCR2 + missedFrames + 1) % CE_TIMER_PERIOD;
+
+    // Faster groups run first so they have the least jitter
+    for (uint8_t rateGroup = 0; rateGroup < CE_NUM_RATE_GROUPS; rateGroup++) {
+
+        if (ce_rate_group_is_due(rateGroup, ceFrame) == FALSE) {
+            continue;
+        }
+
+        for (uint8_t i = 0; i < CE_MAX_SLOTS; i++) {
+            if ((ceSlots[i].handler != NULL) && (ceSlots[i].rateGroup == rateGroup)) {
+                ce_run_slot(&ceSlots[i]);
+            }
+        }
+    }
+
+    ceFrame = (ceFrame + 1) % CE_HYPERPERIOD_FRAMES;
+}
+
+uint32_t ce_get_slot_overruns(uint8_t slot) {
+
+    if (slot >= CE_MAX_SLOTS) {
+        return 0;
+    }
+
+    return ceSlots[slot].overruns;
+}
+
+uint32_t ce_get_slot_max_time_us(uint8_t slot) {
+
+    if (slot >= CE_MAX_SLOTS) {
+        return 0;
+    }
+
+    return ceSlots[slot].maxTimeUs;
+}
+
+uint32_t ce_get_frame_overruns(void) {
+    return ceFrameOverruns;
+}
+
+uint8_t ce_is_running(void) {
+    return (ceNumSlots != 0) ? TRUE : FALSE;
+}
+
+void ce_print_statistics(void) {
+
+    char m[80];
+
+    sprintf(m, "Missed frames: %lu\r\n", ceFrameOverruns);
+    log_prints(m);
+
+    for (uint8_t i = 0; i < CE_MAX_SLOTS; i++) {
+
+        if (ceSlots[i].handler == NULL) {
+            continue;
+        }
+
+        sprintf(m, "Slot %i (%s): budget %luus, max %luus, overruns %lu\r\n", i,
+                ceRateGroupNames[ceSlots[i].rateGroup], ceSlots[i].budgetUs, ce_get_slot_max_time_us(i),
+                ceSlots[i].overruns);
+        log_prints(m);
+    }
+}
+
+void ce_reset_statistics(void) {
+
+    for (uint8_t i = 0; i < CE_MAX_SLOTS; i++) {
+        ceSlots[i].maxTimeUs = 0;
+        ceSlots[i].overruns  = 0;
+    }
+
+    ceFrameOverruns = 0;
+}
+
+/* Private Functions */
+
+void ce_enable(void) {
+
+    // The cycle counter is used to time each callback against its budget
+    cc_init();
+
+    ceFrame        = 0;
+    CE_TIMER->CCR2 = (CE_TIMER->CNT + 1) % CE_TIMER_PERIOD;
+    CE_TIMER->SR   = ~TIM_SR_CC2IF;
+    CE_TIMER->DIER |= TIM_DIER_CC2IE;
+}
+
+void ce_disable(void) {
+    CE_TIMER->DIER &= ~(TIM_DIER_CC2IE);
+    CE_TIMER->SR = ~TIM_SR_CC2IF;
+}
+
+uint8_t ce_rate_group_is_due(uint8_t rateGroup, uint8_t frame) {
+    return ((frame % ceRateGroupDividers[rateGroup]) == ceRateGroupOffsets[rateGroup]) ? TRUE : FALSE;
+}
+
+uint32_t ce_rate_group_budget(uint8_t rateGroup) {
+
+    uint32_t budget = 0;
+
+    for (uint8_t i = 0; i < CE_MAX_SLOTS; i++) {
+        if ((ceSlots[i].handler != NULL) && (ceSlots[i].rateGroup == rateGroup)) {
+            budget += ceSlots[i].budgetUs;
+        }
+    }
+
+    return budget;
+}
+
+void ce_run_slot(CeSlot* slot) {
+
+    uint32_t start = CC_GET_CYCLES();
+    slot->handler();
+    uint32_t elapsedUs = cc_cycles_to_us(CC_CYCLES_SINCE(start));
+
+    if (elapsedUs > slot->maxTimeUs) {
+        slot->maxTimeUs = elapsedUs;
+    }
+
+    if (elapsedUs > slot->budgetUs) {
+        slot->overruns++;
+    }
+}
+
+/************************************ UNIT TESTING ************************************/
+
+#if (PROJECT_STATUS == UNIT_TESTS)
+uint8_t ceTestsFailed = 0;
+
+#    define CE_ASSERT(test)                                                                         \
+        do {                                                                                        \
+            if (!(test)) {                                                                          \
+                char msg[100];                                                                      \
+                sprintf(msg, "Unit test failed in File %s line number %d\r\n", __FILE__, __LINE__); \
+                log_prints(msg);                                                                    \
+                ceTestsFailed++;                                                                    \
+            }                                                                                       \
+        } while (0)
+
+/* Function definitions */
+void ce_rate_group_test(void);
+void ce_budget_test(void);
+void ce_missed_frame_test(void);
+void ce_test_run_frames(uint16_t numFrames);
+void ce_test_1kHz_handler(void);
+void ce_test_100Hz_handler(void);
+void ce_test_10Hz_handler(void);
+void ce_test_slow_handler(void);
+
+uint32_t ceTestCounts[CE_NUM_RATE_GROUPS];
+
+void ce_run_unit_tests(void) {
+    log_prints("STARTING CYCLIC EXECUTIVE TESTS\r\n");
+
+    // Stop the timer so the test controls exactly when each frame starts
+    HAL_NVIC_DisableIRQ(HC_CE_TIMER_IRQn);
+    CE_TIMER->CR1 &= ~(TIM_CR1_CEN);
+
+    ce_rate_group_test();
+    ce_budget_test();
+    ce_missed_frame_test();
+
+    ts_init();
+    ce_init();
+    HAL_NVIC_EnableIRQ(HC_CE_TIMER_IRQn);
+
+    char m[50];
+    sprintf(m, "CYCLIC EXECUTIVE TESTS FAILED: %i\r\n", ceTestsFailed);
+    log_prints(m);
+}
+
+void ce_test_run_frames(uint16_t numFrames) {
+    for (uint16_t i = 0; i < numFrames; i++) {
+        // Pretend the compare has just happened
+        CE_TIMER->CCR2 = CE_TIMER->CNT;
+        ce_isr();
+    }
+}
+
+void ce_test_1kHz_handler(void) {
+    ceTestCounts[CE_RATE_1KHZ]++;
+}
+
+void ce_test_100Hz_handler(void) {
+    ceTestCounts[CE_RATE_100HZ]++;
+}
+
+void ce_test_10Hz_handler(void) {
+    ceTestCounts[CE_RATE_10HZ]++;
+}
+
+void ce_test_slow_handler(void) {
+    cc_delay_us(200);
+}
+
+void ce_rate_group_test(void) {
+
+    ce_init();
+
+    for (uint8_t i = 0; i < CE_NUM_RATE_GROUPS; i++) {
+        ceTestCounts[i] = 0;
+    }
+
+    uint8_t slot1kHz  = ce_add_slot(CE_RATE_1KHZ, ce_test_1kHz_handler, 100);
+    uint8_t slot100Hz = ce_add_slot(CE_RATE_100HZ, ce_test_100Hz_handler, 100);
+    uint8_t slot10Hz  = ce_add_slot(CE_RATE_10HZ, ce_test_10Hz_handler, 100);
+    CE_ASSERT(slot1kHz != CE_INVALID_SLOT);
+    CE_ASSERT(slot100Hz != CE_INVALID_SLOT);
+    CE_ASSERT(slot10Hz != CE_INVALID_SLOT);
+    CE_ASSERT((CE_TIMER->DIER & TIM_DIER_CC2IE) == TIM_DIER_CC2IE);
+
+    ce_test_run_frames(1000);
+    CE_ASSERT(ceTestCounts[CE_RATE_1KHZ] == 1000);
+    CE_ASSERT(ceTestCounts[CE_RATE_100HZ] == 100);
+    CE_ASSERT(ceTestCounts[CE_RATE_10HZ] == 10);
+    CE_ASSERT(ce_get_frame_overruns() == 0);
+
+    // Removed callbacks no longer run and the interrupt stops with the last one
+    ce_remove_slot(slot100Hz);
+    ce_test_run_frames(100);
+    CE_ASSERT(ceTestCounts[CE_RATE_1KHZ] == 1100);
+    CE_ASSERT(ceTestCounts[CE_RATE_100HZ] == 100);
+    CE_ASSERT(ceTestCounts[CE_RATE_10HZ] == 11);
+
+    ce_remove_slot(slot1kHz);
+    ce_remove_slot(slot10Hz);
+    CE_ASSERT((CE_TIMER->DIER & TIM_DIER_CC2IE) == 0);
+}
+
+void ce_budget_test(void) {
+
+    ce_init();
+
+    // The 100Hz and 10Hz groups never share a frame so both can use what the
+    // 1kHz group leaves
+    CE_ASSERT(ce_add_slot(CE_RATE_1KHZ, ce_test_1kHz_handler, 400) != CE_INVALID_SLOT);
+    CE_ASSERT(ce_add_slot(CE_RATE_100HZ, ce_test_100Hz_handler, 400) != CE_INVALID_SLOT);
+    CE_ASSERT(ce_add_slot(CE_RATE_10HZ, ce_test_10Hz_handler, 400) != CE_INVALID_SLOT);
+    CE_ASSERT(ce_add_slot(CE_RATE_1KHZ, ce_test_1kHz_handler, 1) == CE_INVALID_SLOT);
+    CE_ASSERT(ce_add_slot(CE_NUM_RATE_GROUPS, ce_test_1kHz_handler, 1) == CE_INVALID_SLOT);
+
+    ce_init();
+
+    // Callbacks that run longer than their budget are counted
+    uint8_t slowSlot = ce_add_slot(CE_RATE_1KHZ, ce_test_slow_handler, 100);
+    ce_test_run_frames(3);
+    CE_ASSERT(ce_get_slot_overruns(slowSlot) == 3);
+    CE_ASSERT(ce_get_slot_max_time_us(slowSlot) >= 200);
+
+    ce_reset_statistics();
+    CE_ASSERT(ce_get_slot_overruns(slowSlot) == 0);
+    CE_ASSERT(ce_get_slot_max_time_us(slowSlot) == 0);
+
+    // Slots are reused once removed
+    ce_remove_slot(slowSlot);
+    for (uint8_t i = 0; i < CE_MAX_SLOTS; i++) {
+        CE_ASSERT(ce_add_slot(CE_RATE_10HZ, ce_test_10Hz_handler, 1) != CE_INVALID_SLOT);
+    }
+    CE_ASSERT(ce_add_slot(CE_RATE_10HZ, ce_test_10Hz_handler, 1) == CE_INVALID_SLOT);
+
+    ce_init();
+}
+
+void ce_missed_frame_test(void) {
+
+    ce_init();
+
+    for (uint8_t i = 0; i < CE_NUM_RATE_GROUPS; i++) {
+        ceTestCounts[i] = 0;
+    }
+
+    ce_add_slot(CE_RATE_1KHZ, ce_test_1kHz_handler, 100);
+    ce_add_slot(CE_RATE_100HZ, ce_test_100Hz_handler, 100);
+
+    // Start three frames late. The missed frames are counted and skipped and
+    // the next compare is one frame after the current one
+    CE_TIMER->CCR2 = (CE_TIMER->CNT + CE_TIMER_PERIOD - 3) % CE_TIMER_PERIOD;
+    ce_isr();
+    CE_ASSERT(ce_get_frame_overruns() == 3);
+    CE_ASSERT(ceTestCounts[CE_RATE_1KHZ] == 1);
+    CE_ASSERT(CE_TIMER->CCR2 == ((CE_TIMER->CNT + 1) % CE_TIMER_PERIOD));
+
+    // The skipped frames keep the slower groups on their original phase. Frame
+    // 4 is next so the 100Hz group doesn't run until frame 11
+    ce_test_run_frames(7);
+    CE_ASSERT(ceTestCounts[CE_RATE_100HZ] == 0);
+    ce_test_run_frames(1);
+    CE_ASSERT(ceTestCounts[CE_RATE_100HZ] == 1);
+
+    ce_init();
+}
+#endif
@@ -0,0 +1,236 @@
+/**
+ * @file event_queue.c
+ * @author Gian Barta-Dougall
+ * @brief Lock free queues for passing events from interrupts to the main loop
+ * @version 0.1
+ * @date --
+ *
+ * @copyright Copyright (c)
+ *
+ */
+/* Public Includes */
+
+/* Private Includes */
+#include "event_queue.h"
+#include "utilities.h"
+#include "monotonic_time.h"
+
+/* Private STM Includes */
+#include "stm32l4xx_hal.h"
+
+/* Private #defines */
+#define EVENT_QUEUE_ID_INVALID(id)   ((id < EVENT_QUEUE_ID_OFFSET) || (id > (NUM_EVENT_QUEUES - 1 + EVENT_QUEUE_ID_OFFSET)))
+#define EVENT_QUEUE_ID_TO_INDEX(id)  (id - EVENT_QUEUE_ID_OFFSET)
+#define EVENT_QUEUE_MASK(position)   ((position) & (EVENT_QUEUE_SIZE - 1))
+#define EVENT_QUEUE_OCCUPANCY(queue) ((queue)->head - (queue)->tail)
+
+/* Private Structures and Enumerations */
+
+// The head is only ever written by the interrupt and the tail is only ever
+// written by the main loop. Both count up forever and are masked to get the
+// index into the events so a full queue can be told apart from an empty one
+typedef struct EventQueue {
+    Event events[EVENT_QUEUE_SIZE];
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    uint32_t overflowCount;
+    uint32_t maxOccupancy;
+} EventQueue;
+
+/* Private Variable Declarations */
+EventQueue eventQueues[NUM_EVENT_QUEUES];
+
+/* Private Function Prototypes */
+
+/* Public Functions */
+
+RAM_FUNCTION void event_queue_push(uint8_t queueId, uint8_t type, uint8_t data) {
+
+    if (EVENT_QUEUE_ID_INVALID(queueId)) {
+        return;
+    }
+
+    EventQueue* queue = &eventQueues[EVENT_QUEUE_ID_TO_INDEX(queueId)];
+    uint32_t head     = queue->head;
+    uint32_t occupied = head - queue->tail;
+
+    if (occupied == EVENT_QUEUE_SIZE) {
+        queue->overflowCount++;
+        return;
+    }
+
+    Event* event     = &queue->events[EVENT_QUEUE_MASK(head)];
+    event->timestamp = time_now_us();
+    event->type      = type;
+    event->data      = data;
+
+    // The event must be completely written before the main loop can see it
+    __DMB();
+    queue->head = head + 1;
+
+    if ((occupied + 1) > queue->maxOccupancy) {
+        queue->maxOccupancy = occupied + 1;
+    }
+}
+
+uint8_t event_queue_pop(Event* event) {
+
+    EventQueue* oldest = NULL;
+
+    // Take the oldest event out of all the queues so events are processed in the
+    // order they occured regardless of which interrupt they came from
+    for (uint8_t i = 0; i < NUM_EVENT_QUEUES; i++) {
+
+        EventQueue* queue = &eventQueues[i];
+
+        if (EVENT_QUEUE_OCCUPANCY(queue) == 0) {
+            continue;
+        }
+
+        // Make sure the event is read after the head that says it is there
+        __DMB();
+
+        if ((oldest == NULL) || ((int32_t)(queue->events[EVENT_QUEUE_MASK(queue->tail)].timestamp -
+                                           oldest->events[EVENT_QUEUE_MASK(oldest->tail)].timestamp) < 0)) {
+            oldest = queue;
+        }
+    }
+
+    if (oldest == NULL) {
+        return FALSE;
+    }
+
+    *event = oldest->events[EVENT_QUEUE_MASK(oldest->tail)];
+
+    // The event must be copied out before the interrupt is allowed to reuse its slot
+    __DMB();
+    oldest->tail = oldest->tail + 1;
+
+    return TRUE;
+}
+
+uint8_t event_queue_is_empty(void) {
+
+    for (uint8_t i = 0; i < NUM_EVENT_QUEUES; i++) {
+        if (EVENT_QUEUE_OCCUPANCY(&eventQueues[i]) != 0) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+uint32_t event_queue_get_overflow_count(uint8_t queueId) {
+
+    if (EVENT_QUEUE_ID_INVALID(queueId)) {
+        return 0;
+    }
+
+    return eventQueues[EVENT_QUEUE_ID_TO_INDEX(queueId)].overflowCount;
+}
+
+uint32_t event_queue_get_max_occupancy(uint8_t queueId) {
+
+    if (EVENT_QUEUE_ID_INVALID(queueId)) {
+        return 0;
+    }
+
+    return eventQueues[EVENT_QUEUE_ID_TO_INDEX(queueId)].maxOccupancy;
+}
+
+/* Private Functions */
+
+#if (PROJECT_STATUS == UNIT_TESTS)
+uint8_t eqTestsFailed = 0;
+
+#    define EQ_ASSERT(test)                                                                         \
+        do {                                                                                        \
+            if (!(test)) {                                                                          \
+                char msg[100];                                                                      \
+                sprintf(msg, "Unit test failed in File %s line number %d\r\n", __FILE__, __LINE__); \
+                log_prints(msg);                                                                    \
+                eqTestsFailed++;                                                                    \
+            }                                                                                       \
+        } while (0)
+
+/* Function definitions */
+void event_queue_order_test(void);
+void event_queue_overflow_test(void);
+
+void event_queue_run_unit_tests(void) {
+    log_prints("STARTING EVENT QUEUE TESTS\r\n");
+
+    // Interrupts are the only producers of the queues so they are stopped while
+    // the tests act as the producer instead
+    __disable_irq();
+
+    event_queue_order_test();
+    event_queue_overflow_test();
+
+    // Clear the statistics the tests left behind
+    for (uint8_t i = 0; i < NUM_EVENT_QUEUES; i++) {
+        eventQueues[i].tail          = eventQueues[i].head;
+        eventQueues[i].overflowCount = 0;
+        eventQueues[i].maxOccupancy  = 0;
+    }
+
+    __enable_irq();
+
+    char m[50];
+    sprintf(m, "EVENT QUEUE TESTS FAILED: %i\r\n", eqTestsFailed);
+    log_prints(m);
+}
+
+void event_queue_order_test(void) {
+
+    Event event;
+
+    // Events in the same queue come out in the order they were added
+    event_queue_push(EQ_PRIORITY_5_QUEUE_ID, EVENT_BUTTON_EDGE, 1);
+    event_queue_push(EQ_PRIORITY_5_QUEUE_ID, EVENT_BUTTON_EDGE, 2);
+    event_queue_push(EQ_PRIORITY_5_QUEUE_ID, EVENT_ENCODER_MAX_HEIGHT_REACHED, 3);
+
+    EQ_ASSERT(event_queue_pop(&event) == TRUE);
+    EQ_ASSERT(event.type == EVENT_BUTTON_EDGE && event.data == 1);
+    EQ_ASSERT(event_queue_pop(&event) == TRUE);
+    EQ_ASSERT(event.type == EVENT_BUTTON_EDGE && event.data == 2);
+    EQ_ASSERT(event_queue_pop(&event) == TRUE);
+    EQ_ASSERT(event.type == EVENT_ENCODER_MAX_HEIGHT_REACHED && event.data == 3);
+    EQ_ASSERT(event_queue_pop(&event) == FALSE);
+
+    // Events from every queue are drained
+    event_queue_push(EQ_MAX_PRIORITY_QUEUE_ID, EVENT_SERIAL_CHARACTER_RECEIVED, 'a');
+    event_queue_push(EQ_PRIORITY_2_QUEUE_ID, EVENT_INTERRUPT_LOG, 0);
+
+    uint8_t numEvents = 0;
+    while (event_queue_pop(&event) == TRUE) {
+        numEvents++;
+    }
+
+    EQ_ASSERT(numEvents == 2);
+
+    // Invalid queue ids are ignored
+    event_queue_push(EVENT_QUEUE_ID_OFFSET + NUM_EVENT_QUEUES, EVENT_BUTTON_EDGE, 0);
+    EQ_ASSERT(event_queue_pop(&event) == FALSE);
+}
+
+void event_queue_overflow_test(void) {
+
+    Event event;
+
+    for (uint16_t i = 0; i < (EVENT_QUEUE_SIZE + 2); i++) {
+        event_queue_push(EQ_PRIORITY_2_QUEUE_ID, EVENT_INTERRUPT_LOG, i);
+    }
+
+    EQ_ASSERT(event_queue_get_overflow_count(EQ_PRIORITY_2_QUEUE_ID) == 2);
+    EQ_ASSERT(event_queue_get_max_occupancy(EQ_PRIORITY_2_QUEUE_ID) == EVENT_QUEUE_SIZE);
+
+    // The events that were dropped are the newest ones
+    for (uint16_t i = 0; i < EVENT_QUEUE_SIZE; i++) {
+        EQ_ASSERT(event_queue_pop(&event) == TRUE);
+        EQ_ASSERT(event.data == i);
+    }
+
+    EQ_ASSERT(event_queue_pop(&event) == FALSE);
+}
+#endif
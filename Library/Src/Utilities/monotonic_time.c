@@ -0,0 +1,171 @@
+/**
+ * @file monotonic_time.c
+ * @author Gian Barta-Dougall
+ * @brief Single time base for the whole system. A free running 1MHz timer is
+ * extended to 64 bits by counting its overflows so every timestamp taken from
+ * here can be compared with every other
+ * @version 0.1
+ * @date --
+ *
+ * @copyright Copyright (c)
+ *
+ */
+/* Public Includes */
+#include <stdio.h>
+
+/* Private Includes */
+#include "monotonic_time.h"
+#include "hardware_config.h"
+#include "utilities.h"
+#include "log.h"
+
+/* Private STM Includes */
+
+/* Private #defines */
+#define TIME_TIMER        HC_TIME_TIMER
+#define TIME_TIMER_PERIOD (HC_TIME_TIMER_MAX_COUNT + 1)
+
+#if (HC_TIME_TIMER_FREQUENCY != TIMER_FREQUENCY_1MHz)
+#    error The monotonic time needs its timer to count at 1MHz
+#endif
+
+/* Private Structures and Enumerations */
+
+/* Private Variable Declarations */
+
+// The 32 bit overflow count and 16 bit timer give 48 bits of microseconds
+// which lasts 8.9 years before wrapping
+uint32_t timeOverflows = 0;
+
+/* Private Function Prototypes */
+
+/* Public Functions */
+
+RAM_FUNCTION uint64_t time_now_us(void) {
+
+    uint32_t primask;
+    ENTER_CRITICAL_SECTION(primask);
+
+    uint32_t count     = TIME_TIMER->CNT;
+    uint32_t overflows = timeOverflows;
+
+    // The timer may have wrapped without the overflow isr having run yet. Read
+    // the count again so it is guaranteed to be from after the wrap
+    if ((TIME_TIMER->SR & TIM_SR_UIF) == TIM_SR_UIF) {
+        count = TIME_TIMER->CNT;
+        overflows++;
+    }
+
+    EXIT_CRITICAL_SECTION(primask);
+
+    return ((uint64_t)overflows * TIME_TIMER_PERIOD) + count;
+}
+
+uint64_t time_now_ms(void) {
+    return time_now_us() / TIME_US_PER_MS;
+}
+
+uint64_t time_extend_us(uint32_t timestamp) {
+
+    uint64_t now = time_now_us();
+
+    // The lower bits of now minus the timestamp is how long ago it was even
+    // if the lower bits wrapped in between
+    return now - (uint32_t)((uint32_t)now - timestamp);
+}
+
+RAM_FUNCTION void time_overflow_isr(void) {
+
+    // The flag is cleared and counted together so a higher priority interrupt
+    // reading the time never sees the flag cleared without the count updated
+    uint32_t primask;
+    ENTER_CRITICAL_SECTION(primask);
+    TIME_TIMER->SR = ~TIM_SR_UIF;
+    timeOverflows++;
+    EXIT_CRITICAL_SECTION(primask);
+}
+
+void time_advance_us(uint64_t us) {
+
+    uint32_t primask;
+    ENTER_CRITICAL_SECTION(primask);
+
+    // Any overflow still pending is included in the time read here so the flag
+    // is cleared along with it
+    TIME_TIMER->CR1 &= ~(TIM_CR1_CEN);
+    uint64_t now = time_now_us() + us;
+
+    timeOverflows   = (uint32_t)(now / TIME_TIMER_PERIOD);
+    TIME_TIMER->CNT = (uint32_t)(now % TIME_TIMER_PERIOD);
+    TIME_TIMER->SR  = ~TIM_SR_UIF;
+    TIME_TIMER->CR1 |= TIM_CR1_CEN;
+
+    EXIT_CRITICAL_SECTION(primask);
+}
+
+/* Private Functions */
+
+/************************************ UNIT TESTING ************************************/
+
+#if (PROJECT_STATUS == UNIT_TESTS)
+uint8_t timeTestsFailed = 0;
+
+#    define TIME_ASSERT(test)                                                                       \
+        do {                                                                                        \
+            if (!(test)) {                                                                          \
+                char msg[100];                                                                      \
+                sprintf(msg, "Unit test failed in File %s line number %d\r\n", __FILE__, __LINE__); \
+                log_prints(msg);                                                                    \
+                timeTestsFailed++;                                                                  \
+            }                                                                                       \
+        } while (0)
+
+/* Function definitions */
+void time_monotonic_test(void);
+void time_extend_test(void);
+
+void time_run_unit_tests(void) {
+    log_prints("STARTING MONOTONIC TIME TESTS\r\n");
+
+    time_monotonic_test();
+    time_extend_test();
+
+    char m[50];
+    sprintf(m, "MONOTONIC TIME TESTS FAILED: %i\r\n", timeTestsFailed);
+    log_prints(m);
+}
+
+void time_monotonic_test(void) {
+
+    // Read across more than one overflow of the timer. The time must never go
+    // backwards
+    uint64_t start    = time_now_us();
+    uint64_t previous = start;
+    uint8_t wentBack  = FALSE;
+
+    while ((previous - start) < (2 * TIME_TIMER_PERIOD)) {
+
+        uint64_t now = time_now_us();
+
+        if (now < previous) {
+            wentBack = TRUE;
+        }
+
+        previous = now;
+    }
+
+    TIME_ASSERT(wentBack == FALSE);
+    TIME_ASSERT(time_now_ms() >= (previous / TIME_US_PER_MS));
+}
+
+void time_extend_test(void) {
+
+    uint64_t now = time_now_us();
+
+    TIME_ASSERT(time_extend_us((uint32_t)now) == now);
+
+    // A timestamp from a little while ago keeps its upper bits
+    uint64_t earlier = time_extend_us((uint32_t)now - 1000);
+    TIME_ASSERT((now - earlier) == 1000);
+}
+#endif
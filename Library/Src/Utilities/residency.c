@@ -0,0 +1,487 @@
+/**
+ * @file residency.c
+ * @author Gian Barta-Dougall
+ * @brief Records how long the mcu spends running, asleep and stopped and how
+ * long each load on the board is on. Together with the currents in
+ * residency_config.h this estimates the charge each blind uses per day
+ * @version 0.1
+ * @date --
+ *
+ * @copyright Copyright (c)
+ *
+ */
+/* Public Includes */
+
+/* Private Includes */
+#include "residency_config.h"
+#include "monotonic_time.h"
+#include "utilities.h"
+#include "log.h"
+
+/* Private STM Includes */
+
+/* Private #defines */
+#define RES_STATE_INVALID(state) (state >= RES_NUM_STATES)
+#define RES_STATE_IS_LOAD(state) ((state >= RES_MOTOR_1_DRIVING) && (state < RES_NUM_STATES))
+
+#define RES_HOURS_PER_DAY 24
+#define RES_US_PER_MS     1000
+#define RES_MS_PER_S      1000
+#define RES_UA_PER_MA     1000
+
+/* Private Structures and Enumerations */
+
+/* Private Variable Declarations */
+
+// Time the current recording started
+uint64_t resStartUs = 0;
+
+// Time in each state. Run isn't recorded, it is whatever time is left over
+uint64_t resTimeUs[RES_NUM_STATES] = {0};
+
+// Clock profile the mcu is in, when it switched to it and the time spent in
+// each profile before that. Sleep and stop are also split by profile so run
+// can be worked out for each
+uint8_t resProfile                                              = MCU_CLOCK_LOW_POWER;
+uint64_t resProfileStartUs                                      = 0;
+uint64_t resProfileUs[MCU_CLOCK_NUM_PROFILES]                   = {0};
+uint64_t resProfileIdleUs[MCU_CLOCK_NUM_PROFILES][RES_STOP + 1] = {{0}};
+
+// When each load that is on was turned on
+uint64_t resLoadStartUs[RES_NUM_STATES] = {0};
+uint8_t resLoadOn[RES_NUM_STATES]       = {FALSE};
+
+/* Private Function Prototypes */
+uint32_t res_get_current_ua(uint8_t state, uint8_t profile);
+uint32_t res_get_uah_per_day(uint32_t currentUa, uint64_t timeUs, uint64_t elapsedUs);
+uint32_t res_get_state_uah_per_day(uint8_t state, uint64_t elapsedUs);
+void res_print_time(const char* name, uint64_t timeUs);
+void res_print_charge(const char* name, uint8_t number, uint32_t uahPerDay);
+
+/* Public Functions */
+
+void res_reset(void) {
+
+    uint32_t primask;
+    ENTER_CRITICAL_SECTION(primask);
+
+    uint64_t now = time_now_us();
+    resStartUs   = now;
+
+    // Loads that are on start counting again from now
+    for (uint8_t i = 0; i < RES_NUM_STATES; i++) {
+        resTimeUs[i]      = 0;
+        resLoadStartUs[i] = now;
+    }
+
+    resProfile        = mcu_clock_get_profile();
+    resProfileStartUs = now;
+
+    for (uint8_t profile = 0; profile < MCU_CLOCK_NUM_PROFILES; profile++) {
+        resProfileUs[profile]                = 0;
+        resProfileIdleUs[profile][RES_SLEEP] = 0;
+        resProfileIdleUs[profile][RES_STOP]  = 0;
+    }
+
+    EXIT_CRITICAL_SECTION(primask);
+}
+
+void res_add_idle_time(uint8_t state, uint32_t us) {
+
+    if ((state != RES_SLEEP) && (state != RES_STOP)) {
+        return;
+    }
+
+    uint32_t primask;
+    ENTER_CRITICAL_SECTION(primask);
+    resTimeUs[state] += us;
+    resProfileIdleUs[resProfile][state] += us;
+    EXIT_CRITICAL_SECTION(primask);
+}
+
+void res_set_clock_profile(uint8_t profile) {
+
+    if (profile >= MCU_CLOCK_NUM_PROFILES) {
+        return;
+    }
+
+    uint32_t primask;
+    ENTER_CRITICAL_SECTION(primask);
+
+    uint64_t now = time_now_us();
+    resProfileUs[resProfile] += now - resProfileStartUs;
+    resProfileStartUs = now;
+    resProfile        = profile;
+
+    EXIT_CRITICAL_SECTION(primask);
+}
+
+RAM_FUNCTION void res_load_on(uint8_t state) {
+
+    if (RES_STATE_IS_LOAD(state) == FALSE) {
+        return;
+    }
+
+    uint32_t primask;
+    ENTER_CRITICAL_SECTION(primask);
+
+    if (resLoadOn[state] == FALSE) {
+        resLoadStartUs[state] = time_now_us();
+        resLoadOn[state]      = TRUE;
+    }
+
+    EXIT_CRITICAL_SECTION(primask);
+}
+
+RAM_FUNCTION void res_load_off(uint8_t state) {
+
+    if (RES_STATE_IS_LOAD(state) == FALSE) {
+        return;
+    }
+
+    uint32_t primask;
+    ENTER_CRITICAL_SECTION(primask);
+
+    if (resLoadOn[state] == TRUE) {
+        resTimeUs[state] += time_now_us() - resLoadStartUs[state];
+        resLoadOn[state] = FALSE;
+    }
+
+    EXIT_CRITICAL_SECTION(primask);
+}
+
+uint64_t res_get_time_us(uint8_t state) {
+
+    if (RES_STATE_INVALID(state)) {
+        return 0;
+    }
+
+    uint32_t primask;
+    ENTER_CRITICAL_SECTION(primask);
+
+    uint64_t now    = time_now_us();
+    uint64_t timeUs = resTimeUs[state];
+
+    if (state == RES_RUN) {
+        uint64_t elapsedUs = now - resStartUs;
+        uint64_t idleUs    = resTimeUs[RES_SLEEP] + resTimeUs[RES_STOP];
+        timeUs             = (elapsedUs > idleUs) ? (elapsedUs - idleUs) : 0;
+    } else if (resLoadOn[state] == TRUE) {
+        timeUs += now - resLoadStartUs[state];
+    }
+
+    EXIT_CRITICAL_SECTION(primask);
+
+    return timeUs;
+}
+
+uint64_t res_get_profile_time_us(uint8_t state, uint8_t profile) {
+
+    if ((state > RES_STOP) || (profile >= MCU_CLOCK_NUM_PROFILES)) {
+        return 0;
+    }
+
+    uint32_t primask;
+    ENTER_CRITICAL_SECTION(primask);
+
+    uint64_t profileUs = resProfileUs[profile];
+    uint64_t sleepUs   = resProfileIdleUs[profile][RES_SLEEP];
+    uint64_t stopUs    = resProfileIdleUs[profile][RES_STOP];
+
+    if (profile == resProfile) {
+        profileUs += time_now_us() - resProfileStartUs;
+    }
+
+    EXIT_CRITICAL_SECTION(primask);
+
+    if (state == RES_SLEEP) {
+        return sleepUs;
+    }
+
+    if (state == RES_STOP) {
+        return stopUs;
+    }
+
+    return (profileUs > (sleepUs + stopUs)) ? (profileUs - (sleepUs + stopUs)) : 0;
+}
+
+void res_print(void) {
+
+    uint64_t elapsedUs = time_now_us() - resStartUs;
+
+    if (elapsedUs == 0) {
+        return;
+    }
+
+    char m[60];
+    sprintf(m, "Run: %i%%, Sleep: %i%%, Stop: %i%%\r\n", (uint8_t)((res_get_time_us(RES_RUN) * 100) / elapsedUs),
+            (uint8_t)((res_get_time_us(RES_SLEEP) * 100) / elapsedUs),
+            (uint8_t)((res_get_time_us(RES_STOP) * 100) / elapsedUs));
+    log_prints(m);
+
+    res_print_time("Recorded", elapsedUs);
+
+    for (uint8_t profile = 0; profile < MCU_CLOCK_NUM_PROFILES; profile++) {
+        sprintf(m, "%s run", mcu_clock_get_profile_name(profile));
+        res_print_time(m, res_get_profile_time_us(RES_RUN, profile));
+        sprintf(m, "%s sleep", mcu_clock_get_profile_name(profile));
+        res_print_time(m, res_get_profile_time_us(RES_SLEEP, profile));
+    }
+
+    res_print_time("Motor 1 driving", res_get_time_us(RES_MOTOR_1_DRIVING));
+    res_print_time("Motor 1 braking", res_get_time_us(RES_MOTOR_1_BRAKING));
+    res_print_time("Motor 2 driving", res_get_time_us(RES_MOTOR_2_DRIVING));
+    res_print_time("Motor 2 braking", res_get_time_us(RES_MOTOR_2_BRAKING));
+    res_print_time("Buzzer on", res_get_time_us(RES_BUZZER_ON));
+    res_print_time("ADC on", res_get_time_us(RES_ADC_ON));
+
+    // The mcu and the loads that aren't motors are shared evenly by the
+    // blinds. Each blind also uses the charge of its own motor
+    uint32_t boardUah  = 0;
+    uint32_t sharedUah = 0;
+    uint32_t motorUah[RES_NUM_MOTORS];
+
+    for (uint8_t i = 0; i < RES_NUM_MOTORS; i++) {
+        motorUah[i] = 0;
+    }
+
+    for (uint8_t state = 0; state < RES_NUM_STATES; state++) {
+
+        uint32_t uah = res_get_state_uah_per_day(state, elapsedUs);
+        boardUah += uah;
+
+        if ((state >= RES_MOTOR_1_DRIVING) && (state < RES_MOTOR_DRIVING(RES_NUM_MOTORS))) {
+            motorUah[state - RES_MOTOR_1_DRIVING] += uah;
+        } else if ((state >= RES_MOTOR_1_BRAKING) && (state < RES_MOTOR_BRAKING(RES_NUM_MOTORS))) {
+            motorUah[state - RES_MOTOR_1_BRAKING] += uah;
+        } else {
+            sharedUah += uah;
+        }
+    }
+
+    res_print_charge("Board", 0, boardUah);
+
+    for (uint8_t i = 0; i < RES_NUM_MOTORS; i++) {
+        res_print_charge("Blind", i + 1, motorUah[i] + (sharedUah / RES_NUM_MOTORS));
+    }
+}
+
+/* Private Functions */
+
+/**
+ * @brief Returns the current drawn in a state. Run and sleep depend on the
+ * clock profile, every other state ignores it
+ *
+ * @param state The state
+ * @param profile The clock profile
+ * @return uint32_t The current in uA
+ */
+uint32_t res_get_current_ua(uint8_t state, uint8_t profile) {
+
+    if (RES_STATE_INVALID(state) || (profile >= MCU_CLOCK_NUM_PROFILES)) {
+        return 0;
+    }
+
+    if (RES_STATE_FOLLOWS_PROFILE(state)) {
+        return residencyProfileCurrents[profile][state];
+    }
+
+    return residencyCurrents[state];
+}
+
+/**
+ * @brief Works out the charge a current uses per day from the fraction of the
+ * recording it was drawn for
+ *
+ * @param currentUa The current in uA
+ * @param timeUs Time the current was drawn
+ * @param elapsedUs Length of the recording
+ * @return uint32_t The charge in uAh per day
+ */
+uint32_t res_get_uah_per_day(uint32_t currentUa, uint64_t timeUs, uint64_t elapsedUs) {
+
+    if (elapsedUs == 0) {
+        return 0;
+    }
+
+    return (uint32_t)((timeUs * currentUa * RES_HOURS_PER_DAY) / elapsedUs);
+}
+
+/**
+ * @brief Works out the charge a state used per day over the recording. Run
+ * and sleep are summed over the time spent in each clock profile
+ *
+ * @param state The state
+ * @param elapsedUs Length of the recording
+ * @return uint32_t The charge in uAh per day
+ */
+uint32_t res_get_state_uah_per_day(uint8_t state, uint64_t elapsedUs) {
+
+    if (RES_STATE_FOLLOWS_PROFILE(state) == FALSE) {
+        return res_get_uah_per_day(res_get_current_ua(state, MCU_CLOCK_LOW_POWER), res_get_time_us(state), elapsedUs);
+    }
+
+    uint32_t uah = 0;
+
+    for (uint8_t profile = 0; profile < MCU_CLOCK_NUM_PROFILES; profile++) {
+        uah += res_get_uah_per_day(res_get_current_ua(state, profile), res_get_profile_time_us(state, profile),
+                                   elapsedUs);
+    }
+
+    return uah;
+}
+
+void res_print_time(const char* name, uint64_t timeUs) {
+
+    uint64_t ms = timeUs / RES_US_PER_MS;
+
+    char m[60];
+    sprintf(m, "%s: %lu.%03lus\r\n", name, (uint32_t)(ms / RES_MS_PER_S), (uint32_t)(ms % RES_MS_PER_S));
+    log_prints(m);
+}
+
+void res_print_charge(const char* name, uint8_t number, uint32_t uahPerDay) {
+
+    char m[60];
+
+    if (number == 0) {
+        sprintf(m, "%s: %lu.%03lumAh/day\r\n", name, uahPerDay / RES_UA_PER_MA, uahPerDay % RES_UA_PER_MA);
+    } else {
+        sprintf(m, "%s %i: %lu.%03lumAh/day\r\n", name, number, uahPerDay / RES_UA_PER_MA,
+                uahPerDay % RES_UA_PER_MA);
+    }
+
+    log_prints(m);
+}
+
+/************************************ UNIT TESTING ************************************/
+
+#if (PROJECT_STATUS == UNIT_TESTS)
+#    include "cycle_counter.h"
+
+uint8_t resTestsFailed = 0;
+
+#    define RES_ASSERT(test)                                                                        \
+        do {                                                                                        \
+            if (!(test)) {                                                                          \
+                char msg[100];                                                                      \
+                sprintf(msg, "Unit test failed in File %s line number %d\r\n", __FILE__, __LINE__); \
+                log_prints(msg);                                                                    \
+                resTestsFailed++;                                                                   \
+            }                                                                                       \
+        } while (0)
+
+/* Function definitions */
+void res_time_test(void);
+void res_profile_test(void);
+void res_charge_test(void);
+
+void res_run_unit_tests(void) {
+    log_prints("STARTING RESIDENCY TESTS\r\n");
+
+    res_time_test();
+    res_profile_test();
+    res_charge_test();
+
+    // Start recording again so the tests don't show up in the estimates
+    res_reset();
+
+    char m[50];
+    sprintf(m, "RESIDENCY TESTS FAILED: %i\r\n", resTestsFailed);
+    log_prints(m);
+}
+
+void res_time_test(void) {
+
+    res_reset();
+
+    // Only sleep and stop can be added, run is whatever is left over
+    res_add_idle_time(RES_SLEEP, 1000);
+    res_add_idle_time(RES_STOP, 2000);
+    res_add_idle_time(RES_RUN, 4000);
+    RES_ASSERT(res_get_time_us(RES_SLEEP) == 1000);
+    RES_ASSERT(res_get_time_us(RES_STOP) == 2000);
+
+    // The mcu states can't be turned on and off like a load
+    res_load_on(RES_RUN);
+    RES_ASSERT(resLoadOn[RES_RUN] == FALSE);
+
+    // A load turned on twice keeps its first start time
+    res_load_on(RES_ADC_ON);
+    cc_delay_us(100);
+    res_load_on(RES_ADC_ON);
+    RES_ASSERT(res_get_time_us(RES_ADC_ON) >= 100);
+
+    res_load_off(RES_ADC_ON);
+    uint64_t adcUs = res_get_time_us(RES_ADC_ON);
+    RES_ASSERT(adcUs >= 100);
+
+    // Nothing is added once the load is off
+    cc_delay_us(100);
+    res_load_off(RES_ADC_ON);
+    RES_ASSERT(res_get_time_us(RES_ADC_ON) == adcUs);
+
+    RES_ASSERT(res_get_time_us(RES_NUM_STATES) == 0);
+}
+
+void res_profile_test(void) {
+
+    res_reset();
+    res_set_clock_profile(MCU_CLOCK_LOW_POWER);
+
+    // Idle time goes to the profile the mcu was in when it idled
+    cc_delay_us(300);
+    res_add_idle_time(RES_SLEEP, 100);
+    res_set_clock_profile(MCU_CLOCK_PERFORMANCE);
+    cc_delay_us(300);
+    res_add_idle_time(RES_SLEEP, 50);
+    res_add_idle_time(RES_STOP, 20);
+
+    RES_ASSERT(res_get_profile_time_us(RES_SLEEP, MCU_CLOCK_LOW_POWER) == 100);
+    RES_ASSERT(res_get_profile_time_us(RES_STOP, MCU_CLOCK_LOW_POWER) == 0);
+    RES_ASSERT(res_get_profile_time_us(RES_SLEEP, MCU_CLOCK_PERFORMANCE) == 50);
+    RES_ASSERT(res_get_profile_time_us(RES_STOP, MCU_CLOCK_PERFORMANCE) == 20);
+
+    // Run is the time left in each profile once its idle time is taken out
+    RES_ASSERT(res_get_profile_time_us(RES_RUN, MCU_CLOCK_LOW_POWER) >= 200);
+    RES_ASSERT(res_get_profile_time_us(RES_RUN, MCU_CLOCK_PERFORMANCE) >= 230);
+
+    // The low power profile stops counting once the mcu has left it
+    uint64_t lowPowerUs = res_get_profile_time_us(RES_RUN, MCU_CLOCK_LOW_POWER);
+    cc_delay_us(100);
+    RES_ASSERT(res_get_profile_time_us(RES_RUN, MCU_CLOCK_LOW_POWER) == lowPowerUs);
+
+    // Only run, sleep and stop are split by profile
+    RES_ASSERT(res_get_profile_time_us(RES_ADC_ON, MCU_CLOCK_LOW_POWER) == 0);
+    RES_ASSERT(res_get_profile_time_us(RES_RUN, MCU_CLOCK_NUM_PROFILES) == 0);
+
+    res_set_clock_profile(mcu_clock_get_profile());
+}
+
+void res_charge_test(void) {
+
+    uint64_t day = (uint64_t)RES_HOURS_PER_DAY * 3600 * RES_MS_PER_S * RES_US_PER_MS;
+
+    // Run and sleep draw the current of the profile, the other states don't
+    // depend on it
+    RES_ASSERT(res_get_current_ua(RES_RUN, MCU_CLOCK_PERFORMANCE) ==
+               residencyProfileCurrents[MCU_CLOCK_PERFORMANCE][RES_RUN]);
+    RES_ASSERT(res_get_current_ua(RES_SLEEP, MCU_CLOCK_LOW_POWER) ==
+               residencyProfileCurrents[MCU_CLOCK_LOW_POWER][RES_SLEEP]);
+    RES_ASSERT(res_get_current_ua(RES_STOP, MCU_CLOCK_PERFORMANCE) == residencyCurrents[RES_STOP]);
+    RES_ASSERT(res_get_current_ua(RES_RUN, MCU_CLOCK_PERFORMANCE) > res_get_current_ua(RES_RUN, MCU_CLOCK_LOW_POWER));
+    RES_ASSERT(res_get_current_ua(RES_NUM_STATES, MCU_CLOCK_LOW_POWER) == 0);
+    RES_ASSERT(res_get_current_ua(RES_RUN, MCU_CLOCK_NUM_PROFILES) == 0);
+
+    // A current drawn the whole recording is drawn for all 24 hours
+    RES_ASSERT(res_get_uah_per_day(1000, day, day) == (1000 * RES_HOURS_PER_DAY));
+    RES_ASSERT(res_get_uah_per_day(1000, day / 2, day) == (1000 * RES_HOURS_PER_DAY / 2));
+
+    // The estimate only depends on the fraction of the recording so a short
+    // recording gives the same result
+    RES_ASSERT(res_get_uah_per_day(residencyCurrents[RES_MOTOR_1_DRIVING], 1000, 100000) ==
+               (residencyCurrents[RES_MOTOR_1_DRIVING] * RES_HOURS_PER_DAY / 100));
+
+    RES_ASSERT(res_get_uah_per_day(1000, 1000, 0) == 0);
+}
+#endif
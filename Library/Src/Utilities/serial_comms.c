@@ -24,6 +24,20 @@
 
 /* Includes that are used for processing commmands */
 #include "blind.h"
+#include "blind_motor.h"
+#include "tempest.h"
+#include "task_scheduler_1.h"
+#include "event_queue.h"
+#include "cyclic_executive.h"
+#include "real_time_clock.h"
+#include "schedule.h"
+#include "solar.h"
+#include "mcu_clock.h"
+#include "low_power.h"
+#include "peripheral_clock.h"
+#include "residency.h"
+#include "cycle_counter.h"
+#include "hardware_config.h"
 
 #define MOVE_BLIND_X_UP         "move x up           \t"
 #define MOVE_BLIND_X_DOWN       "move x down         \t"
@@ -42,23 +56,67 @@
 #define INFO_BOARD              "info board"
 #define SET_BLIND_1_MODE_MANUAL "set 1 mode manual"
 #define SET_BLIND_2_MODE_MANUAL "set 2 mode manual"
+#define INFO_IDLE               "info idle"
+#define INFO_SCHEDULER          "info scheduler"
+#define RESET_SCHEDULER         "reset scheduler"
+#define INFO_EVENTS             "info events"
+#define INFO_CYCLIC             "info cyclic"
+#define RESET_CYCLIC            "reset cyclic"
+#define INFO_TIME               "info time"
+#define SET_TIME                "set time "
+#define INFO_SCHEDULE           "info schedule"
+#define ADD_SCHEDULE            "add schedule "
+#define REMOVE_SCHEDULE         "remove schedule "
+#define INFO_SUN                "info sun"
+#define INFO_CLOCK              "info clock"
+#define SET_CLOCK               "set clock "
+#define INFO_PERIPHERALS        "info peripherals"
+#define INFO_RESIDENCY          "info residency"
+#define RESET_RESIDENCY         "reset residency"
+#define MEASURE_ISR             "measure isr"
 
 const char* TEMPEST_MANUAL = MOVE_BLIND_X_DOWN
     "Moves blind x down\r\n" MOVE_BLIND_X_UP "Moves blind x up\r\n" INFO_BLIND_X
     "Prints the current information on blind x\r\n" INFO_ALS_X "Prints the current information on als x\r\n" INFO_BOARD
     "Prints the current board information\r\n" SET_BLIND_X_MIN_HEIGHT
-    "Sets the current height of blind x as the minimum height";
+    "Sets the current height of blind x as the minimum height\r\n" INFO_IDLE "           \t"
+    "Prints the percentage of time the mcu spent asleep over the last second and the number of times it "
+    "has entered Stop 2\r\n" INFO_SCHEDULER "      \t"
+    "Prints the task scheduler statistics\r\n" RESET_SCHEDULER "     \t"
+    "Resets the task scheduler statistics\r\n" INFO_EVENTS "         \t"
+    "Prints the maximum occupancy and overflows of each interrupt event queue\r\n" INFO_CYCLIC "         \t"
+    "Prints the run times and overruns of the cyclic executive\r\n" RESET_CYCLIC "        \t"
+    "Resets the cyclic executive statistics\r\n" INFO_TIME "           \t"
+    "Prints the date and time of the real time clock\r\n" SET_TIME "YYYY-MM-DD hh:mm:ss\t"
+    "Sets the date and time of the real time clock\r\n" INFO_SCHEDULE "       \t"
+    "Prints the schedule and the next time a blind will move\r\n" ADD_SCHEDULE "x up|down hh:mm daily|weekdays|weekends\t"
+    "Moves blind x at the given time on the given days\r\n" REMOVE_SCHEDULE "n  \t"
+    "Removes entry n from the schedule\r\n" INFO_SUN "            \t"
+    "Prints the sunrise and sunset for today\r\n" INFO_CLOCK "          \t"
+    "Prints the clock profile and the system clock\r\n" SET_CLOCK "low power|performance\t"
+    "Switches the clock profile\r\n" INFO_PERIPHERALS "    \t"
+    "Prints which peripheral clocks are on and how many drivers are holding each\r\n" INFO_RESIDENCY "      \t"
+    "Prints the time spent in each power state and the estimated charge used per day\r\n" RESET_RESIDENCY "     \t"
+    "Starts recording the power states again\r\n" MEASURE_ISR "         \t"
+    "Prints the cycles taken to enter the scheduler isr. The cycles spent in it are in info scheduler";
 
 /* Private Macros */
 #define ASCII_KEY_ENTER 0x0D
 #define ASCII_KEY_ESC   0x1C
 
+// The enter key plus the \r\n\0 written after it
+#define SERIAL_COMMS_LINE_END_SIZE 4
+
 /* Private Variables */
 char buffer[1024];
 uint16_t bufferIndex = 0;
 
 void serial_comms_process_command(char* string);
 void serial_comms_process_action(char c);
+void serial_comms_print_time(void);
+void serial_comms_set_time(char* arguments);
+void serial_comms_add_schedule(char* arguments);
+void serial_comms_set_clock(char* profileName);
 
 void serial_comms_init(void) {}
 
@@ -69,11 +127,17 @@ void serial_comms_clear_buffer(void) {
 void serial_comms_add_to_buffer(char c) {
 
     // Check whether the character is a letter/number or something else
-    if ((c < '!' || c > '~') && (c != ASCII_KEY_ENTER)) {
+    if ((c < ' ' || c > '~') && (c != ASCII_KEY_ENTER)) {
         serial_comms_process_action(c);
         return;
     }
 
+    // Room is always kept for the enter key and the \r\n\0 added after it so
+    // the rest of a line that is too long is dropped
+    if ((c != ASCII_KEY_ENTER) && (bufferIndex >= (sizeof(buffer) - SERIAL_COMMS_LINE_END_SIZE))) {
+        return;
+    }
+
     buffer[bufferIndex] = c;
     bufferIndex++;
 
@@ -111,6 +175,117 @@ void serial_comms_process_command(char* string) {
         log_message("Blind 1 mode set to manual\r\n");
     }
 
+    if (chars_same(string, INFO_IDLE) == TRUE) {
+        char m[50];
+        sprintf(m, "Idle: %i%%, Stop 2 entries: %lu\r\n", tempest_get_idle_percentage(), lp_get_stop_count());
+        log_message(m);
+        return;
+    }
+
+    if (chars_same(string, INFO_SCHEDULER) == TRUE) {
+        ts_print_statistics();
+        return;
+    }
+
+    if (chars_same(string, RESET_SCHEDULER) == TRUE) {
+        ts_reset_statistics();
+        log_message("Scheduler statistics reset\r\n");
+        return;
+    }
+
+    if (chars_same(string, INFO_CYCLIC) == TRUE) {
+        ce_print_statistics();
+        return;
+    }
+
+    if (chars_same(string, RESET_CYCLIC) == TRUE) {
+        ce_reset_statistics();
+        log_message("Cyclic executive statistics reset\r\n");
+        return;
+    }
+
+    if (chars_same(string, INFO_EVENTS) == TRUE) {
+        char m[60];
+        for (uint8_t id = EVENT_QUEUE_ID_OFFSET; id < (EVENT_QUEUE_ID_OFFSET + NUM_EVENT_QUEUES); id++) {
+            sprintf(m, "Event queue %i: max %lu, dropped %lu\r\n", id - EVENT_QUEUE_ID_OFFSET,
+                    event_queue_get_max_occupancy(id), event_queue_get_overflow_count(id));
+            log_message(m);
+        }
+        return;
+    }
+
+    if (chars_same(string, INFO_TIME) == TRUE) {
+        serial_comms_print_time();
+        return;
+    }
+
+    if (chars_starts_with(string, SET_TIME) == TRUE) {
+        serial_comms_set_time(string + sizeof(SET_TIME) - 1);
+        return;
+    }
+
+    if (chars_same(string, INFO_SUN) == TRUE) {
+        solar_print();
+        return;
+    }
+
+    if (chars_same(string, INFO_CLOCK) == TRUE) {
+        char m[60];
+        sprintf(m, "Clock: %s, %luHz\r\n", mcu_clock_get_profile_name(mcu_clock_get_profile()), SystemCoreClock);
+        log_message(m);
+        return;
+    }
+
+    if (chars_starts_with(string, SET_CLOCK) == TRUE) {
+        serial_comms_set_clock(string + sizeof(SET_CLOCK) - 1);
+        return;
+    }
+
+    if (chars_same(string, INFO_PERIPHERALS) == TRUE) {
+        pclk_print();
+        return;
+    }
+
+    if (chars_same(string, INFO_RESIDENCY) == TRUE) {
+        res_print();
+        return;
+    }
+
+    if (chars_same(string, RESET_RESIDENCY) == TRUE) {
+        res_reset();
+        log_message("Residency statistics reset\r\n");
+        return;
+    }
+
+    if (chars_same(string, MEASURE_ISR) == TRUE) {
+        char m[60];
+        sprintf(m, "Scheduler isr entry: %lu cycles\r\n", cc_measure_isr_latency(HC_TS_TIMER_IRQn));
+        log_prints(m);
+        return;
+    }
+
+    if (chars_same(string, INFO_SCHEDULE) == TRUE) {
+        schedule_print();
+        return;
+    }
+
+    if (chars_starts_with(string, ADD_SCHEDULE) == TRUE) {
+        serial_comms_add_schedule(string + sizeof(ADD_SCHEDULE) - 1);
+        return;
+    }
+
+    if (chars_starts_with(string, REMOVE_SCHEDULE) == TRUE) {
+        int index;
+        if ((sscanf(string + sizeof(REMOVE_SCHEDULE) - 1, "%d", &index) != 1) || (index < 0) ||
+            (schedule_remove_entry(index) == FALSE)) {
+            log_message("Invalid schedule entry\r\n");
+            return;
+        }
+
+        log_message("Schedule entry removed\r\n");
+        return;
+    }
+
     // if (chars_same(string, MOVE_BLIND_1_UP)) {
     //     log_prints("Moving blind 1 upwards\r\n");
     //     return;
@@ -147,4 +322,123 @@ void serial_comms_process_command(char* string) {
     // }
 }
 
+void serial_comms_print_time(void) {
+
+    if (rtc_calendar_is_set() == FALSE) {
+        log_message("Time not set\r\n");
+        return;
+    }
+
+    RtcDateTime now;
+    rtc_get_date_time(&now);
+
+    char m[40];
+    sprintf(m, "%04i-%02i-%02i %s %02i:%02i:%02i\r\n", now.year, now.month, now.day,
+            rtc_get_weekday_name(now.weekday), now.hours, now.minutes, now.seconds);
+    log_message(m);
+}
+
+void serial_comms_set_time(char* arguments) {
+
+    int year, month, day, hours, minutes, seconds;
+    if (sscanf(arguments, "%d-%d-%d %d:%d:%d", &year, &month, &day, &hours, &minutes, &seconds) != 6) {
+        log_message("Expected " SET_TIME "YYYY-MM-DD hh:mm:ss\r\n");
+        return;
+    }
+
+    // Out of range values are caught here so they aren't truncated into valid
+    // ones when stored. The calendar checks the rest
+    if ((year < 0) || (month < 0) || (month > 12) || (day < 0) || (day > 31) || (hours < 0) || (hours > 23) ||
+        (minutes < 0) || (minutes > 59) || (seconds < 0) || (seconds > 59)) {
+        log_message("Invalid date or time\r\n");
+        return;
+    }
+
+    RtcDateTime dateTime = {
+        .year    = year,
+        .month   = month,
+        .day     = day,
+        .hours   = hours,
+        .minutes = minutes,
+        .seconds = seconds,
+    };
+
+    if (rtc_set_date_time(&dateTime) == FALSE) {
+        log_message("Invalid date or time\r\n");
+        return;
+    }
+
+    // The next move in the schedule and the sunrise and sunset depend on the
+    // date and time so they are found again
+    schedule_update_alarm();
+    solar_update();
+    serial_comms_print_time();
+}
+
+void serial_comms_add_schedule(char* arguments) {
+
+    int blind, hours, minutes;
+    char direction[5];
+    char days[9];
+    if (sscanf(arguments, "%d %4s %d:%d %8s", &blind, direction, &hours, &minutes, days) != 5) {
+        log_message("Expected " ADD_SCHEDULE "x up|down hh:mm daily|weekdays|weekends\r\n");
+        return;
+    }
+
+    if ((blind < 1) || (blind > NUM_BLINDS) || (hours < 0) || (hours > 23) || (minutes < 0) || (minutes > 59)) {
+        log_message("Invalid blind or time\r\n");
+        return;
+    }
+
+    ScheduleEntry entry = {
+        .blindId = BLIND_1_ID + blind - 1,
+        .hours   = hours,
+        .minutes = minutes,
+    };
+
+    if (chars_same(direction, "up") == TRUE) {
+        entry.direction = BLIND_UP;
+    } else if (chars_same(direction, "down") == TRUE) {
+        entry.direction = BLIND_DOWN;
+    } else {
+        log_message("Direction must be up or down\r\n");
+        return;
+    }
+
+    if (chars_same(days, "daily") == TRUE) {
+        entry.days = SCHEDULE_DAILY;
+    } else if (chars_same(days, "weekdays") == TRUE) {
+        entry.days = SCHEDULE_WEEKDAYS;
+    } else if (chars_same(days, "weekends") == TRUE) {
+        entry.days = SCHEDULE_WEEKENDS;
+    } else {
+        log_message("Days must be daily, weekdays or weekends\r\n");
+        return;
+    }
+
+    if (schedule_add_entry(&entry) == FALSE) {
+        log_message("Schedule is full\r\n");
+        return;
+    }
+
+    schedule_print();
+}
+
+void serial_comms_set_clock(char* profileName) {
+
+    for (uint8_t profile = 0; profile < MCU_CLOCK_NUM_PROFILES; profile++) {
+
+        if (chars_same(profileName, (char*) mcu_clock_get_profile_name(profile)) == TRUE) {
+            mcu_clock_set_profile(profile);
+
+            char m[60];
+            sprintf(m, "Clock: %s, %luHz\r\n", mcu_clock_get_profile_name(profile), SystemCoreClock);
+            log_message(m);
+            return;
+        }
+    }
+
+    log_message("Profile must be low power or performance\r\n");
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,326 @@
+/**
+ * @file solar.c
+ * @author Gian Barta-Dougall
+ * @brief Sunrise and sunset times worked out from the date and the location
+ * of the blinds. The times are found once a day so the light sensor only has
+ * to be read around sunrise and sunset
+ * @version 0.1
+ * @date --
+ *
+ * @copyright Copyright (c)
+ *
+ */
+/* Public Includes */
+#include <math.h>
+#include <stdio.h>
+
+/* Private Includes */
+#include "solar.h"
+#include "real_time_clock.h"
+#include "hardware_config.h"
+#include "utilities.h"
+#include "log.h"
+
+/* Private STM Includes */
+
+/* Private #defines */
+
+/**
+ * The sun position uses the NOAA fractional year approximation which is good
+ * to a couple of minutes. Everything is done in single precision so it runs
+ * on the FPU
+ */
+#define SOLAR_PI                 3.14159265f
+#define SOLAR_DEGREES_TO_RADIANS (SOLAR_PI / 180.0f)
+#define SOLAR_RADIANS_TO_DEGREES (180.0f / SOLAR_PI)
+
+// The sun is taken to have risen when its centre is 0.833 degrees below the
+// horizon to allow for refraction and the size of the sun
+#define SOLAR_ZENITH_DEGREES 90.833f
+
+#define SOLAR_MINUTES_PER_DAY   1440
+#define SOLAR_MINUTES_PER_DEGREE 4.0f
+#define SOLAR_NOON_MINUTES      720.0f
+
+// The times are found again just after midnight
+#define SOLAR_ALARM         RTC_ALARM_B
+#define SOLAR_ALARM_MINUTES 1
+
+/* Private Structures and Enumerations */
+
+/* Private Variable Declarations */
+const uint16_t solarDaysBeforeMonth[] = {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334};
+
+const SolarLocation solarLocation = {
+    .latitude  = HC_SOLAR_LATITUDE,
+    .longitude = HC_SOLAR_LONGITUDE,
+    .utcOffset = HC_SOLAR_UTC_OFFSET_MINUTES,
+};
+
+SolarTimes solarToday;
+uint8_t solarTodayValid = FALSE;
+
+/* Private Function Prototypes */
+uint16_t solar_get_day_of_year(uint16_t year, uint8_t month, uint8_t day);
+uint16_t solar_wrap_minutes(float minutes);
+uint16_t solar_get_minute_of_day(void);
+uint16_t solar_get_minutes_between(uint16_t minuteA, uint16_t minuteB);
+
+/* Public Functions */
+
+void solar_init(void) {
+    solar_update();
+}
+
+void solar_update(void) {
+
+    if (rtc_calendar_is_set() == FALSE) {
+        solarTodayValid = FALSE;
+        rtc_disable_alarm(SOLAR_ALARM);
+        return;
+    }
+
+    RtcDateTime now;
+    rtc_get_date_time(&now);
+
+    solar_calculate(&solarLocation, now.year, now.month, now.day, &solarToday);
+    solarTodayValid = TRUE;
+
+    rtc_set_alarm(SOLAR_ALARM, RTC_EVERY_DAY, 0, SOLAR_ALARM_MINUTES, 0);
+}
+
+void solar_calculate(const SolarLocation* location, uint16_t year, uint8_t month, uint8_t day, SolarTimes* times) {
+
+    // Fractional year in radians, taken at midday
+    float gamma = (2.0f * SOLAR_PI / 365.0f) * (float)(solar_get_day_of_year(year, month, day) - 1);
+
+    float sinGamma = sinf(gamma);
+    float cosGamma = cosf(gamma);
+    float sin2     = sinf(2.0f * gamma);
+    float cos2     = cosf(2.0f * gamma);
+
+    // Minutes the sun is ahead of the mean sun
+    float equationOfTime =
+        229.18f * (0.000075f + (0.001868f * cosGamma) - (0.032077f * sinGamma) - (0.014615f * cos2) - (0.040849f * sin2));
+
+    float declination = 0.006918f - (0.399912f * cosGamma) + (0.070257f * sinGamma) - (0.006758f * cos2) +
+                        (0.000907f * sin2) - (0.002697f * cosf(3.0f * gamma)) + (0.00148f * sinf(3.0f * gamma));
+
+    float latitude = location->latitude * SOLAR_DEGREES_TO_RADIANS;
+
+    float cosHourAngle = (cosf(SOLAR_ZENITH_DEGREES * SOLAR_DEGREES_TO_RADIANS) / (cosf(latitude) * cosf(declination))) -
+                         (tanf(latitude) * tanf(declination));
+
+    if (cosHourAngle > 1.0f) {
+        times->polarState = SOLAR_POLAR_NIGHT;
+        times->sunrise    = 0;
+        times->sunset     = 0;
+        return;
+    }
+
+    if (cosHourAngle < -1.0f) {
+        times->polarState = SOLAR_POLAR_DAY;
+        times->sunrise    = 0;
+        times->sunset     = 0;
+        return;
+    }
+
+    float hourAngle = acosf(cosHourAngle) * SOLAR_RADIANS_TO_DEGREES;
+    float noon = SOLAR_NOON_MINUTES - (SOLAR_MINUTES_PER_DEGREE * location->longitude) - equationOfTime +
+                 (float)location->utcOffset;
+
+    times->polarState = SOLAR_POLAR_NONE;
+    times->sunrise    = solar_wrap_minutes(noon - (SOLAR_MINUTES_PER_DEGREE * hourAngle));
+    times->sunset     = solar_wrap_minutes(noon + (SOLAR_MINUTES_PER_DEGREE * hourAngle));
+}
+
+uint8_t solar_get_period(void) {
+
+    if (solarTodayValid == FALSE) {
+        return SOLAR_UNKNOWN;
+    }
+
+    if (solarToday.polarState == SOLAR_POLAR_DAY) {
+        return SOLAR_DAY;
+    }
+
+    if (solarToday.polarState == SOLAR_POLAR_NIGHT) {
+        return SOLAR_NIGHT;
+    }
+
+    uint16_t minute = solar_get_minute_of_day();
+
+    // The local day can start or end in the middle of the day light if the
+    // location is far from its time zone
+    if (solarToday.sunrise < solarToday.sunset) {
+        return ((minute >= solarToday.sunrise) && (minute < solarToday.sunset)) ? SOLAR_DAY : SOLAR_NIGHT;
+    }
+
+    return ((minute >= solarToday.sunrise) || (minute < solarToday.sunset)) ? SOLAR_DAY : SOLAR_NIGHT;
+}
+
+uint8_t solar_is_twilight(void) {
+
+    if ((solarTodayValid == FALSE) || (solarToday.polarState != SOLAR_POLAR_NONE)) {
+        return FALSE;
+    }
+
+    uint16_t minute = solar_get_minute_of_day();
+
+    if ((solar_get_minutes_between(minute, solarToday.sunrise) <= SOLAR_TWILIGHT_MINUTES) ||
+        (solar_get_minutes_between(minute, solarToday.sunset) <= SOLAR_TWILIGHT_MINUTES)) {
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+void solar_print(void) {
+
+    if (solarTodayValid == FALSE) {
+        log_prints("Time not set\r\n");
+        return;
+    }
+
+    if (solarToday.polarState == SOLAR_POLAR_DAY) {
+        log_prints("Sun is up all day\r\n");
+        return;
+    }
+
+    if (solarToday.polarState == SOLAR_POLAR_NIGHT) {
+        log_prints("Sun is down all day\r\n");
+        return;
+    }
+
+    char m[40];
+    sprintf(m, "Sunrise %02i:%02i Sunset %02i:%02i\r\n", solarToday.sunrise / 60, solarToday.sunrise % 60,
+            solarToday.sunset / 60, solarToday.sunset % 60);
+    log_prints(m);
+}
+
+/* Private Functions */
+
+uint16_t solar_get_day_of_year(uint16_t year, uint8_t month, uint8_t day) {
+
+    uint16_t dayOfYear = solarDaysBeforeMonth[month - 1] + day;
+
+    // Every year divisible by 4 in the range of the calendar is a leap year
+    if ((month > 2) && ((year % 4) == 0)) {
+        dayOfYear++;
+    }
+
+    return dayOfYear;
+}
+
+uint16_t solar_wrap_minutes(float minutes) {
+
+    int32_t rounded = (int32_t)floorf(minutes + 0.5f) % SOLAR_MINUTES_PER_DAY;
+
+    if (rounded < 0) {
+        rounded += SOLAR_MINUTES_PER_DAY;
+    }
+
+    return rounded;
+}
+
+uint16_t solar_get_minute_of_day(void) {
+
+    RtcDateTime now;
+    rtc_get_date_time(&now);
+
+    return (now.hours * 60) + now.minutes;
+}
+
+uint16_t solar_get_minutes_between(uint16_t minuteA, uint16_t minuteB) {
+
+    uint16_t difference = (minuteA > minuteB) ? (minuteA - minuteB) : (minuteB - minuteA);
+
+    // Times either side of midnight are close together
+    if (difference > (SOLAR_MINUTES_PER_DAY / 2)) {
+        difference = SOLAR_MINUTES_PER_DAY - difference;
+    }
+
+    return difference;
+}
+
+/************************************ UNIT TESTING ************************************/
+
+#if (PROJECT_STATUS == UNIT_TESTS)
+uint8_t solarTestsFailed = 0;
+
+#    define SOLAR_ASSERT(test)                                                                      \
+        do {                                                                                        \
+            if (!(test)) {                                                                          \
+                char msg[100];                                                                      \
+                sprintf(msg, "Unit test failed in File %s line number %d\r\n", __FILE__, __LINE__); \
+                log_prints(msg);                                                                    \
+                solarTestsFailed++;                                                                 \
+            }                                                                                       \
+        } while (0)
+
+// Published times are rounded to the minute and the approximation is good to
+// a couple of minutes
+#    define SOLAR_TIME_CLOSE(minute, hours, minutes) \
+        (solar_get_minutes_between(minute, ((hours) * 60) + (minutes)) <= 3)
+
+/* Function definitions */
+void solar_calculate_test(void);
+void solar_polar_test(void);
+void solar_minutes_between_test(void);
+
+void solar_run_unit_tests(void) {
+    log_prints("STARTING SOLAR TESTS\r\n");
+
+    solar_calculate_test();
+    solar_polar_test();
+    solar_minutes_between_test();
+
+    char m[50];
+    sprintf(m, "SOLAR TESTS FAILED: %i\r\n", solarTestsFailed);
+    log_prints(m);
+}
+
+void solar_calculate_test(void) {
+
+    SolarLocation brisbane = {.latitude = -27.47f, .longitude = 153.03f, .utcOffset = 600};
+    SolarTimes times;
+
+    // Winter solstice, sunrise 06:38 and sunset 17:02
+    solar_calculate(&brisbane, 2023, 6, 21, &times);
+    SOLAR_ASSERT(times.polarState == SOLAR_POLAR_NONE);
+    SOLAR_ASSERT(SOLAR_TIME_CLOSE(times.sunrise, 6, 38));
+    SOLAR_ASSERT(SOLAR_TIME_CLOSE(times.sunset, 17, 2));
+
+    // Summer solstice, sunrise 04:48 and sunset 18:41
+    solar_calculate(&brisbane, 2023, 12, 21, &times);
+    SOLAR_ASSERT(times.polarState == SOLAR_POLAR_NONE);
+    SOLAR_ASSERT(SOLAR_TIME_CLOSE(times.sunrise, 4, 48));
+    SOLAR_ASSERT(SOLAR_TIME_CLOSE(times.sunset, 18, 41));
+
+    // Equinox at Greenwich, sunrise 06:03 and sunset 18:13
+    SolarLocation greenwich = {.latitude = 51.48f, .longitude = 0.0f, .utcOffset = 0};
+    solar_calculate(&greenwich, 2024, 3, 20, &times);
+    SOLAR_ASSERT(SOLAR_TIME_CLOSE(times.sunrise, 6, 3));
+    SOLAR_ASSERT(SOLAR_TIME_CLOSE(times.sunset, 18, 13));
+}
+
+void solar_polar_test(void) {
+
+    SolarLocation svalbard = {.latitude = 78.2f, .longitude = 15.6f, .utcOffset = 60};
+    SolarTimes times;
+
+    solar_calculate(&svalbard, 2023, 6, 21, &times);
+    SOLAR_ASSERT(times.polarState == SOLAR_POLAR_DAY);
+
+    solar_calculate(&svalbard, 2023, 12, 21, &times);
+    SOLAR_ASSERT(times.polarState == SOLAR_POLAR_NIGHT);
+}
+
+void solar_minutes_between_test(void) {
+    SOLAR_ASSERT(solar_get_minutes_between(400, 430) == 30);
+    SOLAR_ASSERT(solar_get_minutes_between(430, 400) == 30);
+    SOLAR_ASSERT(solar_get_minutes_between(1430, 10) == 20);
+    SOLAR_ASSERT(solar_wrap_minutes(-10.0f) == 1430);
+    SOLAR_ASSERT(solar_wrap_minutes(1445.2f) == 5);
+}
+#endif
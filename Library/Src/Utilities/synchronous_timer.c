@@ -1,7 +1,9 @@
 /**
  * @file synchronous_timer.c
  * @author Gian Barta-Dougall
- * @brief System file for synchronous_timer
+ * @brief Time service for the system. The time since the service was enabled
+ * is worked out from the monotonic time when it is asked for and the
+ * synchronous events are scheduled as tasks so no timer has to tick in between
  * @version 0.1
  * @date --
  *
@@ -13,31 +15,148 @@
 /* Private Includes */
 #include "synchronous_timer.h"
 #include "hardware_config.h"
+#include "task_scheduler_1.h"
+#include "monotonic_time.h"
+#include "utilities.h"
+#include "version_config.h"
 #include "log.h"
+#include "blind.h"
 
 /* Private STM Includes */
 #include "stm32l4xx.h"
 
 /* Private #defines */
-#define SYNC_TIMER HC_SYNC_TIMER
+
+#define SYNC_TIMER_MS_PER_SECOND   1000
+#define SYNC_TIMER_SECONDS_PER_MIN 60
+#define SYNC_TIMER_MINS_PER_HOUR   60
+
+// The day light update happens 10 seconds into every minute
+#define SYNC_TIMER_DAY_LIGHT_UPDATE_OFFSET_MS 10000
+#define SYNC_TIMER_DAY_LIGHT_UPDATE_PERIOD_MS 60000
 
 /* Private Structures and Enumerations */
 
 /* Private Variable Declarations */
 
+// The monotonic time is 64 bits so it never wraps while the system is running
+// and the time can always be worked out from when the service was enabled
+uint64_t syncTimerStartMs = 0;
+
+TsHandle syncTimerDayLightHandle = TS_INVALID_HANDLE;
+
 /* Private Function Prototypes */
 
+#ifdef AMBIENT_LIGHT_SENSOR_MODULE_ENABLED
+const Task1 syncTimerDayLightTask = {
+    .delay      = SYNC_TIMER_DAY_LIGHT_UPDATE_PERIOD_MS,
+    .functionId = FUNC_ID_BLINDS_DAY_LIGHT_UPDATE,
+    .group      = BLIND_GROUP,
+    .nextTask   = &syncTimerDayLightTask,
+};
+
+const Task1 syncTimerFirstDayLightTask = {
+    .delay      = SYNC_TIMER_DAY_LIGHT_UPDATE_OFFSET_MS,
+    .functionId = FUNC_ID_BLINDS_DAY_LIGHT_UPDATE,
+    .group      = BLIND_GROUP,
+    .nextTask   = &syncTimerDayLightTask,
+};
+#endif
+
+void sync_timer_convert_time(uint64_t elapsedMs, SyncTime* time);
+
 /* Public Functions */
 
 void synchronous_timer_enable(void) {
-    SYNC_TIMER->EGR |= (TIM_EGR_UG);  // Reset counter to 0 and update all registers
-    SYNC_TIMER->DIER |= TIM_DIER_UIE; // Enable interrupts
-    SYNC_TIMER->CR1 |= TIM_CR1_CEN;   // Start the timer
+
+    synchronous_timer_disable();
+
+    syncTimerStartMs = time_now_ms();
+
+#ifdef AMBIENT_LIGHT_SENSOR_MODULE_ENABLED
+    ts_add_task_to_queue(&syncTimerFirstDayLightTask, &syncTimerDayLightHandle);
+#endif
 }
 
 void synchronous_timer_disable(void) {
-    SYNC_TIMER->DIER &= 0x00;          // Disable all interrupts
-    SYNC_TIMER->CR1 &= ~(TIM_CR1_CEN); // Disbable timer
+    ts_cancel_running_task(&syncTimerDayLightHandle);
+}
+
+void synchronous_timer_get_time(SyncTime* time) {
+    sync_timer_convert_time(time_now_ms() - syncTimerStartMs, time);
+}
+
+uint32_t synchronous_timer_get_seconds(void) {
+    return (time_now_ms() - syncTimerStartMs) / SYNC_TIMER_MS_PER_SECOND;
 }
 
 /* Private Functions */
+
+void sync_timer_convert_time(uint64_t elapsedMs, SyncTime* time) {
+
+    uint32_t seconds = elapsedMs / SYNC_TIMER_MS_PER_SECOND;
+    uint32_t minutes = seconds / SYNC_TIMER_SECONDS_PER_MIN;
+
+    time->milliseconds = elapsedMs % SYNC_TIMER_MS_PER_SECOND;
+    time->seconds      = seconds % SYNC_TIMER_SECONDS_PER_MIN;
+    time->minutes      = minutes % SYNC_TIMER_MINS_PER_HOUR;
+    time->hours        = minutes / SYNC_TIMER_MINS_PER_HOUR;
+}
+
+/************************************ UNIT TESTING ************************************/
+
+#if (PROJECT_STATUS == UNIT_TESTS)
+uint8_t syncTimerTestsFailed = 0;
+
+#    define SYNC_TIMER_ASSERT(test)                                                                 \
+        do {                                                                                        \
+            if (!(test)) {                                                                          \
+                char msg[100];                                                                      \
+                sprintf(msg, "Unit test failed in File %s line number %d\r\n", __FILE__, __LINE__); \
+                log_prints(msg);                                                                    \
+                syncTimerTestsFailed++;                                                             \
+            }                                                                                       \
+        } while (0)
+
+/* Function definitions */
+void sync_timer_time_test(void);
+void sync_timer_long_time_test(void);
+
+void synchronous_timer_run_unit_tests(void) {
+    log_prints("STARTING SYNCHRONOUS TIMER TESTS\r\n");
+
+    sync_timer_time_test();
+    sync_timer_long_time_test();
+
+    synchronous_timer_enable();
+
+    char m[50];
+    sprintf(m, "SYNCHRONOUS TIMER TESTS FAILED: %i\r\n", syncTimerTestsFailed);
+    log_prints(m);
+}
+
+void sync_timer_time_test(void) {
+
+    SyncTime time;
+
+    // 25 hours, 1 minute, 2 seconds and 500ms
+    sync_timer_convert_time((((25 * 3600) + 62) * 1000) + 500, &time);
+
+    SYNC_TIMER_ASSERT(time.hours == 25);
+    SYNC_TIMER_ASSERT(time.minutes == 1);
+    SYNC_TIMER_ASSERT(time.seconds == 2);
+    SYNC_TIMER_ASSERT(time.milliseconds == 500);
+}
+
+void sync_timer_long_time_test(void) {
+
+    SyncTime time;
+
+    // 50 days is past where a 32 bit millisecond count would have wrapped
+    sync_timer_convert_time((50ULL * 24 * 3600 * 1000) + 750, &time);
+    SYNC_TIMER_ASSERT(time.hours == (50 * 24));
+    SYNC_TIMER_ASSERT(time.minutes == 0);
+    SYNC_TIMER_ASSERT(time.seconds == 0);
+    SYNC_TIMER_ASSERT(time.milliseconds == 750);
+}
+#endif
@@ -18,26 +18,83 @@
 /* Private STM Includes */
 
 /* Private #defines */
-#define QUEUE_SIZE 6
-// Plus 1 to ensure that the last item can always be NULL as this allows the isr function to know when
-// to stop executing tasks from the queue head list
-#define QUEUE_HEAD_SIZE    (QUEUE_SIZE + 1)
 #define TS_TIMER           HC_TS_TIMER
 #define TS_TIMER_MAX_COUNT HC_TS_TIMER_MAX_COUNT
-#define TS_NONE            255
-#define TASK_FINISHED      62
+
+// The timer counts from 0 up to and including the max count so the number
+// of ticks in one period is one more than the max count
+#define TS_TIMER_PERIOD (TS_TIMER_MAX_COUNT + 1)
+
+// Execution times are measured on a 32 bit virtual timebase made up of the
+// number of times the timer has wrapped (the epoch) and the current count.
+// Comparing the signed difference keeps the ordering correct when the virtual
+// time itself wraps provided the two times are less than TS_MAX_DELAY apart
+#define TS_TIME_IS_BEFORE(a, b) ((int32_t)((uint32_t)(a) - (uint32_t)(b)) < 0)
+#define TS_TIME_IS_DUE(executionTime, currentTime) (!TS_TIME_IS_BEFORE(currentTime, executionTime))
+
+// Tasks with a handler usually don't have a group so they are recorded under TS_NO_GROUP
+#define TS_GROUP_TO_INDEX(group)                                                              \
+    ((((group) < TASK_SCHEDULER_OFFSET) || ((group) >= (TASK_SCHEDULER_OFFSET + TS_NUM_GROUPS))) \
+         ? (TS_NO_GROUP - TASK_SCHEDULER_OFFSET)                                              \
+         : ((group)-TASK_SCHEDULER_OFFSET))
+
+#define TS_HEAP_PARENT(i) (((i)-1) / 2)
+#define TS_HEAP_LEFT(i)   ((2 * (i)) + 1)
+#define TS_HEAP_RIGHT(i)  ((2 * (i)) + 2)
+
+#define TS_NOT_IN_HEAP 0xFFFF
+
+// A handle is made up of the index of the task in the queue and the generation
+// of that slot. The generation changes every time the slot is freed so handles
+// to tasks that have finished can never refer to a newer task in the same slot
+#define TS_HANDLE_INDEX(handle)             ((handle)&0xFFFF)
+#define TS_HANDLE_GENERATION(handle)        ((handle) >> 16)
+#define TS_CREATE_HANDLE(index, generation) ((((uint32_t)(generation)) << 16) | (index))
 
 /* Private Structures and Enumerations */
 
+enum TsTaskStates {
+    TS_TASK_FREE,
+    TS_TASK_QUEUED,
+    TS_TASK_FINISHED,
+    TS_TASK_CANCELLED_AFTER_FINISHING,
+};
+
 // This struct isn't necessary but it means you don't have to copy
 // as many items across when adding something into the queue thus can
 // run faster
 typedef struct TsTask {
     const Task1* task;
+    void* context;
     uint32_t executionTime;
-    uint8_t finished;
+    uint32_t wakeTime;
+    uint32_t lateness;
+    uint32_t skippedPeriods;
+    uint16_t heapIndex;
+    uint16_t generation;
+    uint8_t state;
 } TsTask;
 
+// Recorded while the scheduler is running so the queue can be sized and the
+// response time of tasks can be checked under load. Cheap enough to always be on
+typedef struct TsStatistics {
+    uint32_t latencyHistogram[TS_NUM_GROUPS][TS_LATENCY_HISTOGRAM_BINS];
+    uint16_t maxTasksInQueue;
+    uint16_t lastFinishedTasksPerLoop;
+    uint16_t maxFinishedTasksPerLoop;
+    uint32_t lastIsrCycles;
+    uint32_t maxIsrCycles;
+} TsStatistics;
+
+// Tasks that have been run by the isr but are yet to be removed or moved onto
+// their next task. Tasks are processed in the same order they finished in so
+// handlers are called in order of execution time
+typedef struct TsFinishedList {
+    TsTask* tasks[TS_QUEUE_CAPACITY];
+    uint16_t head;
+    uint16_t numTasks;
+} TsFinishedList;
+
 /* Private Variable Declarations */
 uint32_t buttonTasksFlag        = 0;
 uint32_t tempestTasksFlag       = 0;
@@ -45,19 +102,54 @@ uint32_t blindTasksFlag         = 0;
 uint32_t ambientLightSensorFlag = 0;
 uint32_t blindMotorFlag         = 0;
 
-TsTask queue[QUEUE_SIZE];
-TsTask* queueHead[QUEUE_HEAD_SIZE];
+// Storage for every task in the scheduler. Tasks never move once they are
+// placed in here, only the pointers in the heap are moved around
+TsTask queue[TS_QUEUE_CAPACITY];
+
+// Binary min-heap of the queued tasks ordered by the latest time they can run
+// (their execution time plus slack). The task that needs the timer to wake up
+// the soonest is always at index 0
+TsTask* heap[TS_QUEUE_CAPACITY];
 
-uint8_t finishedTasks = 0;
-int numTasksInQueue   = 0;
-uint8_t k             = 0;
+// Stack of the indexes in the queue that are not currently being used
+uint16_t freeSlots[TS_QUEUE_CAPACITY];
+uint16_t numFreeSlots = 0;
+
+// Finished tasks processed by the main loop and finished preemptive tasks
+// processed by the PendSV interrupt
+TsFinishedList finishedTasks;
+TsFinishedList preemptiveFinishedTasks;
+
+uint16_t numTasksInQueue = 0;
+uint32_t overflowCount   = 0;
+
+// Number of times the timer has wrapped since ts_init() was called
+uint32_t epoch = 0;
+
+TsStatistics tsStatistics;
+
+const char* tsGroupNames[TS_NUM_GROUPS] = {"Tempest", "Button", "ALS", "Blind motor", "Blind", "No group"};
 
 /* Private Function Prototypes */
 uint32_t ts_calculate_execution_time(uint32_t delayUntilExecution);
-void ts_copy_task_into_queue(uint8_t qi, const Task1* task);
-void ts_remove_task(uint8_t qi);
-void ts_move_to_next_task(uint8_t qi);
+uint32_t ts_limit_delay(uint32_t delay);
+void ts_copy_task_into_queue(TsTask* tsTask, const Task1* task, void* context, uint32_t delay);
+void ts_remove_task(TsTask* tsTask);
+TsTask* ts_get_task_from_handle(TsHandle handle);
+void ts_next_generation(TsTask* tsTask);
+void ts_move_to_next_task(TsTask* tsTask);
+void ts_set_execution_time(TsTask* tsTask, uint32_t executionTime);
+void ts_set_group_flag(const Task1* task);
 void ts_update_first_in_queue(void);
+void ts_record_latency(const Task1* task, uint32_t latency);
+uint16_t ts_process_finished_tasks(TsFinishedList* list);
+void ts_add_to_finished_list(TsFinishedList* list, TsTask* tsTask);
+uint8_t ts_time_is_in_current_period(uint32_t time, uint32_t currentTime);
+void ts_heap_swap(uint16_t i, uint16_t j);
+void ts_heap_sift_up(uint16_t i);
+void ts_heap_sift_down(uint16_t i);
+void ts_heap_push(TsTask* tsTask);
+void ts_heap_remove(uint16_t i);
 void ts_enable(void);
 void ts_disable(void);
 
@@ -65,263 +157,1039 @@ void ts_disable(void);
 
 void ts_init(void) {
 
-    for (uint8_t qi = 0; qi < QUEUE_HEAD_SIZE; qi++) {
-        queueHead[qi] = NULL;
+    numTasksInQueue                  = 0;
+    finishedTasks.numTasks           = 0;
+    finishedTasks.head               = 0;
+    preemptiveFinishedTasks.numTasks = 0;
+    preemptiveFinishedTasks.head     = 0;
+    numFreeSlots                     = 0;
+    overflowCount                    = 0;
+    epoch                            = 0;
+    ts_reset_statistics();
+
+    // Every slot in the queue starts off free. Slots are pushed in reverse
+    // so the first task added uses index 0
+    for (uint16_t qi = TS_QUEUE_CAPACITY; qi > 0; qi--) {
+        queue[qi - 1].task        = NULL;
+        queue[qi - 1].context     = NULL;
+        queue[qi - 1].state       = TS_TASK_FREE;
+        queue[qi - 1].heapIndex   = TS_NOT_IN_HEAP;
+        freeSlots[numFreeSlots++] = qi - 1;
+
+        // Invalidate any handles that were given out before the scheduler was reset
+        ts_next_generation(&queue[qi - 1]);
     }
+
+    // The timer runs continuously from here on so the virtual time never jumps
+    ts_disable();
+    ts_enable();
+}
+
+void ts_add_task_to_queue(const Task1* task, TsHandle* handle) {
+    ts_add_task_with_context_to_queue(task, NULL, handle);
 }
 
-void ts_add_task_to_queue(const Task1* task) {
-    // log_prints("Adding task\r\n");
+void ts_add_task_with_context_to_queue(const Task1* task, void* context, TsHandle* handle) {
+    ts_add_task_with_delay_to_queue(task, context, task->delay, handle);
+}
 
-    // Confirm this task doesn't already exist in the queue
-    for (uint8_t i = 0; i < QUEUE_SIZE; i++) {
-        if ((queue[i].task == task)) {
-            // log_prints("SKIPPING ADD\r\n");
-            return;
-        } else {
-            break;
-        }
-    }
+void ts_add_task_with_delay_to_queue(const Task1* task, void* context, uint32_t delay, TsHandle* handle) {
 
-    for (uint8_t i = 0; i < QUEUE_SIZE; i++) {
+    uint32_t primask;
+    ENTER_CRITICAL_SECTION(primask);
 
-        if (queue[i].task != NULL) {
-            continue;
-        }
+    TsTask* tsTask = (handle == NULL) ? NULL : ts_get_task_from_handle(*handle);
 
-        ts_copy_task_into_queue(i, task);
+    // If the task is already waiting in the queue, re-arming it just moves its
+    // execution time instead of adding a duplicate
+    if (tsTask != NULL && tsTask->state == TS_TASK_QUEUED) {
+        tsTask->task          = task;
+        tsTask->context       = context;
+        ts_set_execution_time(tsTask, ts_calculate_execution_time(delay));
+        ts_heap_sift_up(tsTask->heapIndex);
+        ts_heap_sift_down(tsTask->heapIndex);
         ts_update_first_in_queue();
-        break;
+
+        EXIT_CRITICAL_SECTION(primask);
+        return;
     }
-}
 
-uint8_t ts_cancel_running_task(const Task1* task) {
-    uint8_t num = 0;
+    // The previous instance has already run. Stop it from moving onto its next
+    // task so only the new instance continues
+    if (tsTask != NULL && tsTask->state == TS_TASK_FINISHED) {
+        tsTask->state = TS_TASK_CANCELLED_AFTER_FINISHING;
+    }
 
-    for (uint8_t qi = 0; qi < QUEUE_SIZE; qi++) {
-        // char m[60];
-        // sprintf(m, "Test: %p == %p\r\n", queue[qi].task, task);
-        // log_prints(m);
+    // Record the overflow instead of silently losing the task
+    if (numFreeSlots == 0) {
+        overflowCount++;
 
-        if (queue[qi].task == task) {
-            ts_remove_task(qi);
-            ts_update_first_in_queue();
-            num++;
+        if (handle != NULL) {
+            *handle = TS_INVALID_HANDLE;
         }
+
+        EXIT_CRITICAL_SECTION(primask);
+        return;
     }
 
-    if (num == 1) {
-        return TS_TASK_CANCELLED;
-    } else if (num == 0) {
-        // log_prints("task could not be found\r\n");
+    uint16_t index = freeSlots[--numFreeSlots];
+    ts_copy_task_into_queue(&queue[index], task, context, delay);
+    ts_update_first_in_queue();
+
+    if (handle != NULL) {
+        *handle = TS_CREATE_HANDLE(index, queue[index].generation);
+    }
+
+    EXIT_CRITICAL_SECTION(primask);
+}
+
+uint8_t ts_cancel_running_task(TsHandle* handle) {
+
+    uint32_t primask;
+    ENTER_CRITICAL_SECTION(primask);
+
+    TsTask* tsTask = ts_get_task_from_handle(*handle);
+    *handle        = TS_INVALID_HANDLE;
+
+    if (tsTask == NULL || tsTask->state == TS_TASK_CANCELLED_AFTER_FINISHING) {
+        EXIT_CRITICAL_SECTION(primask);
         return TS_TASK_NOT_FOUND;
     }
 
-    // char m[60];
-    // sprintf(m, "More than one task of id %i found\r\n", task->functionId);
-    // log_prints(m);
+    if (tsTask->state == TS_TASK_QUEUED) {
+        ts_heap_remove(tsTask->heapIndex);
+        ts_remove_task(tsTask);
+        ts_update_first_in_queue();
+    } else {
+        // The task has already run but the main loop has not processed it yet.
+        // Mark it so it is freed instead of moving onto its next task. The slot
+        // can't be freed here because it is still in the finished list
+        tsTask->state = TS_TASK_CANCELLED_AFTER_FINISHING;
+    }
+
+    EXIT_CRITICAL_SECTION(primask);
 
     return TS_TASK_CANCELLED;
 }
 
 void ts_process_internal_flags(void) {
 
-    if (finishedTasks == 0) {
+    if (finishedTasks.numTasks == 0) {
         return;
     }
 
-    for (uint8_t qi = 0; qi < QUEUE_SIZE; qi++) {
+    uint16_t numTasksHandled = ts_process_finished_tasks(&finishedTasks);
 
-        if (queue[qi].finished != TASK_FINISHED) {
-            continue;
-        }
+    tsStatistics.lastFinishedTasksPerLoop = numTasksHandled;
+    if (numTasksHandled > tsStatistics.maxFinishedTasksPerLoop) {
+        tsStatistics.maxFinishedTasksPerLoop = numTasksHandled;
+    }
+}
 
-        if (queue[qi].task->nextTask == NULL) {
-            ts_remove_task(qi);
+void ts_preemptive_isr(void) {
+    ts_process_finished_tasks(&preemptiveFinishedTasks);
+}
+
+RAM_FUNCTION void ts_isr(void) {
+
+    uint32_t currentTime           = ts_get_time();
+    uint8_t preemptiveTaskFinished = FALSE;
+
+    // Run every task whose execution time has been reached. Checking the time
+    // instead of only running tasks with the exact same execution time ensures
+    // tasks that became due while the isr was being serviced are not missed.
+    // Tasks with slack that are already due are run on this wakeup as well so
+    // they don't need a wakeup of their own later on
+    while ((numTasksInQueue != 0) && TS_TIME_IS_DUE(heap[0]->executionTime, currentTime)) {
+
+        TsTask* head = heap[0];
+        ts_heap_remove(0);
+        head->state = TS_TASK_FINISHED;
+
+        // Only tasks with a handler can be preemptive as the flags are only
+        // ever written from the main loop
+        if ((head->task->handler != NULL) && (head->task->priority == TS_PRIORITY_PREEMPTIVE)) {
+            ts_add_to_finished_list(&preemptiveFinishedTasks, head);
+            preemptiveTaskFinished = TRUE;
         } else {
-            ts_move_to_next_task(qi);
+            ts_add_to_finished_list(&finishedTasks, head);
         }
+    }
 
-        finishedTasks--;
+    ts_update_first_in_queue();
 
-        if (finishedTasks == 0) {
-            break;
-        }
+    // PendSV has a lower priority than the scheduler timer so the handlers run
+    // as soon as this isr returns, preempting the main loop
+    if (preemptiveTaskFinished == TRUE) {
+        SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
     }
+}
 
-    if (finishedTasks != 0) {
-        // log_prints("Error, not all tasks were dealt with!\r\n");
+uint8_t ts_task_is_running(TsHandle handle) {
 
-        for (uint8_t i = 0; i < QUEUE_SIZE; i++) {
-            if (queue[i].finished == TASK_FINISHED) {
-                char m[60];
-                sprintf(m, "TASK NOT PROCESSED %p\r\n", queue[i].task);
-                log_prints(m);
-            }
-        }
+    TsTask* tsTask = ts_get_task_from_handle(handle);
+
+    if (tsTask == NULL || tsTask->state == TS_TASK_CANCELLED_AFTER_FINISHING) {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+uint32_t ts_get_task_lateness(TsHandle handle) {
+
+    TsTask* tsTask = ts_get_task_from_handle(handle);
+
+    if (tsTask == NULL) {
+        return 0;
+    }
+
+    return tsTask->lateness;
+}
+
+uint32_t ts_get_task_skipped_periods(TsHandle handle) {
+
+    TsTask* tsTask = ts_get_task_from_handle(handle);
+
+    if (tsTask == NULL) {
+        return 0;
+    }
+
+    return tsTask->skippedPeriods;
+}
 
-        finishedTasks = 0;
+RAM_FUNCTION void ts_overflow_isr(void) {
+
+    epoch++;
+
+    // The task at the front of the queue may be due in the period that just started
+    ts_update_first_in_queue();
+}
+
+RAM_FUNCTION uint32_t ts_get_time(void) {
+
+    uint32_t primask;
+    ENTER_CRITICAL_SECTION(primask);
+
+    uint32_t count        = TS_TIMER->CNT;
+    uint32_t currentEpoch = epoch;
+
+    // The timer may have wrapped without the overflow isr having run yet. Read the
+    // count again so it is guaranteed to be from after the wrap
+    if ((TS_TIMER->SR & TIM_SR_UIF) == TIM_SR_UIF) {
+        count = TS_TIMER->CNT;
+        currentEpoch++;
+    }
+
+    EXIT_CRITICAL_SECTION(primask);
+
+    return (currentEpoch * TS_TIMER_PERIOD) + count;
+}
+
+uint32_t ts_get_overflow_count(void) {
+    return overflowCount;
+}
+
+uint16_t ts_get_num_tasks_in_queue(void) {
+    return numTasksInQueue;
+}
+
+uint32_t ts_get_time_until_next_wake(void) {
+
+    uint32_t primask;
+    ENTER_CRITICAL_SECTION(primask);
+
+    uint32_t wait = TS_NO_WAKE;
+
+    if (numTasksInQueue != 0) {
+        uint32_t currentTime = ts_get_time();
+        wait = TS_TIME_IS_DUE(heap[0]->wakeTime, currentTime) ? 0 : (heap[0]->wakeTime - currentTime);
     }
 
+    EXIT_CRITICAL_SECTION(primask);
+
+    return wait;
+}
+
+void ts_advance_time(uint32_t ticks) {
+
+    uint32_t primask;
+    ENTER_CRITICAL_SECTION(primask);
+
+    // Any overflow still pending is included in the time read here so the flag
+    // is cleared along with it
+    TS_TIMER->CR1 &= ~(TIM_CR1_CEN);
+    uint32_t newTime = ts_get_time() + ts_limit_delay(ticks);
+
+    epoch         = newTime / TS_TIMER_PERIOD;
+    TS_TIMER->CNT = newTime % TS_TIMER_PERIOD;
+    TS_TIMER->SR  = ~TIM_SR_UIF;
+    TS_TIMER->CR1 |= TIM_CR1_CEN;
+
+    // The compare register was loaded for the old count
     ts_update_first_in_queue();
+
+    EXIT_CRITICAL_SECTION(primask);
 }
 
-void ts_isr(void) {
-    // char m[50];
-    // sprintf(m, "ISR called @T=%li\r\n", TIM15->CNT);
-    // // log_prints(m);
-    uint8_t index = 0;
-    TsTask* head  = queueHead[0];
-
-    while (head != NULL) {
-
-        switch (head->task->group) {
-            case TEMPEST_GROUP:
-                FLAG_SET(tempestTasksFlag, head->task->functionId);
-                break;
-            case BUTTON_GROUP:
-                FLAG_SET(buttonTasksFlag, head->task->functionId);
-                break;
-            case AMBIENT_LIGHT_SENSOR_GROUP:
-                FLAG_SET(ambientLightSensorFlag, head->task->functionId);
-                break;
-            case BLIND_MOTOR_GROUP:
-                FLAG_SET(blindMotorFlag, head->task->functionId);
-                break;
-            case BLIND_GROUP:
-                FLAG_SET(blindTasksFlag, head->task->functionId);
-                break;
-            default:
-                break;
+void ts_print_statistics(void) {
+
+    char m[80];
+
+    sprintf(m, "Tasks queued: %i (max %i of %i)\r\n", numTasksInQueue, tsStatistics.maxTasksInQueue,
+            TS_QUEUE_CAPACITY);
+    log_prints(m);
+    sprintf(m, "Tasks dropped: %lu\r\n", overflowCount);
+    log_prints(m);
+    sprintf(m, "Finished tasks per loop: %i (max %i)\r\n", tsStatistics.lastFinishedTasksPerLoop,
+            tsStatistics.maxFinishedTasksPerLoop);
+    log_prints(m);
+    sprintf(m, "ISR cycles: %lu (max %lu)\r\n", tsStatistics.lastIsrCycles, tsStatistics.maxIsrCycles);
+    log_prints(m);
+
+    // Only bins with something in them are printed to keep the output short
+    for (uint8_t group = 0; group < TS_NUM_GROUPS; group++) {
+        sprintf(m, "%s latency (ticks):\r\n", tsGroupNames[group]);
+        log_prints(m);
+
+        for (uint8_t bin = 0; bin < TS_LATENCY_HISTOGRAM_BINS; bin++) {
+
+            uint32_t count = tsStatistics.latencyHistogram[group][bin];
+            if (count == 0) {
+                continue;
+            }
+
+            uint32_t lowerBound = (bin == 0) ? 0 : (0x01UL << (bin - 1));
+            if (bin == (TS_LATENCY_HISTOGRAM_BINS - 1)) {
+                sprintf(m, "\t>= %lu: %lu\r\n", lowerBound, count);
+            } else {
+                sprintf(m, "\t%lu-%lu: %lu\r\n", lowerBound, (bin == 0) ? 0 : ((0x01UL << bin) - 1), count);
+            }
+            log_prints(m);
         }
-        head->finished = TASK_FINISHED;
-        finishedTasks++;
-        // char m[60];
-        // sprintf(m, "++ Func Id: %i now finished -> FTs = %i\r\n", head->task->functionId, finishedTasks);
-        // // log_prints(m);
-        head = queueHead[++index];
     }
 }
 
+void ts_reset_statistics(void) {
+
+    for (uint8_t group = 0; group < TS_NUM_GROUPS; group++) {
+        for (uint8_t bin = 0; bin < TS_LATENCY_HISTOGRAM_BINS; bin++) {
+            tsStatistics.latencyHistogram[group][bin] = 0;
+        }
+    }
+
+    tsStatistics.maxTasksInQueue          = numTasksInQueue;
+    tsStatistics.lastFinishedTasksPerLoop = 0;
+    tsStatistics.maxFinishedTasksPerLoop  = 0;
+    tsStatistics.lastIsrCycles            = 0;
+    tsStatistics.maxIsrCycles             = 0;
+}
+
+RAM_FUNCTION void ts_record_isr_cycles(uint32_t cycles) {
+
+    tsStatistics.lastIsrCycles = cycles;
+    if (cycles > tsStatistics.maxIsrCycles) {
+        tsStatistics.maxIsrCycles = cycles;
+    }
+}
+
+uint8_t ts_has_finished_tasks(void) {
+    return (finishedTasks.numTasks != 0) ? TRUE : FALSE;
+}
+
 /* Private Functions */
 
 uint32_t ts_calculate_execution_time(uint32_t delayUntilExecution) {
-    return (TS_TIMER->CNT + delayUntilExecution) % TS_TIMER_MAX_COUNT;
+    return ts_get_time() + ts_limit_delay(delayUntilExecution);
 }
 
-void ts_copy_task_into_queue(uint8_t qi, const Task1* task) {
-    // // log_prints("Copying to queue\r\n");
-    queue[qi].task          = task;
-    queue[qi].executionTime = ts_calculate_execution_time(task->delay);
-    queue[qi].finished      = 0;
-    numTasksInQueue++;
+uint32_t ts_limit_delay(uint32_t delay) {
+
+    // Longer delays would compare as being in the past
+    if (delay > TS_MAX_DELAY) {
+        return TS_MAX_DELAY;
+    }
+
+    return delay;
 }
 
-void ts_remove_task(uint8_t qi) {
-    // char m[60];
-    // sprintf(m, "REMOVING TASK %p\r\n", queue[qi].task);
-    // log_prints(m);
+void ts_copy_task_into_queue(TsTask* tsTask, const Task1* task, void* context, uint32_t delay) {
+    tsTask->task           = task;
+    tsTask->context        = context;
+    tsTask->lateness       = 0;
+    tsTask->skippedPeriods = 0;
+    tsTask->state          = TS_TASK_QUEUED;
+    ts_set_execution_time(tsTask, ts_calculate_execution_time(delay));
+    ts_heap_push(tsTask);
+}
 
-    queue[qi].executionTime = TS_NONE;
-    queue[qi].finished      = TS_NONE;
-    queue[qi].task          = NULL;
-    numTasksInQueue--;
+void ts_set_execution_time(TsTask* tsTask, uint32_t executionTime) {
+    tsTask->executionTime = executionTime;
+    tsTask->wakeTime      = executionTime + ts_limit_delay(tsTask->task->slack);
+}
 
-    if (numTasksInQueue < 0) {
-        // log_prints("FATAL ERROR - TASKS IN QUEUE WAS NEGATIVE\r\n");
-    }
+void ts_remove_task(TsTask* tsTask) {
+    tsTask->task              = NULL;
+    tsTask->context           = NULL;
+    tsTask->state             = TS_TASK_FREE;
+    tsTask->heapIndex         = TS_NOT_IN_HEAP;
+    freeSlots[numFreeSlots++] = (uint16_t)(tsTask - queue);
+    ts_next_generation(tsTask);
 }
 
-uint8_t ts_task_is_running(const Task1* task) {
-    for (uint8_t qi = 0; qi < QUEUE_SIZE; qi++) {
-        if (queue[qi].task == task) {
-            return TRUE;
-        }
+TsTask* ts_get_task_from_handle(TsHandle handle) {
+
+    uint16_t index = TS_HANDLE_INDEX(handle);
+
+    if (index >= TS_QUEUE_CAPACITY) {
+        return NULL;
     }
 
-    return FALSE;
+    // The task the handle was given out for has since finished or been cancelled
+    if ((queue[index].generation != TS_HANDLE_GENERATION(handle)) || (queue[index].state == TS_TASK_FREE)) {
+        return NULL;
+    }
+
+    return &queue[index];
 }
 
-void ts_move_to_next_task(uint8_t qi) {
-    // char m[60];
-    // sprintf(m, "MOVING ONTO NEXT TASK %p\r\n", queue[qi].task);
-    // log_prints(m);
+void ts_next_generation(TsTask* tsTask) {
+    tsTask->generation++;
 
-    queue[qi].task          = queue[qi].task->nextTask;
-    queue[qi].executionTime = ts_calculate_execution_time(queue[qi].task->delay);
-    queue[qi].finished      = 0;
+    // Generation 0 is skipped so a valid handle can never equal TS_INVALID_HANDLE
+    if (tsTask->generation == 0) {
+        tsTask->generation = 1;
+    }
 }
 
-void ts_update_first_in_queue(void) {
+void ts_move_to_next_task(TsTask* tsTask) {
+
+    const Task1* nextTask = tsTask->task->nextTask;
+    uint32_t delay        = ts_limit_delay(nextTask->delay);
+    uint32_t currentTime  = ts_get_time();
+
+    // The next deadline is measured from the previous deadline instead of the
+    // current time so the time taken by the main loop to get here doesn't
+    // build up every period
+    uint32_t executionTime = tsTask->executionTime + delay;
+
+    if ((nextTask->overrunPolicy == TS_OVERRUN_SKIP) && (delay != 0) &&
+        TS_TIME_IS_BEFORE(executionTime, currentTime)) {
 
-    // This ensures the queue head is empty. If this is not here
-    // then the tasks will accumulate in this queue and you will get
-    // ISRS running that shouldn't
-    for (uint8_t i = 0; i < QUEUE_HEAD_SIZE; i++) {
-        queueHead[i] = NULL;
+        // Move forward by whole periods so the task stays on the same phase
+        uint32_t missedPeriods = ((currentTime - executionTime) / delay) + 1;
+        executionTime += missedPeriods * delay;
+        tsTask->skippedPeriods += missedPeriods;
     }
 
-    uint32_t currentTime = TS_TIMER->CNT;
-    uint32_t zeroPoint   = 0;
+    tsTask->task  = nextTask;
+    tsTask->state = TS_TASK_QUEUED;
+    ts_set_execution_time(tsTask, executionTime);
+    ts_heap_push(tsTask);
+}
 
-    for (uint8_t qi = 0; qi < QUEUE_SIZE; qi++) {
-        if (queue[qi].task != NULL && queue[qi].executionTime > currentTime) {
-            zeroPoint = currentTime;
-        }
+void ts_set_group_flag(const Task1* task) {
+
+    switch (task->group) {
+        case TEMPEST_GROUP:
+            FLAG_SET(tempestTasksFlag, task->functionId);
+            break;
+        case BUTTON_GROUP:
+            FLAG_SET(buttonTasksFlag, task->functionId);
+            break;
+        case AMBIENT_LIGHT_SENSOR_GROUP:
+            FLAG_SET(ambientLightSensorFlag, task->functionId);
+            break;
+        case BLIND_MOTOR_GROUP:
+            FLAG_SET(blindMotorFlag, task->functionId);
+            break;
+        case BLIND_GROUP:
+            FLAG_SET(blindTasksFlag, task->functionId);
+            break;
+        default:
+            break;
     }
+}
 
-    uint8_t queueHeadFound    = 0;
-    uint32_t soonestTimeFound = TS_TIMER_MAX_COUNT;
+uint16_t ts_process_finished_tasks(TsFinishedList* list) {
 
-    for (uint8_t qi = 0; qi < QUEUE_SIZE; qi++) {
-        if (queue[qi].task == NULL) {
-            continue;
+    uint32_t primask;
+    uint16_t numTasksHandled = 0;
+
+    // Interrupts are only disabled while one task is dealt with at a time so
+    // the isr is never held off for longer than a single heap operation
+    while (1) {
+        ENTER_CRITICAL_SECTION(primask);
+
+        if (list->numTasks == 0) {
+            EXIT_CRITICAL_SECTION(primask);
+            break;
         }
 
-        if ((queue[qi].executionTime > zeroPoint) && (queue[qi].executionTime < soonestTimeFound)) {
-            soonestTimeFound = queue[qi].executionTime;
-            queueHeadFound   = 1;
+        numTasksHandled++;
+
+        TsTask* tsTask = list->tasks[list->head];
+        list->head     = (list->head + 1) % TS_QUEUE_CAPACITY;
+        list->numTasks--;
+
+        // Tasks cancelled after they ran don't have their handler called or flag set
+        void (*handler)(void* context) = NULL;
+        if (tsTask->state == TS_TASK_FINISHED) {
+            handler = tsTask->task->handler;
+
+            // The timer is allowed to wake as late as the end of the slack so
+            // only the time past that counts as late
+            uint32_t currentTime = ts_get_time();
+            uint32_t latency     = TS_TIME_IS_DUE(tsTask->wakeTime, currentTime) ? (currentTime - tsTask->wakeTime) : 0;
+            tsTask->lateness += latency;
+            ts_record_latency(tsTask->task, latency);
+
+            // Tasks without a handler set the flag of their group instead. This is
+            // done here rather than in the isr so the flags are only ever written
+            // from the main loop
+            if (handler == NULL) {
+                ts_set_group_flag(tsTask->task);
+            }
+        }
+
+        EXIT_CRITICAL_SECTION(primask);
+
+        // The handler is called with interrupts enabled. It is free to cancel or
+        // re-arm its own task using the handle it was given
+        if (handler != NULL) {
+            handler(tsTask->context);
+        }
+
+        ENTER_CRITICAL_SECTION(primask);
+
+        if ((tsTask->state == TS_TASK_CANCELLED_AFTER_FINISHING) || (tsTask->task->nextTask == NULL)) {
+            ts_remove_task(tsTask);
+        } else {
+            ts_move_to_next_task(tsTask);
+            ts_update_first_in_queue();
         }
+
+        EXIT_CRITICAL_SECTION(primask);
+    }
+
+    return numTasksHandled;
+}
+
+RAM_FUNCTION void ts_add_to_finished_list(TsFinishedList* list, TsTask* tsTask) {
+    list->tasks[(list->head + list->numTasks) % TS_QUEUE_CAPACITY] = tsTask;
+    list->numTasks++;
+}
+
+void ts_record_latency(const Task1* task, uint32_t latency) {
+
+    // The bin is the number of bits needed to store the latency
+    uint8_t bin = (latency == 0) ? 0 : (32 - __CLZ(latency));
+    if (bin >= TS_LATENCY_HISTOGRAM_BINS) {
+        bin = TS_LATENCY_HISTOGRAM_BINS - 1;
     }
 
-    if (queueHeadFound == 0) {
-        // // log_prints("Disabled\r\n");
-        // ts_disable();
+    tsStatistics.latencyHistogram[TS_GROUP_TO_INDEX(task->group)][bin]++;
+}
+
+RAM_FUNCTION void ts_update_first_in_queue(void) {
+
+    if (numTasksInQueue == 0) {
+        TS_TIMER->DIER &= ~(TIM_DIER_CC1IE);
+        return;
+    }
+
+    // Wake up as late as the slack of every task allows so tasks with overlapping
+    // windows are all run by the same interrupt
+    uint32_t wakeTime    = heap[0]->wakeTime;
+    uint32_t currentTime = ts_get_time();
+
+    // Only load the compare register when the task is due before the timer next
+    // wraps. Otherwise the overflow isr will check again at the start of each period
+    if (!TS_TIME_IS_DUE(wakeTime, currentTime) && !ts_time_is_in_current_period(wakeTime, currentTime)) {
+        TS_TIMER->DIER &= ~(TIM_DIER_CC1IE);
         return;
     }
 
-    // Loop through queue and add all tasks that have the same execution time to list
-    uint8_t index = 0;
-    for (uint8_t qi = 0; qi < QUEUE_SIZE; qi++) {
-        if (queue[qi].task == NULL) {
-            continue;
+    // Update capture compare
+    TS_TIMER->CCR1 = wakeTime % TS_TIMER_PERIOD;
+    TS_TIMER->SR   = ~TIM_SR_CC1IF;
+    TS_TIMER->DIER |= TIM_DIER_CC1IE;
+
+    // The compare interrupt only fires when the count equals the compare value.
+    // If the execution time has already passed, generate the event manually so
+    // the task doesn't have to wait for the timer to wrap all the way around
+    if (TS_TIME_IS_DUE(wakeTime, ts_get_time())) {
+        TS_TIMER->EGR |= TIM_EGR_CC1G;
+    }
+}
+
+RAM_FUNCTION uint8_t ts_time_is_in_current_period(uint32_t time, uint32_t currentTime) {
+    uint32_t ticksLeftInPeriod = TS_TIMER_MAX_COUNT - (currentTime % TS_TIMER_PERIOD);
+    return ((time - currentTime) <= ticksLeftInPeriod) ? TRUE : FALSE;
+}
+
+RAM_FUNCTION void ts_heap_swap(uint16_t i, uint16_t j) {
+    TsTask* temp = heap[i];
+    heap[i]      = heap[j];
+    heap[j]      = temp;
+
+    heap[i]->heapIndex = i;
+    heap[j]->heapIndex = j;
+}
+
+RAM_FUNCTION void ts_heap_sift_up(uint16_t i) {
+
+    while (i > 0 && TS_TIME_IS_BEFORE(heap[i]->wakeTime, heap[TS_HEAP_PARENT(i)]->wakeTime)) {
+        ts_heap_swap(i, TS_HEAP_PARENT(i));
+        i = TS_HEAP_PARENT(i);
+    }
+}
+
+RAM_FUNCTION void ts_heap_sift_down(uint16_t i) {
+
+    while (1) {
+        uint16_t smallest = i;
+        uint16_t left     = TS_HEAP_LEFT(i);
+        uint16_t right    = TS_HEAP_RIGHT(i);
+
+        if (left < numTasksInQueue &&
+            TS_TIME_IS_BEFORE(heap[left]->wakeTime, heap[smallest]->wakeTime)) {
+            smallest = left;
+        }
+
+        if (right < numTasksInQueue &&
+            TS_TIME_IS_BEFORE(heap[right]->wakeTime, heap[smallest]->wakeTime)) {
+            smallest = right;
         }
 
-        if (queue[qi].executionTime == soonestTimeFound) {
-            queueHead[index] = &queue[qi];
-            index++;
+        if (smallest == i) {
+            return;
         }
+
+        ts_heap_swap(i, smallest);
+        i = smallest;
     }
+}
 
-    // Update capture compare
-    TS_TIMER->CCR1 = queueHead[0]->executionTime;
+void ts_heap_push(TsTask* tsTask) {
+    heap[numTasksInQueue] = tsTask;
+    tsTask->heapIndex     = numTasksInQueue;
+    numTasksInQueue++;
+    ts_heap_sift_up(tsTask->heapIndex);
 
-    char m[50];
-    sprintf(m, "  Next ISR @T=%li\r\n", TS_TIMER->CCR1);
-    // log_prints(m);
-    ts_enable();
+    if (numTasksInQueue > tsStatistics.maxTasksInQueue) {
+        tsStatistics.maxTasksInQueue = numTasksInQueue;
+    }
+}
+
+RAM_FUNCTION void ts_heap_remove(uint16_t i) {
+
+    heap[i]->heapIndex = TS_NOT_IN_HEAP;
+    numTasksInQueue--;
+
+    // Nothing needs to be reordered if the last task in the heap was removed
+    if (i == numTasksInQueue) {
+        return;
+    }
+
+    // Fill the gap with the last task in the heap and move it to where it belongs.
+    // It can only ever need to move in one direction
+    TsTask* moved    = heap[numTasksInQueue];
+    heap[i]          = moved;
+    moved->heapIndex = i;
+    ts_heap_sift_up(i);
+    ts_heap_sift_down(moved->heapIndex);
 }
 
 void ts_enable(void) {
     // Only enable timer if its currently disabled
     if ((TS_TIMER->CR1 & TIM_CR1_CEN) == 0) {
-        TS_TIMER->EGR |= (TIM_EGR_UG);    // Reset counter to 0 and update all registers
-        TS_TIMER->DIER |= TIM_DIER_CC1IE; // Enable interrupts
-        TS_TIMER->CR1 |= TIM_CR1_CEN;     // Start the timer
+        TS_TIMER->CR1 |= TIM_CR1_URS;    // Only counter overflows set the update flag
+        TS_TIMER->EGR |= (TIM_EGR_UG);   // Reset counter to 0 and update all registers
+        TS_TIMER->SR = 0x00;             // Clear any pending interrupts
+        TS_TIMER->DIER |= TIM_DIER_UIE;  // Enable overflow interrupt to keep track of the epoch
+        TS_TIMER->CR1 |= TIM_CR1_CEN;    // Start the timer
     }
 }
 
 void ts_disable(void) {
-    TS_TIMER->DIER &= 0x00;          // Disable all interrupts
+    TS_TIMER->DIER &= 0x00;          // Disable all interrupts, including the cyclic executive
     TS_TIMER->CR1 &= ~(TIM_CR1_CEN); // Disbable timer
-}
\ No newline at end of file
+}
+
+/************************************ UNIT TESTING ************************************/
+
+#if (PROJECT_STATUS == UNIT_TESTS)
+uint8_t UNIT_TESTS_FAILED = 0;
+
+#    define ASSERT(test)                                                                            \
+        do {                                                                                        \
+            if (!(test)) {                                                                          \
+                char msg[100];                                                                      \
+                sprintf(msg, "Unit test failed in File %s line number %d\r\n", __FILE__, __LINE__); \
+                log_prints(msg);                                                                    \
+                UNIT_TESTS_FAILED++;                                                                \
+            }                                                                                       \
+        } while (0)
+
+/* Function definitions */
+void ts_heap_order_test(void);
+void ts_cancel_task_test(void);
+void ts_overflow_test(void);
+void ts_long_delay_test(void);
+void ts_handler_test(void);
+void ts_periodic_test(void);
+void ts_slack_test(void);
+void ts_statistics_test(void);
+void ts_preemptive_test(void);
+void ts_test_handler(void* context);
+uint8_t ts_heap_is_valid(void);
+
+const Task1 testTask1 = {.delay = 500, .functionId = 0, .group = TEMPEST_GROUP, .nextTask = NULL};
+const Task1 testTask2 = {.delay = 100, .functionId = 1, .group = TEMPEST_GROUP, .nextTask = NULL};
+const Task1 testTask3 = {.delay = 300, .functionId = 2, .group = TEMPEST_GROUP, .nextTask = NULL};
+const Task1 testTask4 = {.delay = 200, .functionId = 3, .group = TEMPEST_GROUP, .nextTask = NULL};
+const Task1 testTask5 = {.delay = 100000, .functionId = 4, .group = TEMPEST_GROUP, .nextTask = NULL};
+
+// Zero initialised tasks that only need to be unique for the overflow test
+Task1 overflowTasks[TS_QUEUE_CAPACITY + 2];
+
+TsHandle testHandles[TS_QUEUE_CAPACITY + 2];
+
+const Task1 testHandlerTask = {.delay = 0, .handler = ts_test_handler, .nextTask = NULL};
+
+const Task1 testSlackTask1 = {.delay = 100, .slack = 50, .functionId = 0, .group = TEMPEST_GROUP, .nextTask = NULL};
+const Task1 testSlackTask2 = {.delay = 120, .functionId = 1, .group = TEMPEST_GROUP, .nextTask = NULL};
+const Task1 testSlackTask3 = {.delay = 0, .slack = 1000, .functionId = 2, .group = TEMPEST_GROUP, .nextTask = NULL};
+
+const Task1 testPreemptiveTask = {
+    .delay    = 0,
+    .handler  = ts_test_handler,
+    .priority = TS_PRIORITY_PREEMPTIVE,
+    .nextTask = NULL,
+};
+
+const Task1 testSkipTask = {
+    .delay         = 100,
+    .functionId    = 0,
+    .group         = TEMPEST_GROUP,
+    .nextTask      = &testSkipTask,
+    .overrunPolicy = TS_OVERRUN_SKIP,
+};
+
+const Task1 testCatchUpTask = {
+    .delay         = 100,
+    .functionId    = 1,
+    .group         = TEMPEST_GROUP,
+    .nextTask      = &testCatchUpTask,
+    .overrunPolicy = TS_OVERRUN_CATCH_UP,
+};
+
+void ts_run_unit_tests(void) {
+    log_prints("STARTING TESTS\r\n");
+
+    // Stop the isr from removing tasks from the queue whilst testing
+    HAL_NVIC_DisableIRQ(HC_TS_TIMER_IRQn);
+
+    ts_heap_order_test();
+    ts_cancel_task_test();
+    ts_overflow_test();
+    ts_long_delay_test();
+    ts_handler_test();
+    ts_periodic_test();
+    ts_slack_test();
+    ts_statistics_test();
+    ts_preemptive_test();
+
+    ts_init();
+    HAL_NVIC_EnableIRQ(HC_TS_TIMER_IRQn);
+
+    char m[50];
+    sprintf(m, "UNIT TESTS FAILED: %i\r\n", UNIT_TESTS_FAILED);
+    log_prints(m);
+}
+
+uint8_t ts_heap_is_valid(void) {
+
+    for (uint16_t i = 1; i < numTasksInQueue; i++) {
+        if (TS_TIME_IS_BEFORE(heap[i]->wakeTime, heap[TS_HEAP_PARENT(i)]->wakeTime)) {
+            return FALSE;
+        }
+
+        if (heap[i]->heapIndex != i) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+void ts_heap_order_test(void) {
+
+    ts_init();
+    ts_add_task_to_queue(&testTask1, &testHandles[0]);
+    ts_add_task_to_queue(&testTask2, &testHandles[1]);
+    ts_add_task_to_queue(&testTask3, &testHandles[2]);
+    ts_add_task_to_queue(&testTask4, &testHandles[3]);
+
+    // Confirm the task with the shortest delay is at the front of the queue
+    ASSERT(ts_get_num_tasks_in_queue() == 4);
+    ASSERT(heap[0]->task == &testTask2);
+    ASSERT(TS_TIMER->CCR1 == (heap[0]->wakeTime % TS_TIMER_PERIOD));
+    ASSERT(ts_heap_is_valid() == TRUE);
+
+    // Re-arming a queued task should update it instead of adding a duplicate
+    TsHandle handle = testHandles[2];
+    ts_add_task_to_queue(&testTask2, &testHandles[2]);
+    ASSERT(testHandles[2] == handle);
+    ASSERT(ts_get_num_tasks_in_queue() == 4);
+    ASSERT(ts_heap_is_valid() == TRUE);
+
+    // Tasks added without a handle are never treated as duplicates
+    ts_add_task_to_queue(&testTask3, NULL);
+    ASSERT(ts_get_num_tasks_in_queue() == 5);
+}
+
+void ts_cancel_task_test(void) {
+
+    ts_init();
+    ts_add_task_to_queue(&testTask1, &testHandles[0]);
+    ts_add_task_to_queue(&testTask2, &testHandles[1]);
+    ts_add_task_to_queue(&testTask3, &testHandles[2]);
+    ts_add_task_to_queue(&testTask4, &testHandles[3]);
+
+    // Cancelling the front of the queue should promote the next soonest task
+    ASSERT(ts_cancel_running_task(&testHandles[1]) == TS_TASK_CANCELLED);
+    ASSERT(heap[0]->task == &testTask4);
+    ASSERT(ts_heap_is_valid() == TRUE);
+
+    TsHandle handle = testHandles[2];
+    ASSERT(ts_cancel_running_task(&testHandles[2]) == TS_TASK_CANCELLED);
+    ASSERT(testHandles[2] == TS_INVALID_HANDLE);
+    ASSERT(ts_cancel_running_task(&testHandles[2]) == TS_TASK_NOT_FOUND);
+    ASSERT(ts_task_is_running(handle) == FALSE);
+    ASSERT(ts_task_is_running(testHandles[0]) == TRUE);
+    ASSERT(ts_get_num_tasks_in_queue() == 2);
+    ASSERT(ts_heap_is_valid() == TRUE);
+
+    // A stale handle must not refer to a newer task that reused the same slot
+    ts_add_task_to_queue(&testTask3, &testHandles[2]);
+    ASSERT(TS_HANDLE_INDEX(testHandles[2]) == TS_HANDLE_INDEX(handle));
+    ASSERT(ts_task_is_running(handle) == FALSE);
+    ASSERT(ts_cancel_running_task(&handle) == TS_TASK_NOT_FOUND);
+    ASSERT(ts_task_is_running(testHandles[2]) == TRUE);
+}
+
+void ts_overflow_test(void) {
+
+    ts_init();
+
+    for (uint16_t i = 0; i < (TS_QUEUE_CAPACITY + 2); i++) {
+        ts_add_task_to_queue(&overflowTasks[i], &testHandles[i]);
+    }
+
+    // Tasks that don't fit should be counted rather than silently lost
+    ASSERT(ts_get_num_tasks_in_queue() == TS_QUEUE_CAPACITY);
+    ASSERT(ts_get_overflow_count() == 2);
+    ASSERT(ts_heap_is_valid() == TRUE);
+
+    // Freeing a slot should let another task be added
+    ASSERT(testHandles[TS_QUEUE_CAPACITY] == TS_INVALID_HANDLE);
+    ASSERT(ts_cancel_running_task(&testHandles[0]) == TS_TASK_CANCELLED);
+    ts_add_task_to_queue(&overflowTasks[TS_QUEUE_CAPACITY], &testHandles[TS_QUEUE_CAPACITY]);
+    ASSERT(ts_get_num_tasks_in_queue() == TS_QUEUE_CAPACITY);
+    ASSERT(ts_get_overflow_count() == 2);
+}
+
+void ts_long_delay_test(void) {
+
+    ts_init();
+    ts_add_task_to_queue(&testTask5, NULL);
+    ts_add_task_to_queue(&testTask1, NULL);
+
+    // A delay longer than one timer period should still be ordered after shorter delays
+    ASSERT(heap[0]->task == &testTask1);
+    ASSERT(heap[1]->executionTime - heap[0]->executionTime == (testTask5.delay - testTask1.delay));
+
+    // Only the task due in the current period should have its compare loaded
+    ASSERT(TS_TIMER->CCR1 == (heap[0]->wakeTime % TS_TIMER_PERIOD));
+    ASSERT(ts_time_is_in_current_period(heap[1]->executionTime, ts_get_time()) == FALSE);
+
+    // Times should still be ordered correctly when the virtual time wraps
+    ASSERT(TS_TIME_IS_BEFORE(0xFFFFFFF0, 0x00000010) == TRUE);
+    ASSERT(TS_TIME_IS_BEFORE(0x00000010, 0xFFFFFFF0) == FALSE);
+}
+
+void ts_test_handler(void* context) {
+    (*(uint8_t*)context)++;
+}
+
+void ts_handler_test(void) {
+
+    uint8_t count1 = 0;
+    uint8_t count2 = 0;
+
+    ts_init();
+    ts_add_task_with_context_to_queue(&testHandlerTask, &count1, NULL);
+    ts_add_task_with_context_to_queue(&testHandlerTask, &count2, &testHandles[0]);
+    ts_add_task_with_context_to_queue(&testHandlerTask, &count2, NULL);
+
+    // The isr is disabled during testing so run it manually. Both tasks have a
+    // delay of 0 so they are already due
+    ts_isr();
+    ASSERT(ts_get_num_tasks_in_queue() == 0);
+    ASSERT(count1 == 0);
+
+    // Cancelling a task that has run but not been processed stops its handler being called
+    ASSERT(ts_cancel_running_task(&testHandles[0]) == TS_TASK_CANCELLED);
+
+    // Handlers are only called from the main loop with the context they were added with
+    ts_process_internal_flags();
+    ASSERT(count1 == 1);
+    ASSERT(count2 == 1);
+    ASSERT(numFreeSlots == TS_QUEUE_CAPACITY);
+}
+
+void ts_periodic_test(void) {
+
+    ts_init();
+    ts_add_task_to_queue(&testSkipTask, &testHandles[0]);
+    ts_add_task_to_queue(&testCatchUpTask, &testHandles[1]);
+
+    // Pretend both tasks were due 250 ticks ago so they are overrunning
+    TsTask* skipTask    = ts_get_task_from_handle(testHandles[0]);
+    TsTask* catchUpTask = ts_get_task_from_handle(testHandles[1]);
+    uint32_t deadline   = ts_get_time() - 250;
+
+    ts_set_execution_time(skipTask, deadline);
+    ts_set_execution_time(catchUpTask, deadline);
+
+    ts_isr();
+    ts_process_internal_flags();
+    ASSERT(ts_get_num_tasks_in_queue() == 2);
+    ASSERT(ts_heap_is_valid() == TRUE);
+
+    // Catching up keeps the next deadline one period after the last even though
+    // it has already passed
+    ASSERT(catchUpTask->executionTime == (deadline + 100));
+    ASSERT(ts_get_task_skipped_periods(testHandles[1]) == 0);
+
+    // Skipping moves the deadline forward by whole periods until it is in the future
+    ASSERT(skipTask->executionTime == (deadline + 300));
+    ASSERT(ts_get_task_skipped_periods(testHandles[0]) == 2);
+
+    // Both tasks were processed at least 250 ticks after their deadline
+    ASSERT(ts_get_task_lateness(testHandles[0]) >= 250);
+    ASSERT(ts_get_task_lateness(testHandles[1]) >= 250);
+
+    FLAG_CLEAR(tempestTasksFlag, 0);
+    FLAG_CLEAR(tempestTasksFlag, 1);
+}
+
+void ts_slack_test(void) {
+
+    ts_init();
+    ts_add_task_to_queue(&testSlackTask1, NULL);
+    ts_add_task_to_queue(&testSlackTask2, NULL);
+
+    // The first task is due sooner but its slack lets it wait for the second
+    // task so the timer only has to wake up once for both
+    ASSERT(heap[0]->task == &testSlackTask2);
+    ASSERT(TS_TIMER->CCR1 == (heap[0]->wakeTime % TS_TIMER_PERIOD));
+    ASSERT(ts_heap_is_valid() == TRUE);
+
+    // A task that is due is run by the next wakeup even if its slack hasn't run out
+    uint8_t count = 0;
+    ts_init();
+    ts_add_task_to_queue(&testSlackTask3, NULL);
+    ts_add_task_with_context_to_queue(&testHandlerTask, &count, NULL);
+    ts_isr();
+    ASSERT(ts_get_num_tasks_in_queue() == 0);
+
+    ts_process_internal_flags();
+    ASSERT(count == 1);
+    ASSERT(FLAG_IS_SET(tempestTasksFlag, 2));
+    FLAG_CLEAR(tempestTasksFlag, 2);
+
+    // A task run after its execution time but within its slack isn't late.
+    // Make the task look like it was due 500 ticks ago with 500 ticks of its
+    // slack left
+    uint8_t tempestGroup = TEMPEST_GROUP - TASK_SCHEDULER_OFFSET;
+    ts_init();
+    ts_reset_statistics();
+    ts_add_task_to_queue(&testSlackTask3, NULL);
+    ts_isr();
+    finishedTasks.tasks[finishedTasks.head]->executionTime -= 500;
+    finishedTasks.tasks[finishedTasks.head]->wakeTime -= 500;
+    ts_process_internal_flags();
+    ASSERT(tsStatistics.latencyHistogram[tempestGroup][0] == 1);
+    FLAG_CLEAR(tempestTasksFlag, 2);
+
+    // Past the end of the slack it is late by the time since the slack ran out
+    ts_init();
+    ts_reset_statistics();
+    ts_add_task_to_queue(&testSlackTask3, NULL);
+    ts_isr();
+    finishedTasks.tasks[finishedTasks.head]->wakeTime -= 1005;
+    ts_process_internal_flags();
+    ASSERT(tsStatistics.latencyHistogram[tempestGroup][3] == 1);
+    FLAG_CLEAR(tempestTasksFlag, 2);
+}
+
+void ts_statistics_test(void) {
+
+    uint8_t count = 0;
+
+    ts_init();
+    ts_add_task_with_context_to_queue(&testHandlerTask, &count, NULL);
+    ts_add_task_with_context_to_queue(&testHandlerTask, &count, NULL);
+    ts_add_task_to_queue(&testTask1, NULL);
+    ts_isr();
+
+    // Make the first finished task look like it was dispatched 5 ticks late
+    finishedTasks.tasks[finishedTasks.head]->executionTime -= 5;
+    finishedTasks.tasks[finishedTasks.head]->wakeTime -= 5;
+    ts_process_internal_flags();
+
+    ASSERT(count == 2);
+    ASSERT(tsStatistics.maxTasksInQueue == 3);
+    ASSERT(tsStatistics.lastFinishedTasksPerLoop == 2);
+    ASSERT(tsStatistics.maxFinishedTasksPerLoop == 2);
+
+    // Handler tasks without a group are recorded under TS_NO_GROUP. 5 ticks is in
+    // the 4-7 bin. The other task could be 0 or 1 ticks late depending on timing
+    uint8_t noGroup = TS_NO_GROUP - TASK_SCHEDULER_OFFSET;
+    ASSERT(tsStatistics.latencyHistogram[noGroup][3] == 1);
+    ASSERT((tsStatistics.latencyHistogram[noGroup][0] + tsStatistics.latencyHistogram[noGroup][1]) == 1);
+
+    // Only the longest isr is kept as the max
+    ts_record_isr_cycles(200);
+    ts_record_isr_cycles(100);
+    ASSERT(tsStatistics.lastIsrCycles == 100);
+    ASSERT(tsStatistics.maxIsrCycles == 200);
+
+    ts_reset_statistics();
+    ASSERT(tsStatistics.maxTasksInQueue == 1);
+    ASSERT(tsStatistics.latencyHistogram[noGroup][3] == 0);
+    ASSERT(tsStatistics.maxIsrCycles == 0);
+}
+
+void ts_preemptive_test(void) {
+
+    uint8_t count = 0;
+
+    ts_init();
+    ts_add_task_with_context_to_queue(&testPreemptiveTask, &count, NULL);
+
+    // PendSV is pended by the isr and runs the handler straight away without
+    // the main loop having to process anything
+    ts_isr();
+    __DSB();
+    __ISB();
+
+    ASSERT(count == 1);
+    ASSERT(ts_has_finished_tasks() == FALSE);
+    ASSERT(numFreeSlots == TS_QUEUE_CAPACITY);
+}
+
+#endif
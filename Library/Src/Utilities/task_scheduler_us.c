@@ -0,0 +1,593 @@
+/**
+ * @file task_scheduler_us.c
+ * @author Gian Barta-Dougall
+ * @brief Microsecond resolution lane of the task scheduler
+ * @version 0.1
+ * @date --
+ *
+ * @copyright Copyright (c)
+ *
+ */
+/* Public Includes */
+
+/* Private Includes */
+#include "task_scheduler_us.h"
+#include "hardware_config.h"
+#include "utilities.h"
+#include "monotonic_time.h"
+
+/* Private STM Includes */
+
+/* Private #defines */
+#define TSU_TIMER        HC_TSU_TIMER
+#define TSU_TIMER_PERIOD (HC_TSU_TIMER_MAX_COUNT + 1)
+
+#if (HC_TSU_TIMER_FREQUENCY != TIMER_FREQUENCY_1MHz)
+#    error The microsecond lane timer must count at 1MHz
+#endif
+
+// Time differences are compared as signed numbers so the time can wrap
+#define TSU_TIME_IS_BEFORE(a, b) ((int32_t)((uint32_t)(a) - (uint32_t)(b)) < 0)
+
+// Tasks due within this many microseconds are run straight away. Setting the
+// timer any closer than this risks the count passing the reload value before
+// it has been written at the slowest system clock
+#define TSU_MIN_DELAY 10
+
+#define TSU_HANDLE_INDEX(handle)             ((handle)&0xFFFF)
+#define TSU_HANDLE_GENERATION(handle)        ((handle) >> 16)
+#define TSU_CREATE_HANDLE(index, generation) ((((uint32_t)(generation)) << 16) | (index))
+
+/* Private Structures and Enumerations */
+
+typedef struct TsuTask {
+    const Task1* task;
+    void* context;
+    uint32_t executionTime;
+    uint16_t generation;
+    uint8_t queued;
+} TsuTask;
+
+/* Private Variable Declarations */
+
+TsuTask tsuTasks[TSU_QUEUE_CAPACITY];
+
+// Queued tasks sorted by execution time. The lane is small enough that keeping
+// a sorted list is cheaper than the heap used by the main scheduler
+TsuTask* tsuQueue[TSU_QUEUE_CAPACITY];
+uint16_t tsuNumTasksInQueue = 0;
+
+uint32_t tsuOverflowCount = 0;
+
+// The timer doesn't have any compare channels. Instead the reload value is set
+// so the timer wraps when the next task is due. The time is kept by adding up
+// the length of each period the timer completes
+uint32_t tsuPeriodStart  = 0;
+uint32_t tsuPeriodLength = TSU_TIMER_PERIOD;
+
+/* Private Function Prototypes */
+TsuTask* tsu_get_task_from_handle(TsHandle handle);
+void tsu_queue_insert(TsuTask* tsuTask);
+void tsu_queue_remove(TsuTask* tsuTask);
+void tsu_free_task(TsuTask* tsuTask);
+void tsu_move_to_next_task(TsuTask* tsuTask, uint32_t currentTime);
+void tsu_update_timer(void);
+void tsu_start_timer(void);
+void tsu_stop_timer(void);
+
+/* Public Functions */
+
+void tsu_init(void) {
+
+    uint32_t primask;
+    ENTER_CRITICAL_SECTION(primask);
+
+    tsu_stop_timer();
+
+    // Also invalidates any handles that were given out before the reset
+    for (uint16_t i = 0; i < TSU_QUEUE_CAPACITY; i++) {
+        tsu_free_task(&tsuTasks[i]);
+    }
+
+    tsuNumTasksInQueue = 0;
+    tsuOverflowCount   = 0;
+    tsuPeriodStart     = 0;
+    tsuPeriodLength    = TSU_TIMER_PERIOD;
+
+    EXIT_CRITICAL_SECTION(primask);
+}
+
+RAM_FUNCTION void tsu_overflow_isr(void) {
+    tsuPeriodStart += tsuPeriodLength;
+}
+
+RAM_FUNCTION void tsu_isr(void) {
+
+    uint32_t currentTime = tsu_get_time();
+
+    while ((tsuNumTasksInQueue != 0) && TSU_TIME_IS_BEFORE(tsuQueue[0]->executionTime, currentTime + TSU_MIN_DELAY)) {
+
+        TsuTask* head     = tsuQueue[0];
+        const Task1* task = head->task;
+        void* context     = head->context;
+        tsu_queue_remove(head);
+
+        // Move on before calling the handler so the handler can re-arm or
+        // cancel its own handle
+        if (task->nextTask != NULL) {
+            tsu_move_to_next_task(head, currentTime);
+        } else {
+            tsu_free_task(head);
+        }
+
+        task->handler(context);
+        currentTime = tsu_get_time();
+    }
+
+    tsu_update_timer();
+}
+
+void tsu_add_task_to_queue(const Task1* task, TsHandle* handle) {
+    tsu_add_task_with_context_to_queue(task, NULL, handle);
+}
+
+void tsu_add_task_with_context_to_queue(const Task1* task, void* context, TsHandle* handle) {
+    tsu_add_task_with_delay_to_queue(task, context, task->delay, handle);
+}
+
+void tsu_add_task_with_delay_to_queue(const Task1* task, void* context, uint32_t delay, TsHandle* handle) {
+
+    if (delay > TS_MAX_DELAY) {
+        delay = TS_MAX_DELAY;
+    }
+
+    uint32_t primask;
+    ENTER_CRITICAL_SECTION(primask);
+
+    // The handler is the only way a task in this lane can do anything
+    if (task->handler == NULL) {
+        tsuOverflowCount++;
+
+        if (handle != NULL) {
+            *handle = TS_INVALID_HANDLE;
+        }
+
+        EXIT_CRITICAL_SECTION(primask);
+        return;
+    }
+
+    // The timer is only running while there are tasks so start it first to
+    // give the new task a time to be measured from
+    if (tsuNumTasksInQueue == 0) {
+        tsu_start_timer();
+    }
+
+    TsuTask* tsuTask = (handle == NULL) ? NULL : tsu_get_task_from_handle(*handle);
+
+    if (tsuTask != NULL) {
+        // Re-arm the task that is already waiting instead of adding a duplicate
+        tsu_queue_remove(tsuTask);
+    } else {
+
+        for (uint16_t i = 0; i < TSU_QUEUE_CAPACITY; i++) {
+            if (tsuTasks[i].queued == FALSE) {
+                tsuTask = &tsuTasks[i];
+                break;
+            }
+        }
+
+        if (tsuTask == NULL) {
+            tsuOverflowCount++;
+
+            if (handle != NULL) {
+                *handle = TS_INVALID_HANDLE;
+            }
+
+            tsu_update_timer();
+            EXIT_CRITICAL_SECTION(primask);
+            return;
+        }
+    }
+
+    tsuTask->task          = task;
+    tsuTask->context       = context;
+    tsuTask->executionTime = tsu_get_time() + delay;
+    tsuTask->queued        = TRUE;
+    tsu_queue_insert(tsuTask);
+    tsu_update_timer();
+
+    if (handle != NULL) {
+        *handle = TSU_CREATE_HANDLE(tsuTask - tsuTasks, tsuTask->generation);
+    }
+
+    EXIT_CRITICAL_SECTION(primask);
+}
+
+uint8_t tsu_cancel_running_task(TsHandle* handle) {
+
+    uint32_t primask;
+    ENTER_CRITICAL_SECTION(primask);
+
+    TsuTask* tsuTask = tsu_get_task_from_handle(*handle);
+    *handle          = TS_INVALID_HANDLE;
+
+    if (tsuTask == NULL) {
+        EXIT_CRITICAL_SECTION(primask);
+        return TS_TASK_NOT_FOUND;
+    }
+
+    tsu_queue_remove(tsuTask);
+    tsu_free_task(tsuTask);
+    tsu_update_timer();
+
+    EXIT_CRITICAL_SECTION(primask);
+
+    return TS_TASK_CANCELLED;
+}
+
+uint8_t tsu_task_is_running(TsHandle handle) {
+    return (tsu_get_task_from_handle(handle) != NULL) ? TRUE : FALSE;
+}
+
+uint32_t tsu_get_time(void) {
+
+    uint32_t primask;
+    ENTER_CRITICAL_SECTION(primask);
+
+    uint32_t count       = TSU_TIMER->CNT;
+    uint32_t periodStart = tsuPeriodStart;
+
+    // The timer may have wrapped without the update isr having run yet. Read
+    // the count again so it is guaranteed to be from after the wrap
+    if ((TSU_TIMER->SR & TIM_SR_UIF) == TIM_SR_UIF) {
+        count = TSU_TIMER->CNT;
+        periodStart += tsuPeriodLength;
+    }
+
+    EXIT_CRITICAL_SECTION(primask);
+
+    return periodStart + count;
+}
+
+uint16_t tsu_get_num_tasks_in_queue(void) {
+    return tsuNumTasksInQueue;
+}
+
+uint32_t tsu_get_overflow_count(void) {
+    return tsuOverflowCount;
+}
+
+/* Private Functions */
+
+TsuTask* tsu_get_task_from_handle(TsHandle handle) {
+
+    uint16_t index = TSU_HANDLE_INDEX(handle);
+
+    if ((handle == TS_INVALID_HANDLE) || (index >= TSU_QUEUE_CAPACITY)) {
+        return NULL;
+    }
+
+    TsuTask* tsuTask = &tsuTasks[index];
+
+    if ((tsuTask->queued == FALSE) || (tsuTask->generation != TSU_HANDLE_GENERATION(handle))) {
+        return NULL;
+    }
+
+    return tsuTask;
+}
+
+void tsu_queue_insert(TsuTask* tsuTask) {
+
+    uint16_t i = tsuNumTasksInQueue;
+
+    // Tasks with the same execution time run in the order they were added
+    while ((i > 0) && TSU_TIME_IS_BEFORE(tsuTask->executionTime, tsuQueue[i - 1]->executionTime)) {
+        tsuQueue[i] = tsuQueue[i - 1];
+        i--;
+    }
+
+    tsuQueue[i] = tsuTask;
+    tsuNumTasksInQueue++;
+}
+
+void tsu_queue_remove(TsuTask* tsuTask) {
+
+    uint16_t i = 0;
+    while ((i < tsuNumTasksInQueue) && (tsuQueue[i] != tsuTask)) {
+        i++;
+    }
+
+    if (i == tsuNumTasksInQueue) {
+        return;
+    }
+
+    for (; i < (tsuNumTasksInQueue - 1); i++) {
+        tsuQueue[i] = tsuQueue[i + 1];
+    }
+
+    tsuNumTasksInQueue--;
+}
+
+void tsu_free_task(TsuTask* tsuTask) {
+    tsuTask->task    = NULL;
+    tsuTask->context = NULL;
+    tsuTask->queued  = FALSE;
+
+    // Generation 0 is skipped so a valid handle can never equal TS_INVALID_HANDLE
+    tsuTask->generation++;
+    if (tsuTask->generation == 0) {
+        tsuTask->generation = 1;
+    }
+}
+
+void tsu_move_to_next_task(TsuTask* tsuTask, uint32_t currentTime) {
+
+    const Task1* nextTask = tsuTask->task->nextTask;
+    uint32_t delay        = (nextTask->delay > TS_MAX_DELAY) ? TS_MAX_DELAY : nextTask->delay;
+
+    // Measured from the previous deadline so the time taken to get here doesn't
+    // build up every period
+    uint32_t executionTime = tsuTask->executionTime + delay;
+
+    if ((nextTask->overrunPolicy == TS_OVERRUN_SKIP) && (delay != 0) &&
+        TSU_TIME_IS_BEFORE(executionTime, currentTime)) {
+        executionTime += (((currentTime - executionTime) / delay) + 1) * delay;
+    }
+
+    tsuTask->task          = nextTask;
+    tsuTask->executionTime = executionTime;
+    tsu_queue_insert(tsuTask);
+}
+
+void tsu_update_timer(void) {
+
+    uint32_t primask;
+    ENTER_CRITICAL_SECTION(primask);
+
+    // Add any wrap that hasn't been handled yet before the period is changed
+    if ((TSU_TIMER->SR & TIM_SR_UIF) == TIM_SR_UIF) {
+        TSU_TIMER->SR = ~TIM_SR_UIF;
+        tsu_overflow_isr();
+    }
+
+    if (tsuNumTasksInQueue == 0) {
+        tsu_stop_timer();
+        EXIT_CRITICAL_SECTION(primask);
+        return;
+    }
+
+    uint32_t count       = TSU_TIMER->CNT;
+    uint32_t currentTime = tsuPeriodStart + count;
+    uint32_t nextTime    = tsuQueue[0]->executionTime;
+
+    // The timer is about to wrap. Changing the period now could race the wrap so
+    // leave it and let the isr set the timer once the wrap has happened
+    if ((TSU_TIMER->ARR - count) < TSU_MIN_DELAY) {
+        EXIT_CRITICAL_SECTION(primask);
+        return;
+    }
+
+    // Too close to set the timer for. Run the isr straight away instead
+    if (TSU_TIME_IS_BEFORE(nextTime, currentTime + TSU_MIN_DELAY)) {
+        HAL_NVIC_SetPendingIRQ(HC_TSU_TIMER_IRQn);
+        EXIT_CRITICAL_SECTION(primask);
+        return;
+    }
+
+    // Wrap when the task is due or at the end of the counter if it is further away
+    uint32_t periodLength = nextTime - tsuPeriodStart;
+    if (periodLength > TSU_TIMER_PERIOD) {
+        periodLength = TSU_TIMER_PERIOD;
+    }
+
+    tsuPeriodLength = periodLength;
+    TSU_TIMER->ARR  = periodLength - 1;
+
+    // If the count went past the new reload value while it was being written, the
+    // timer would count all the way to its maximum before wrapping. Let it do so
+    // and run the isr now instead
+    if (TSU_TIMER->CNT > TSU_TIMER->ARR) {
+        tsuPeriodLength = TSU_TIMER_PERIOD;
+        TSU_TIMER->ARR  = HC_TSU_TIMER_MAX_COUNT;
+        HAL_NVIC_SetPendingIRQ(HC_TSU_TIMER_IRQn);
+    }
+
+    EXIT_CRITICAL_SECTION(primask);
+}
+
+void tsu_start_timer(void) {
+
+    if ((TSU_TIMER->CR1 & TIM_CR1_CEN) == TIM_CR1_CEN) {
+        return;
+    }
+
+    tsuPeriodLength = TSU_TIMER_PERIOD;
+    TSU_TIMER->ARR  = HC_TSU_TIMER_MAX_COUNT;
+    TSU_TIMER->CNT  = 0;
+    TSU_TIMER->SR   = ~TIM_SR_UIF;
+    TSU_TIMER->CR1 |= TIM_CR1_CEN;
+}
+
+void tsu_stop_timer(void) {
+
+    TSU_TIMER->CR1 &= ~(TIM_CR1_CEN);
+
+    // Keep the time that passed in the period that was cut short
+    tsuPeriodStart += TSU_TIMER->CNT;
+    TSU_TIMER->CNT = 0;
+    TSU_TIMER->SR  = ~TIM_SR_UIF;
+    HAL_NVIC_ClearPendingIRQ(HC_TSU_TIMER_IRQn);
+}
+
+/************************************ UNIT TESTING ************************************/
+
+#if (PROJECT_STATUS == UNIT_TESTS)
+uint8_t tsuTestsFailed = 0;
+
+#    define TSU_ASSERT(test)                                                                        \
+        do {                                                                                        \
+            if (!(test)) {                                                                          \
+                char msg[100];                                                                      \
+                sprintf(msg, "Unit test failed in File %s line number %d\r\n", __FILE__, __LINE__); \
+                log_prints(msg);                                                                    \
+                tsuTestsFailed++;                                                                   \
+            }                                                                                       \
+        } while (0)
+
+// Longest the tests wait for the lane to empty
+#    define TSU_TEST_TIMEOUT_MS 20
+
+/* Function definitions */
+void tsu_order_test(void);
+void tsu_timing_test(void);
+void tsu_cancel_test(void);
+void tsu_chain_test(void);
+void tsu_test_record_handler(void* context);
+void tsu_test_wait_until_empty(void);
+
+uint8_t tsuTestOrder[TSU_QUEUE_CAPACITY];
+uint8_t tsuTestNumRun = 0;
+uint32_t tsuTestRunTimes[TSU_QUEUE_CAPACITY];
+uint8_t tsuTestIds[TSU_QUEUE_CAPACITY] = {0, 1, 2, 3, 4, 5, 6, 7};
+
+const Task1 tsuTestTask1 = {.delay = 300, .handler = tsu_test_record_handler, .nextTask = NULL};
+const Task1 tsuTestTask2 = {.delay = 100, .handler = tsu_test_record_handler, .nextTask = NULL};
+const Task1 tsuTestTask3 = {.delay = 200, .handler = tsu_test_record_handler, .nextTask = NULL};
+const Task1 tsuTestFlagTask = {.delay = 100, .functionId = 0, .group = TEMPEST_GROUP, .nextTask = NULL};
+
+const Task1 tsuTestChainEnd   = {.delay = 150, .handler = tsu_test_record_handler, .nextTask = NULL};
+const Task1 tsuTestChainStart = {.delay = 100, .handler = tsu_test_record_handler, .nextTask = &tsuTestChainEnd};
+
+void tsu_run_unit_tests(void) {
+    log_prints("STARTING MICROSECOND LANE TESTS\r\n");
+
+    // The lane's interrupt is left enabled so the tests go through the same
+    // path as the tasks would normally
+    tsu_order_test();
+    tsu_timing_test();
+    tsu_cancel_test();
+    tsu_chain_test();
+
+    tsu_init();
+
+    char m[50];
+    sprintf(m, "MICROSECOND LANE TESTS FAILED: %i\r\n", tsuTestsFailed);
+    log_prints(m);
+}
+
+void tsu_test_record_handler(void* context) {
+
+    if (tsuTestNumRun < TSU_QUEUE_CAPACITY) {
+        tsuTestOrder[tsuTestNumRun]    = *((uint8_t*)context);
+        tsuTestRunTimes[tsuTestNumRun] = tsu_get_time();
+    }
+
+    tsuTestNumRun++;
+}
+
+void tsu_test_wait_until_empty(void) {
+    uint64_t start = time_now_ms();
+    while ((tsu_get_num_tasks_in_queue() != 0) && ((time_now_ms() - start) < TSU_TEST_TIMEOUT_MS)) {}
+}
+
+void tsu_order_test(void) {
+
+    tsu_init();
+    tsuTestNumRun = 0;
+
+    tsu_add_task_with_context_to_queue(&tsuTestTask1, &tsuTestIds[0], NULL);
+    tsu_add_task_with_context_to_queue(&tsuTestTask2, &tsuTestIds[1], NULL);
+    tsu_add_task_with_context_to_queue(&tsuTestTask3, &tsuTestIds[2], NULL);
+    TSU_ASSERT(tsu_get_num_tasks_in_queue() == 3);
+
+    tsu_test_wait_until_empty();
+    TSU_ASSERT(tsuTestNumRun == 3);
+    TSU_ASSERT(tsuTestOrder[0] == 1);
+    TSU_ASSERT(tsuTestOrder[1] == 2);
+    TSU_ASSERT(tsuTestOrder[2] == 0);
+
+    // The timer is stopped once the lane is empty
+    TSU_ASSERT((HC_TSU_TIMER->CR1 & TIM_CR1_CEN) == 0);
+
+    // Tasks without a handler are rejected
+    TsHandle handle = TS_INVALID_HANDLE;
+    tsu_add_task_to_queue(&tsuTestFlagTask, &handle);
+    TSU_ASSERT(handle == TS_INVALID_HANDLE);
+    TSU_ASSERT(tsu_get_overflow_count() == 1);
+    TSU_ASSERT(tsu_get_num_tasks_in_queue() == 0);
+}
+
+void tsu_timing_test(void) {
+
+    tsu_init();
+    tsuTestNumRun = 0;
+
+    uint32_t start = tsu_get_time();
+    tsu_add_task_with_delay_to_queue(&tsuTestTask1, &tsuTestIds[0], 500, NULL);
+    tsu_test_wait_until_empty();
+
+    // Never early by more than the minimum delay. The upper bound allows for
+    // interrupt latency at the slowest system clock
+    uint32_t elapsed = tsuTestRunTimes[0] - start;
+    TSU_ASSERT(tsuTestNumRun == 1);
+    TSU_ASSERT(elapsed >= (500 - TSU_MIN_DELAY));
+    TSU_ASSERT(elapsed < 600);
+
+    // Delays longer than the timer period wrap the timer before running
+    tsuTestNumRun = 0;
+    start         = tsu_get_time();
+    tsu_add_task_with_delay_to_queue(&tsuTestTask1, &tsuTestIds[0], TSU_TIMER_PERIOD + 1000, NULL);
+    HAL_Delay(70);
+    tsu_test_wait_until_empty();
+    elapsed = tsuTestRunTimes[0] - start;
+    TSU_ASSERT(tsuTestNumRun == 1);
+    TSU_ASSERT(elapsed >= (TSU_TIMER_PERIOD + 1000 - TSU_MIN_DELAY));
+    TSU_ASSERT(elapsed < (TSU_TIMER_PERIOD + 1100));
+}
+
+void tsu_cancel_test(void) {
+
+    tsu_init();
+    tsuTestNumRun = 0;
+
+    TsHandle handle1 = TS_INVALID_HANDLE;
+    TsHandle handle2 = TS_INVALID_HANDLE;
+    tsu_add_task_with_context_to_queue(&tsuTestTask1, &tsuTestIds[0], &handle1);
+    tsu_add_task_with_context_to_queue(&tsuTestTask3, &tsuTestIds[1], &handle2);
+    TSU_ASSERT(tsu_task_is_running(handle1) == TRUE);
+
+    TSU_ASSERT(tsu_cancel_running_task(&handle1) == TS_TASK_CANCELLED);
+    TSU_ASSERT(handle1 == TS_INVALID_HANDLE);
+    TSU_ASSERT(tsu_cancel_running_task(&handle1) == TS_TASK_NOT_FOUND);
+
+    // Re-arming keeps the same handle and doesn't add a second copy
+    TsHandle oldHandle2 = handle2;
+    tsu_add_task_with_context_to_queue(&tsuTestTask2, &tsuTestIds[1], &handle2);
+    TSU_ASSERT(handle2 == oldHandle2);
+    TSU_ASSERT(tsu_get_num_tasks_in_queue() == 1);
+
+    tsu_test_wait_until_empty();
+    TSU_ASSERT(tsuTestNumRun == 1);
+    TSU_ASSERT(tsuTestOrder[0] == 1);
+    TSU_ASSERT(tsu_task_is_running(handle2) == FALSE);
+}
+
+void tsu_chain_test(void) {
+
+    tsu_init();
+    tsuTestNumRun = 0;
+
+    TsHandle handle = TS_INVALID_HANDLE;
+    tsu_add_task_with_context_to_queue(&tsuTestChainStart, &tsuTestIds[3], &handle);
+    tsu_test_wait_until_empty();
+
+    // The chained task is measured from the first deadline, not from when the
+    // first handler ran
+    TSU_ASSERT(tsuTestNumRun == 2);
+    TSU_ASSERT(tsuTestOrder[0] == 3);
+    TSU_ASSERT(tsuTestOrder[1] == 3);
+    TSU_ASSERT((tsuTestRunTimes[1] - tsuTestRunTimes[0]) >= (150 - TSU_MIN_DELAY));
+    TSU_ASSERT((tsuTestRunTimes[1] - tsuTestRunTimes[0]) < 200);
+    TSU_ASSERT(tsu_task_is_running(handle) == FALSE);
+}
+#endif
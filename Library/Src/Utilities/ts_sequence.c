@@ -0,0 +1,248 @@
+/**
+ * @file ts_sequence.c
+ * @author Gian Barta-Dougall
+ * @brief Multi-step sequences that wait on the task scheduler instead of blocking
+ * @version 0.1
+ * @date --
+ *
+ * @copyright Copyright (c)
+ *
+ */
+/* Public Includes */
+
+/* Private Includes */
+#include "ts_sequence.h"
+#include "hardware_config.h"
+
+/* Private STM Includes */
+
+/* Private #defines */
+
+/* Private Structures and Enumerations */
+
+/* Private Function Prototypes */
+void ts_sequence_resume(void* context);
+
+/* Private Variable Declarations */
+
+// Shared by every sequence. The sequence to continue is given as the context
+const Task1 tsSequenceResumeTask = {
+    .delay    = 0,
+    .handler  = ts_sequence_resume,
+    .nextTask = NULL,
+};
+
+/* Public Functions */
+
+void ts_sequence_start(TsSequence* sequence) {
+
+    ts_cancel_running_task(&sequence->handle);
+
+    sequence->line         = 0;
+    sequence->awaitedEvent = TS_SEQUENCE_NO_EVENT;
+    sequence->running      = TRUE;
+
+    // The first step is run from the main loop like every other step
+    ts_sequence_wait(sequence, 0);
+}
+
+void ts_sequence_stop(TsSequence* sequence) {
+    ts_cancel_running_task(&sequence->handle);
+    sequence->line         = 0;
+    sequence->awaitedEvent = TS_SEQUENCE_NO_EVENT;
+    sequence->running      = FALSE;
+}
+
+void ts_sequence_post_event(TsSequence* sequence, uint8_t event) {
+
+    if ((sequence->running == FALSE) || (sequence->awaitedEvent != event)) {
+        return;
+    }
+
+    sequence->awaitedEvent = TS_SEQUENCE_NO_EVENT;
+    ts_sequence_wait(sequence, 0);
+}
+
+uint8_t ts_sequence_is_running(TsSequence* sequence) {
+    return sequence->running;
+}
+
+void ts_sequence_wait(TsSequence* sequence, uint32_t delay) {
+    sequence->deadline = ts_get_time() + delay;
+    ts_add_task_with_delay_to_queue(&tsSequenceResumeTask, sequence, delay, &sequence->handle);
+}
+
+void ts_sequence_wait_until(TsSequence* sequence, uint32_t time) {
+
+    // The difference is signed so a time that has passed is still caught
+    // when the scheduler time wraps
+    int32_t remaining = (int32_t)(time - ts_get_time());
+
+    sequence->deadline = time;
+    ts_add_task_with_delay_to_queue(&tsSequenceResumeTask, sequence, (remaining > 0) ? (uint32_t)remaining : 0,
+                                    &sequence->handle);
+}
+
+/* Private Functions */
+
+void ts_sequence_resume(void* context) {
+
+    TsSequence* sequence = (TsSequence*)context;
+
+    if (sequence->running == FALSE) {
+        return;
+    }
+
+    sequence->function(sequence);
+}
+
+/************************************ UNIT TESTING ************************************/
+
+#if (PROJECT_STATUS == UNIT_TESTS)
+uint8_t sequenceTestsFailed = 0;
+
+#    define SEQUENCE_ASSERT(test)                                                                   \
+        do {                                                                                        \
+            if (!(test)) {                                                                          \
+                char msg[100];                                                                      \
+                sprintf(msg, "Unit test failed in File %s line number %d\r\n", __FILE__, __LINE__); \
+                log_prints(msg);                                                                    \
+                sequenceTestsFailed++;                                                              \
+            }                                                                                       \
+        } while (0)
+
+#    define TEST_EVENT_1 1
+#    define TEST_EVENT_2 2
+
+/* Function definitions */
+void ts_sequence_steps_test(void);
+void ts_sequence_stop_test(void);
+void ts_sequence_deadline_test(void);
+void ts_sequence_test_function(TsSequence* sequence);
+void ts_sequence_run_scheduler(void);
+
+uint8_t testStep = 0;
+
+TsSequence testSequence = {
+    .function = ts_sequence_test_function,
+    .context  = &testStep,
+    .handle   = TS_INVALID_HANDLE,
+};
+
+void ts_sequence_run_unit_tests(void) {
+    log_prints("STARTING SEQUENCE TESTS\r\n");
+
+    // Stop the isr from running tasks whilst testing
+    HAL_NVIC_DisableIRQ(HC_TS_TIMER_IRQn);
+
+    ts_sequence_steps_test();
+    ts_sequence_stop_test();
+    ts_sequence_deadline_test();
+
+    ts_init();
+    HAL_NVIC_EnableIRQ(HC_TS_TIMER_IRQn);
+
+    char m[50];
+    sprintf(m, "SEQUENCE TESTS FAILED: %i\r\n", sequenceTestsFailed);
+    log_prints(m);
+}
+
+void ts_sequence_test_function(TsSequence* sequence) {
+
+    uint8_t* step = (uint8_t*)sequence->context;
+
+    TS_SEQUENCE_BEGIN(sequence);
+
+    (*step) = 1;
+    TS_AWAIT_MS(sequence, 0);
+    (*step) = 2;
+    TS_AWAIT_EVENT(sequence, TEST_EVENT_1);
+    (*step) = 3;
+
+    TS_SEQUENCE_END(sequence);
+}
+
+void ts_sequence_run_scheduler(void) {
+    // The isr is disabled during testing so run it manually
+    ts_isr();
+    ts_process_internal_flags();
+}
+
+void ts_sequence_steps_test(void) {
+
+    ts_init();
+    testStep = 0;
+
+    // Nothing is run until the main loop processes the scheduler
+    ts_sequence_start(&testSequence);
+    SEQUENCE_ASSERT(testStep == 0);
+    SEQUENCE_ASSERT(ts_sequence_is_running(&testSequence) == TRUE);
+
+    ts_sequence_run_scheduler();
+    SEQUENCE_ASSERT(testStep == 1);
+
+    ts_sequence_run_scheduler();
+    SEQUENCE_ASSERT(testStep == 2);
+
+    // Waiting on an event doesn't queue anything in the scheduler
+    ts_sequence_run_scheduler();
+    SEQUENCE_ASSERT(testStep == 2);
+    SEQUENCE_ASSERT(ts_get_num_tasks_in_queue() == 0);
+
+    // Only the awaited event continues the sequence
+    ts_sequence_post_event(&testSequence, TEST_EVENT_2);
+    ts_sequence_run_scheduler();
+    SEQUENCE_ASSERT(testStep == 2);
+
+    ts_sequence_post_event(&testSequence, TEST_EVENT_1);
+    ts_sequence_run_scheduler();
+    SEQUENCE_ASSERT(testStep == 3);
+    SEQUENCE_ASSERT(ts_sequence_is_running(&testSequence) == FALSE);
+}
+
+void ts_sequence_stop_test(void) {
+
+    ts_init();
+    testStep = 0;
+
+    ts_sequence_start(&testSequence);
+    ts_sequence_run_scheduler();
+    SEQUENCE_ASSERT(testStep == 1);
+
+    // Stopping cancels the wait so the sequence never continues
+    ts_sequence_stop(&testSequence);
+    SEQUENCE_ASSERT(ts_get_num_tasks_in_queue() == 0);
+    ts_sequence_run_scheduler();
+    SEQUENCE_ASSERT(testStep == 1);
+
+    // Restarting runs from the beginning again
+    ts_sequence_start(&testSequence);
+    ts_sequence_run_scheduler();
+    ts_sequence_run_scheduler();
+    SEQUENCE_ASSERT(testStep == 2);
+    ts_sequence_stop(&testSequence);
+}
+
+void ts_sequence_deadline_test(void) {
+
+    ts_init();
+    testStep = 0;
+    ts_sequence_start(&testSequence);
+
+    // Waiting until a time keeps that time as the deadline even if it has
+    // already passed so the next wait is anchored to it
+    uint32_t past = ts_get_time() - 5;
+    ts_sequence_wait_until(&testSequence, past);
+    SEQUENCE_ASSERT(testSequence.deadline == past);
+    SEQUENCE_ASSERT(ts_get_num_tasks_in_queue() == 1);
+
+    uint32_t future = ts_get_time() + 100;
+    ts_sequence_wait_until(&testSequence, future);
+    SEQUENCE_ASSERT(testSequence.deadline == future);
+
+    // Re-arming moves the same wait instead of adding a second one
+    SEQUENCE_ASSERT(ts_get_num_tasks_in_queue() == 1);
+
+    ts_sequence_stop(&testSequence);
+}
+#endif
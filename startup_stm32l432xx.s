@@ -44,6 +44,12 @@ defined in linker script */
 .word	_sbss
 /* end address for the .bss section. defined in linker script */
 .word	_ebss
+/* start address for the functions copied to SRAM2. defined in linker script */
+.word	_siramfunc
+/* start address for the .ramfunc section. defined in linker script */
+.word	_sramfunc
+/* end address for the .ramfunc section. defined in linker script */
+.word	_eramfunc
 
 .equ  BootRAM,        0xF1E0F85F
 /**
@@ -80,6 +86,23 @@ LoopCopyDataInit:
   adds r4, r0, r3
   cmp r4, r1
   bcc CopyDataInit
+
+/* Copy the functions that run from SRAM2 out of flash */
+  ldr r0, =_sramfunc
+  ldr r1, =_eramfunc
+  ldr r2, =_siramfunc
+  movs r3, #0
+  b LoopCopyRamFuncInit
+
+CopyRamFuncInit:
+  ldr r4, [r2, r3]
+  str r4, [r0, r3]
+  adds r3, r3, #4
+
+LoopCopyRamFuncInit:
+  adds r4, r0, r3
+  cmp r4, r1
+  bcc CopyRamFuncInit
   
 /* Zero fill the bss segment. */
   ldr r2, =_sbss